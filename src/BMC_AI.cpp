@@ -28,6 +28,7 @@
 //			 - moved g_sims to m_sims
 // drp062702 - more aggressive culling of TRIP, and more aggressive culling of 0-point moves
 // dbl100824 - migrated this logic from bmai_ai.cpp
+// dbl101626 - use the game's RNG, ScoreAttack() forks its own stream
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 // TWO PLY?
@@ -49,7 +50,6 @@ class BMC_Player;
 // DESC: basic behavior is to pick first available reserve (probably is the lowest)
 void BMC_AI::GetReserveAction(BMC_Game *_game, BMC_Move &_move)
 {
-	_move.m_game = _game;
 	_move.m_action = BME_ACTION_USE_RESERVE;
 
 	BMC_Player *p = _game->GetPhasePlayer();
@@ -73,7 +73,6 @@ void BMC_AI::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 	//BMC_MoveList	movelist;
 	//_game->GenerateValidPreround(movelist);
 
-	_move.m_game = _game;
 	_move.m_action = BME_ACTION_SET_SWING_AND_OPTION;
 
 	BMC_Player *p = _game->GetPhasePlayer();
@@ -155,7 +154,7 @@ void BMC_AI::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 	BMC_MoveList	movelist;
 	_game->GenerateValidAttacks(movelist);
 
-	_move = *movelist.Get(g_rng.GetRand(movelist.Size()));
+	_move = *movelist.Get(_game->GetRNG().GetRand(movelist.Size()));
 }
 
 // DESIRED: compute what the value of the attack is, without performing the attack.  Accounts
@@ -169,6 +168,8 @@ F32 BMC_AI::ScoreAttack(BMC_Game *_game, BMC_Move &_move)
 
 	BMC_Game	sim(true);
 	sim = *_game;
+	sim.SetSimulation(true);
+	sim.GetRNG().SetStream(_game->GetRNG().GetRand64());
 	bool extra_turn = false;
 	sim.SimulateAttack(_move, extra_turn);
 	return sim.GetPhasePlayer()->GetScore() - sim.GetTargetPlayer()->GetScore();
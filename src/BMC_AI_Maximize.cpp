@@ -50,7 +50,5 @@ void BMC_AI_Maximize::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 		}
 	}
 
-	best_move->m_game = _game;
-
 	_move = *best_move;
 }
@@ -9,6 +9,7 @@
 //
 // REVISION HISTORY:
 // dbl100824 - migrated this logic from bmai_ai.cpp
+// dbl101626 - use the game's RNG
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BMC_AI_MaximizeOrRandom.h"
@@ -19,7 +20,7 @@
 
 void BMC_AI_MaximizeOrRandom::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 {
-	if (g_rng.GetFRand()<p)
+	if (_game->GetRNG().GetFRand()<p)
 		m_ai_mode1.GetAttackAction(_game, _move);
 	else
 		m_ai_mode0.GetAttackAction(_game, _move);
@@ -9,6 +9,10 @@
 //
 // REVISION HISTORY:
 // dbl100824 - migrated this logic from bmai_ai.cpp
+// dbl101626 - sm_level is per-thread
+// dbl101626 - each simulation forks its own RNG stream from the game being evaluated
+// dbl101626 - once IsOutOfTime(), simulations use QAI as if at max ply
+// dbl101626 - ComputeNumberSims() for a given level and decay, used by autoply
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BMC_BMAI.h"
@@ -20,7 +24,7 @@
 
 // HACK: sm_level should be automatically updated in all eval methods, but it is currently only updated
 // by proper use of OnStartEvaluation() and OnEndEvaluation() which BMAI and BMAI3 are trusted to call.
-INT BMC_BMAI::sm_level = 0;
+thread_local INT BMC_BMAI::sm_level = 0;
 
 // only output certain debug strings when 'sm_level' is <= to this. Trusts AI classes to use before calling Log().
 INT BMC_BMAI::sm_debug_level = 2;		// default so only up to level 2 is output
@@ -35,6 +39,7 @@ BMC_BMAI::BMC_BMAI(BMC_AI * _ai) : m_qai(_ai)
 	m_max_branch = 5000;
 	m_max_sims = BMD_DEFAULT_SIMS;
 	m_min_sims = BMD_MIN_SIMS;
+	m_ply_decay = s_ply_decay;
 }
 
 // DESC: every AI action increments level to represent recursive depth in BMAI evaluations.  Level is
@@ -60,8 +65,8 @@ void BMC_BMAI::OnEndEvaluation(BMC_Game *_game, INT _enter_level)
 	if (!_game->IsSimulation())
 		sm_level = _enter_level;
 
-	// In a simulation game, if level has gone past max_ply, ensure BMAI is not called further
-	else if (sm_level>=m_max_ply)
+	// In a simulation game, if level has gone past max_ply (or time is up), ensure BMAI is not called further
+	else if (sm_level>=m_max_ply || IsOutOfTime())
 	{
 		INT pl;
 		for (pl=0; pl<2; pl++)
@@ -70,15 +75,15 @@ void BMC_BMAI::OnEndEvaluation(BMC_Game *_game, INT _enter_level)
 #endif
 }
 
-// DESC: if level has gone past max_ply, then ensure BMAI is not used in this simulation.  Otherwise, ensure to
-// continue to use BMAI.
+// DESC: if level has gone past max_ply, or time is up, then ensure BMAI is not used in this simulation.  Otherwise,
+// ensure to continue to use BMAI.
 void BMC_BMAI::OnPreSimulation(BMC_Game &_sim)
 {
 	BM_ASSERT(_sim.IsSimulation());
 
 	// use QAI for later actions
 	INT p;
-	if (sm_level >= m_max_ply)
+	if (sm_level >= m_max_ply || IsOutOfTime())
 	{
 		g_stats.OnFullSimulation();
 		for (p=0; p<2; p++)
@@ -107,7 +112,13 @@ void BMC_BMAI::OnPostSimulation(BMC_Game *_game, INT _enter_level)
 // PRE: must have called OnStartEvaluation so that sm_level is updated
 INT BMC_BMAI::ComputeNumberSims(INT _moves)
 {
-	float decay_factor = (float)pow(s_ply_decay, sm_level-1);
+	return ComputeNumberSims(_moves, sm_level, m_ply_decay);
+}
+
+// DESC: as above, for an action at _level (1 at the root) if sims were scaled by _decay per ply
+INT BMC_BMAI::ComputeNumberSims(INT _moves, INT _level, float _decay)
+{
+	float decay_factor = (float)pow(_decay, _level-1);
 	INT sims = (INT)(m_max_branch * decay_factor / (float)_moves);
 
 	int adjusted_min_sims = (int)(m_min_sims * decay_factor + 0.99f);
@@ -153,13 +164,15 @@ void BMC_BMAI::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 		}
 
 		g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d m%d: ", sm_level, _game->GetPhasePlayerID(), i);
-		attack->Debug(BME_DEBUG_SIMULATION);
+		attack->Debug(_game, BME_DEBUG_SIMULATION);
 
 		score = 0;
 		for (s=0; s<sims; s++)
 		{
-			//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug();
+			//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug(_game);
 			sim = *_game;
+			sim.SetSimulation(true);
+			sim.GetRNG().SetStream(_game->GetRNG().GetRand64());
 
 			OnPreSimulation(sim);
 			BME_WLT rv = sim.PlayRound(attack);
@@ -173,7 +186,7 @@ void BMC_BMAI::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 		}
 
 		g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d m%d: score %.1f - ", sm_level, _game->GetPhasePlayerID(), i, score);
-		attack->Debug(BME_DEBUG_SIMULATION);
+		attack->Debug(_game, BME_DEBUG_SIMULATION);
 
 		//printf("l%d p%d m%d score %f\n", sm_level, _game->GetPhasePlayerID(), i, score);
 		if (!best_move || score > best_score)
@@ -188,8 +201,7 @@ void BMC_BMAI::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 		_game->GetPhasePlayerID(),
 		best_score,
 		best_score / sims * 100);
-	best_move->m_game = _game;
-	best_move->Debug(BME_DEBUG_SIMULATION);
+	best_move->Debug(_game, BME_DEBUG_SIMULATION);
 
 	OnEndEvaluation(_game, enter_level);
 
@@ -211,7 +223,6 @@ void BMC_BMAI::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 	INT				combinations = 1;
 	INT i, s, p;
 
-	_move.m_game = _game;
 	_move.m_action = BME_ACTION_SET_SWING_AND_OPTION;
 
 	BMC_Player *pl = _game->GetPhasePlayer();
@@ -275,8 +286,10 @@ void BMC_BMAI::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 			score = 0;
 			for (s=0; s<sims; s++)
 			{
-				//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug();
+				//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug(_game);
 				sim = *_game;
+				sim.SetSimulation(true);
+				sim.GetRNG().SetStream(_game->GetRNG().GetRand64());
 
 				OnPreSimulation(sim);
 
@@ -294,7 +307,7 @@ void BMC_BMAI::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 			if (enter_level<sm_debug_level)
 			{
 				g_logger.Log(BME_DEBUG_SIMULATION, "swing sims over - score %.1f - ", score);
-				_move.Debug(BME_DEBUG_SIMULATION);
+				_move.Debug(_game, BME_DEBUG_SIMULATION);
 			}
 
 			//printf("l%d p%d m%d score %f\n", sm_level, _game->GetPhasePlayerID(), i, score);
@@ -352,8 +365,7 @@ void BMC_BMAI::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 			_game->GetPhasePlayerID(),
 			best_score,
 			best_score / sims * 100);
-		best_move.m_game = _game;
-		best_move.Debug(BME_DEBUG_SIMULATION);
+		best_move.Debug(_game, BME_DEBUG_SIMULATION);
 	}
 
 	OnEndEvaluation(_game, enter_level);
@@ -363,7 +375,6 @@ void BMC_BMAI::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 
 void BMC_BMAI::GetReserveAction(BMC_Game *_game, BMC_Move &_move)
 {
-	_move.m_game = _game;
 	_move.m_action = BME_ACTION_USE_RESERVE;
 
 	BMC_Player *p = _game->GetPhasePlayer();
@@ -400,8 +411,10 @@ void BMC_BMAI::GetReserveAction(BMC_Game *_game, BMC_Move &_move)
 		score = 0;
 		for (s=0; s<sims; s++)
 		{
-			//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug();
+			//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug(_game);
 			sim = *_game;
+			sim.SetSimulation(true);
+			sim.GetRNG().SetStream(_game->GetRNG().GetRand64());
 
 			OnPreSimulation(sim);
 			sim.ApplyUseReserve(_move);
@@ -418,7 +431,7 @@ void BMC_BMAI::GetReserveAction(BMC_Game *_game, BMC_Move &_move)
 		if (enter_level<sm_debug_level)
 		{
 			g_logger.Log(BME_DEBUG_SIMULATION, "reserve sims over - score %.1f - ", score);
-			_move.Debug(BME_DEBUG_SIMULATION);
+			_move.Debug(_game, BME_DEBUG_SIMULATION);
 		}
 
 		//printf("l%d p%d m%d score %f\n", sm_level, _game->GetPhasePlayerID(), i, score);
@@ -438,8 +451,10 @@ void BMC_BMAI::GetReserveAction(BMC_Game *_game, BMC_Move &_move)
 	score = 0;
 	for (s=0; s<sims; s++)
 	{
-		//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug();
+		//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug(_game);
 		sim = *_game;
+		sim.SetSimulation(true);
+		sim.GetRNG().SetStream(_game->GetRNG().GetRand64());
 
 		OnPreSimulation(sim);
 		sim.ApplyUseReserve(_move);
@@ -456,7 +471,7 @@ void BMC_BMAI::GetReserveAction(BMC_Game *_game, BMC_Move &_move)
 	if (enter_level<sm_debug_level)
 	{
 		g_logger.Log(BME_DEBUG_SIMULATION, "reserve pass sims over - score %.1f - ", score);
-		_move.Debug(BME_DEBUG_SIMULATION);
+		_move.Debug(_game, BME_DEBUG_SIMULATION);
 	}
 
 	//printf("l%d p%d m%d score %f\n", sm_level, _game->GetPhasePlayerID(), i, score);
@@ -471,8 +486,7 @@ void BMC_BMAI::GetReserveAction(BMC_Game *_game, BMC_Move &_move)
 		_game->GetPhasePlayerID(),
 		best_score,
 		best_score / sims * 100);
-	best_move.m_game = _game;
-	best_move.Debug(BME_DEBUG_SIMULATION);
+	best_move.Debug(_game, BME_DEBUG_SIMULATION);
 
 	OnEndEvaluation(_game, enter_level);
 
@@ -484,8 +498,6 @@ void BMC_BMAI::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 {
 	BM_ASSERT(_game->GetPhase() == BME_PHASE_INITIATIVE_FOCUS);
 
-	_move.m_game = _game;
-
 	//BMC_Player *p = _game->GetPhasePlayer();
 
 	BMC_MoveList	movelist;
@@ -507,14 +519,16 @@ void BMC_BMAI::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 	{
 		BMC_Move * move = movelist.Get(i);
 
-		BMF_Log(BME_DEBUG_SIMULATION, "l%d p%d focus: ", sm_level, _game->GetPhasePlayerID()); move->Debug();
+		BMF_Log(BME_DEBUG_SIMULATION, "l%d p%d focus: ", sm_level, _game->GetPhasePlayerID()); move->Debug(_game);
 
 		// evaluate action
 		score = 0;
 		for (s=0; s<sims; s++)
 		{
-			//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug();
+			//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug(_game);
 			sim = *_game;
+			sim.SetSimulation(true);
+			sim.GetRNG().SetStream(_game->GetRNG().GetRand64());
 
 			OnPreSimulation(sim);
 			sim.ApplyUseFocus(*move);
@@ -531,7 +545,7 @@ void BMC_BMAI::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 		if (enter_level<sm_debug_level)
 		{
 			g_logger.Log(BME_DEBUG_SIMULATION, "focus sims over - score %.1f - ", score);
-			move->Debug(BME_DEBUG_SIMULATION);
+			move->Debug(_game, BME_DEBUG_SIMULATION);
 		}
 
 		//printf("l%d p%d m%d score %f\n", sm_level, _game->GetPhasePlayerID(), i, score);
@@ -548,8 +562,7 @@ void BMC_BMAI::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 		_game->GetPhasePlayerID(),
 		best_score,
 		best_score / sims * 100);
-	best_move->m_game = _game;
-	best_move->Debug(BME_DEBUG_SIMULATION);
+	best_move->Debug(_game, BME_DEBUG_SIMULATION);
 	}
 
 	OnEndEvaluation(_game, enter_level);
@@ -562,8 +575,6 @@ void BMC_BMAI::GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
 {
 	BM_ASSERT(_game->GetPhase() == BME_PHASE_INITIATIVE_CHANCE);
 
-	_move.m_game = _game;
-
 	BMC_Player *p = _game->GetPhasePlayer();
 
 	INT			i,s,j;
@@ -613,14 +624,16 @@ void BMC_BMAI::GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
 			}
 		}
 
-		BMF_Log(BME_DEBUG_SIMULATION, "l%d chance mask %x: ", sm_level, i); _move.Debug();
+		BMF_Log(BME_DEBUG_SIMULATION, "l%d chance mask %x: ", sm_level, i); _move.Debug(_game);
 
 		// evaluate action
 		score = 0;
 		for (s=0; s<sims; s++)
 		{
-			//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug();
+			//BMF_Log(BME_DEBUG_SIMULATION, "l%d m%d sim #%d: ", sm_level, i, s);	attack->Debug(_game);
 			sim = *_game;
+			sim.SetSimulation(true);
+			sim.GetRNG().SetStream(_game->GetRNG().GetRand64());
 
 			OnPreSimulation(sim);
 			sim.ApplyUseChance(_move);
@@ -637,7 +650,7 @@ void BMC_BMAI::GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
 		if (enter_level<sm_debug_level)
 		{
 			g_logger.Log(BME_DEBUG_SIMULATION, "chance sims over - score %.1f - ", score);
-			_move.Debug(BME_DEBUG_SIMULATION);
+			_move.Debug(_game, BME_DEBUG_SIMULATION);
 		}
 
 		//printf("l%d p%d m%d score %f\n", sm_level, _game->GetPhasePlayerID(), i, score);
@@ -652,8 +665,7 @@ void BMC_BMAI::GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
 		_game->GetPhasePlayerID(),
 		best_score,
 		best_score / sims * 100);
-	best_move.m_game = _game;
-	best_move.Debug(BME_DEBUG_SIMULATION);
+	best_move.Debug(_game, BME_DEBUG_SIMULATION);
 
 	OnEndEvaluation(_game, enter_level);
 
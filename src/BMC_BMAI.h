@@ -10,6 +10,9 @@
 // REVISION HISTORY:
 // drp030321 - partial split out to individual headers
 // dbl100824 - migrated this logic from bmai_ai.h
+// dbl101626 - sm_level is per-thread for parallel simulations
+// dbl101626 - IsOutOfTime() hook, simulations past the deadline fall back to QAI
+// dbl101626 - per-AI ply decay, ComputeNumberSims() for any level
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
@@ -40,6 +43,7 @@ public:
 	void		SetMaxBranch(INT _m) { m_max_branch = _m; }
 	void		SetMaxSims(INT _s)	{m_max_sims = _s; }
 	void		SetMinSims(INT _s)	{m_min_sims = _s; }
+	void		SetPlyDecay(float _d) { m_ply_decay = _d; }
 	void		CopySettings(BMC_BMAI & _ai) { m_max_ply = _ai.GetMaxPly(); m_max_branch = _ai.GetMaxBranch(); }
 
 	// static mutators
@@ -53,12 +57,15 @@ public:
 	INT			GetMaxBranch() { return m_max_branch; }
 	INT			GetMaxSims() { return m_max_sims; }
 	INT			GetMinSims() { return m_min_sims; }
+	float		GetPlyDecay() { return m_ply_decay; }
 	INT			GetLevel() { return sm_level; }
+	virtual bool	IsOutOfTime() { return false; }
 
 protected:
 
 	// determining number of sims to use
 	INT			ComputeNumberSims(INT _moves);
+	INT			ComputeNumberSims(INT _moves, INT _level, float _decay);
 
 	// for dealing with 'level'
 	void		OnStartEvaluation(BMC_Game *_game, INT &_enter_level);
@@ -70,9 +77,11 @@ protected:
 	INT			m_max_ply;
 	INT			m_max_branch;
 	INT			m_min_sims, m_max_sims;
+	float		m_ply_decay;		// sims are scaled by this for each ply below the first [default s_ply_decay]
 
-	// static data to prevent too many BMAI calls in simulation depth
-	static int	sm_level;
+	// static data to prevent too many BMAI calls in simulation depth.  Per-thread since each
+	// parallel worker runs its own simulation stack.
+	static thread_local int	sm_level;
 	static int	sm_debug_level;
 
 };
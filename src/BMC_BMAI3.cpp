@@ -11,21 +11,74 @@
 // drp033102 - added BMAI2 which iteratively runs simulations across all moves and culls moves based on an
 //			   interpolated score threshold (vs the best move).  This allows the ply to be increased to 3. Replaced 'g_ai'
 // dbl100824 - migrated this logic from bmai_ai.cpp
+// dbl101626 - moved the per-move simulation loop into SimulateMoves() so a pass can be split across the thread pool
+// dbl101626 - simulations are keyed RNG streams, so results do not depend on the number of threads
+// dbl101626 - added RaceMoves(), a cull based on confidence bounds of each move's mean
+// dbl101626 - added EvaluateAttackAction(), which probes the transposition table before searching
+// dbl101626 - time limit: every loop stops at the deadline and returns its best move so far
+// dbl101626 - autoply: SelectPly() fits ply and ply decay to a rollout or time budget
+// dbl101626 - common random numbers: GetSimulationKey() can ignore the move
+// dbl101626 - quasi-random mode for the first die rolls, SimulateMove() takes the think state
+// dbl101626 - control variate mode, ApplyControlVariate()
+// dbl101626 - GetAttackAction() uses the endgame solver when the fight is small enough
+// dbl101626 - rollouts ended by the tablebase score its exact value
+// dbl101626 - GetSetSwingEquilibrium(): simultaneous swing setting as a matrix game
+// dbl101626 - GetSetSwingAction() answers from the opening book at the root
+// dbl101626 - ScoreLeaf(): max ply scores from rollouts, a leaf evaluator, or a mix
+// dbl101626 - history heuristic: SimulateMoves() runs moves in history order and stops a move once IsCertainCull()
+// dbl101626 - PreCullMoves(): keep the attacks with the best ScoreAttack() before simulating
+// dbl101626 - ForkMoves(): apply each attack's deterministic step once, and start its sims from there
+// dbl101626 - parallel workers are made once per root action (CreateWorkers()), not per batch
+// dbl101626 - transposition table: new generation per root action, serial searches only, no stores out of time
+// dbl101626 - the time limit is checked before every sim, and a batch the deadline cuts short is dropped
+// dbl101626 - control variate: the best move is picked again after every batch, racing uses the raw sums
+// dbl101626 - transposition table: inner searches draw their stream from the state key, so it is shared by all threads
+// dbl101626 - GetSetSwingEquilibrium(): check the deadline after every cell
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BMC_BMAI3.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
 #include "BMC_Logger.h"
 #include "BMC_RNG.h"
 #include "BMC_Stats.h"
+#include "BMC_ThreadPool.h"
+#include "BMC_TransTable.h"
 
 
+// history table, per thread like g_stats
+thread_local float BMC_BMAI3::sm_history[BME_ATTACK_MAX][BMD_HISTORY_SIDES][BMD_HISTORY_SIDES];
+
 BMC_BMAI3::BMC_BMAI3(BMC_AI * _ai): BMC_BMAI(_ai)
 {
 	// SETTINGS
 	m_sims_per_check = m_min_sims;
 	m_min_best_score_threshold = 0.25f;
 	m_max_best_score_threshold = 0.90f;
+	m_racing_delta = 0;
+	m_common_random = false;
+	m_quasi_random = false;
+	m_control_variate = false;
+	m_swing_equilibrium = false;
+	m_opening_book = NULL;
+	m_evaluator = NULL;
+	m_evaluator_mix = 0;
+	m_history = false;
+	m_precull_keep = 0;
+	m_precull_sample = 0;
+	m_precull_margin = 0;
+	m_last_sims = 0;
+	m_time_limit = 0;
+	m_auto_ply = 0;
+	m_auto_sims = 0;
+	m_saved_ply = m_max_ply;
+	m_saved_decay = m_ply_decay;
 
 	//m_min_best_score_points_threshold =
 	//m_max_best_score_points_threshold =
@@ -38,8 +91,6 @@ void BMC_BMAI3::GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
 
 	m_last_probability_win = 1000;
 
-	_move.m_game = _game;
-
 	// build movelist
 	BMC_MoveList	movelist;
 	_game->GenerateValidChance(movelist);
@@ -55,54 +106,23 @@ void BMC_BMAI3::GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
 
 	INT enter_level;
 	OnStartEvaluation(_game, enter_level);
+	OnStartAction(_game, movelist);
 
-	INT i, s;
-	BMC_Game	sim(true);
+	INT i;
 	BMC_ThinkState	t(this,_game,movelist);
 
 	while (t.sims_run < t.sims)
 	{
-		int check_sims = std::min(m_sims_per_check, (t.sims-t.sims_run));
+		int check_sims = SimulateMoves(t, GetCheckSims(t), enter_level);
 
 		for (i=0; i<movelist.Size(); i++)
 		{
 			BMC_Move * move = movelist.Get(i);
 
-			BMF_Log(BME_DEBUG_SIMULATION, "l%d p%d chance: ", sm_level, _game->GetPhasePlayerID()); move->Debug();
-
-			// evaluate action
-			for (s=0; s<check_sims; s++)
-			{
-				sim = *_game;
-				OnPreSimulation(sim);
-				sim.ApplyUseChance(*move);
-
-				// at max_ply, play the game out and score it as "win/tie/loss" (1/0.5/0)
-				if (sm_level >= m_max_ply)
-				{
-					BME_WLT rv = sim.PlayRound(NULL);
-
-					// reverse score if this is player 1, since WLT is wrt player 0
-					if (rv==BME_WLT_TIE)
-						t.score[i] += 0.5f;
-					else if ((rv==BME_WLT_WIN) ^ (_game->GetPhasePlayerID()!=0))
-						t.score[i] += 1.0f;
-				}
-
-				// before max_ply, the next "GetAction" will be BMAI3.  Use "PlayFight_EvaluateMove" to simply play to that
-				// move and then use its estimate of winning chances as a more accurate score.
-				else
-					t.score[i] += sim.PlayRound_EvaluateMove(_game->GetPhasePlayerID());
-
-				OnPostSimulation(_game, enter_level);
-			}
-
-			move->m_game = _game;
-
 			if (enter_level<sm_debug_level)
 			{
-				g_logger.Log(BME_DEBUG_SIMULATION, "chance sims over - score %.1f - ", t.score[i]);
-				move->Debug(BME_DEBUG_SIMULATION);
+				g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d chance sims over - score %.1f - ", sm_level, _game->GetPhasePlayerID(), t.score[i]);
+				move->Debug(_game, BME_DEBUG_SIMULATION);
 			}
 
 			if (t.score[i] > t.best_score)
@@ -112,7 +132,7 @@ void BMC_BMAI3::GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
 
 		t.sims_run += check_sims;
 
-		if (t.sims_run >= t.sims)
+		if (t.sims_run >= t.sims || IsOutOfTime())
 			break;
 
 		if (!CullMoves(t))
@@ -124,10 +144,10 @@ void BMC_BMAI3::GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
 		_game->GetPhasePlayerID(),
 		t.best_score,
 		t.best_score / t.sims_run * 100);
-	t.best_move->m_game = _game;
-	t.best_move->Debug(BME_DEBUG_SIMULATION);
+	t.best_move->Debug(_game, BME_DEBUG_SIMULATION);
 
 	OnEndEvaluation(_game, enter_level);
+	OnEndAction(_game);
 
 	_move = *t.best_move;
 	m_last_probability_win = t.best_score / t.sims_run;
@@ -141,8 +161,6 @@ void BMC_BMAI3::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 
 	m_last_probability_win = 1000;
 
-	_move.m_game = _game;
-
 	BMC_MoveList	movelist;
 	_game->GenerateValidFocus(movelist);
 
@@ -157,15 +175,15 @@ void BMC_BMAI3::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 
 	INT enter_level;
 	OnStartEvaluation(_game, enter_level);
+	OnStartAction(_game, movelist);
 
-	INT i, s;
+	INT i;
 	INT pass = 0;
-	BMC_Game	sim(true);
 	BMC_ThinkState	t(this,_game,movelist);
 
 	while (t.sims_run < t.sims)
 	{
-		int check_sims = std::min(m_sims_per_check, (t.sims-t.sims_run));
+		int check_sims = SimulateMoves(t, GetCheckSims(t), enter_level);
 
 		for (i=0; i<movelist.Size(); i++)
 		{
@@ -173,46 +191,11 @@ void BMC_BMAI3::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 
 			if (enter_level<sm_debug_level)
 			{
-			BMF_Log(BME_DEBUG_SIMULATION, "%sl%d p%d focus: ",
-				pass>0 ? "+ " : "",
-				sm_level, _game->GetPhasePlayerID()); move->Debug();
-			}
-
-			// evaluate action
-			for (s=0; s<check_sims; s++)
-			{
-				sim = *_game;
-				OnPreSimulation(sim);
-				sim.ApplyUseFocus(*move);
-
-				// at max_ply, play the game out and score it as "win/tie/loss" (1/0.5/0)
-				if (sm_level >= m_max_ply)
-				{
-					BME_WLT rv = sim.PlayRound(NULL);
-
-					// reverse score if this is player 1, since WLT is wrt player 0
-					if (rv==BME_WLT_TIE)
-						t.score[i] += 0.5f;
-					else if ((rv==BME_WLT_WIN) ^ (_game->GetPhasePlayerID()!=0))
-						t.score[i] += 1.0f;
-				}
-
-				// before max_ply, the next "GetAction" will be BMAI3.  Use "PlayFight_EvaluateMove" to simply play to that
-				// move and then use its estimate of winning chances as a more accurate score.
-				else
-					t.score[i] += sim.PlayRound_EvaluateMove(_game->GetPhasePlayerID());
-
-				OnPostSimulation(_game, enter_level);
-			}
-
-			move->m_game = _game;
-
-			if (enter_level<sm_debug_level)
-			{
-				g_logger.Log(BME_DEBUG_SIMULATION, "%sfocus sims over - score %.1f - ",
+				g_logger.Log(BME_DEBUG_SIMULATION, "%sl%d p%d focus sims over - score %.1f - ",
 					pass>0 ? "+ " : "",
+					sm_level, _game->GetPhasePlayerID(),
 					t.score[i]);
-				move->Debug(BME_DEBUG_SIMULATION);
+				move->Debug(_game, BME_DEBUG_SIMULATION);
 			}
 
 			if (t.score[i] > t.best_score)
@@ -222,7 +205,7 @@ void BMC_BMAI3::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 
 		t.sims_run += check_sims;
 
-		if (t.sims_run >= t.sims)
+		if (t.sims_run >= t.sims || IsOutOfTime())
 			break;
 
 		if (!CullMoves(t))
@@ -238,11 +221,11 @@ void BMC_BMAI3::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 		_game->GetPhasePlayerID(),
 		t.best_score,
 		t.best_score / t.sims_run * 100);
-	t.best_move->m_game = _game;
-	t.best_move->Debug(BME_DEBUG_SIMULATION);
+	t.best_move->Debug(_game, BME_DEBUG_SIMULATION);
 	}
 
 	OnEndEvaluation(_game, enter_level);
+	OnEndAction(_game);
 
 	_move = *t.best_move;
 	m_last_probability_win = t.best_score / t.sims_run;
@@ -250,7 +233,7 @@ void BMC_BMAI3::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
 
 // POST: movelist randomly cut down to the given _max.
 // NOTE: it retains setswing moves that use the extreme values
-void BMC_BMAI3::RandomlySelectMoves(BMC_MoveList &_list, int _max)
+void BMC_BMAI3::RandomlySelectMoves(BMC_Game *_game, BMC_MoveList &_list, int _max)
 {
 	int m, i;
 	int swing_dice = 0;
@@ -262,7 +245,7 @@ void BMC_BMAI3::RandomlySelectMoves(BMC_MoveList &_list, int _max)
 			continue;
 
 		// compute the number of swing dice set to the extreme values
-		BMC_Player *pl = move->m_game->GetPhasePlayer();
+		BMC_Player *pl = _game->GetPhasePlayer();
 		move->m_extreme_settings = 0;
 		swing_dice = 0;	// TODO: don't recompute every time
 		for (i=0; i<BME_SWING_MAX; i++)
@@ -307,10 +290,10 @@ void BMC_BMAI3::RandomlySelectMoves(BMC_MoveList &_list, int _max)
 	// of swing dice set to extreme
 	while (_list.Size() > _max)
 	{
-		int m = g_rng.GetRand(_list.Size());
+		int m = _game->GetRNG().GetRand(_list.Size());
 		BMC_Move *move = _list.Get(m);
 		float percentage_extreme = (float)move->m_extreme_settings / swing_dice;
-		float p = g_rng.GetFRand();
+		float p = _game->GetRNG().GetFRand();
 		if (p>=percentage_extreme)
 		{
 			_list.Remove(m);
@@ -328,11 +311,25 @@ void BMC_BMAI3::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 
 	BM_ASSERT(movelist.Size()>0);
 
+	// OPENING BOOK: only at the root, simulated players have other information
+	if (m_opening_book && !_game->IsSimulation() && m_opening_book->Probe(_game, _move, m_last_probability_win))
+	{
+		g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d SetSwing from book (%.1f%% win)\n", sm_level, _game->GetPhasePlayerID(),
+			m_last_probability_win * 100);
+		return;
+	}
+
+	// SWING EQUILIBRIUM: the opponent is setting swing at the same time
+	if (m_swing_equilibrium && movelist.Size()>1 && IsSimultaneousSetSwing(_game))
+	{
+		GetSetSwingEquilibrium(_game, movelist, _move);
+		return;
+	}
+
 	INT enter_level;
 	OnStartEvaluation(_game, enter_level);
 
-	INT i,s;
-	BMC_Game	sim(true);
+	INT i;
 
 	// drp022203 - if there are simply far too many moves then randomly cut out moves
 	//  (not the extreme values). [Gordo has over 570k setswing moves, 160 days on ply 4]
@@ -344,9 +341,10 @@ void BMC_BMAI3::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 			movelist.Size(),
 			m_max_moves);
 
-		RandomlySelectMoves(movelist, m_max_moves);
+		RandomlySelectMoves(_game, movelist, m_max_moves);
 	}
 
+	OnStartAction(_game, movelist);
 	BMC_ThinkState	t(this,_game,movelist);
 
 	g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d Valid SetSwing %d Sims %d\n", sm_level, _game->GetPhasePlayerID(),
@@ -355,72 +353,13 @@ void BMC_BMAI3::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 
 	while (t.sims_run < t.sims)
 	{
-		int check_sims = std::min(m_sims_per_check, (t.sims-t.sims_run));
+		int check_sims = SimulateMoves(t, GetCheckSims(t), enter_level);
 
 		for (i=0; i<movelist.Size(); i++)
 		{
 			BMC_Move * move = movelist.Get(i);
 			//BM_ASSERT(move->m_action == BME_ACTION_SET_SWING_AND_OPTION);
 
-			if (enter_level<sm_debug_level)
-			{
-				g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d - ",
-					sm_level,
-					_game->GetPhasePlayerID() );
-				move->Debug(BME_DEBUG_SIMULATION);
-			}
-
-			// try case
-			for (s=0; s<check_sims; s++)
-			{
-				sim = *_game;
-				OnPreSimulation(sim);
-
-				/*
-				// for max ply 3:
-					// at ply 1, set swing status to "READY" which means that, if our opponent hasn't set swing, then the
-					// opponent's GetSetSwingAction() will be done without the knowledge of what our swing action is.  This
-					// means the opponent will recursively call GetSetSwingAction() for us.  This is more realistic, since
-					// our move will then be the "counter-move" to the "safest opening move," instead of being the
-					// "safest opening move."  In Hope-Hope, if you know the other player's swing you have a 65% chance of winning.
-					// Of course, then someone could play one level ahead of BMAI and counter the counter to the safest...
-
-					// TODO: throw randomness in the mix
-					// NOTE:	Hope vs Hope	ply 2, without this, says	Y2-5, 35%
-					//							ply 2, with this			Y4, 40%
-					//							ply 3, without this
-					//							ply 3, with this			Y6, 75%
-
-				// we don't do this for max ply 2, since it would make the opponent assume we are using QAI to pick our swing
-				*/
-#ifdef _DEBUG
-				sim.ApplySetSwing(*move, sm_level>1);
-#else
-				sim.ApplySetSwing(*move);
-#endif
-
-				// at max_ply, play the game out and score it as "win/tie/loss" (1/0.5/0)
-				if (sm_level >= m_max_ply)
-				{
-					BME_WLT rv = sim.PlayRound(NULL);
-
-					// reverse score if this is player 1, since WLT is wrt player 0
-					if (rv==BME_WLT_TIE)
-						t.score[i] += 0.5f;
-					else if ((rv==BME_WLT_WIN) ^ (_game->GetPhasePlayerID()!=0))
-						t.score[i] += 1.0f;
-				}
-
-				// before max_ply, the next "GetAction" will be BMAI3.  Use "PlayFight_EvaluateMove" to simply play to that
-				// move and then use its estimate of winning chances as a more accurate score.
-				else
-					t.score[i] += sim.PlayRound_EvaluateMove(_game->GetPhasePlayerID());
-
-				OnPostSimulation(_game, enter_level);
-			}
-
-			move->m_game = _game;
-
 			if (enter_level<sm_debug_level)
 			{
 				g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d swing sims %d - score %.1f - ",
@@ -428,7 +367,7 @@ void BMC_BMAI3::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 					_game->GetPhasePlayerID(),
 					t.sims_run + check_sims,
 					t.score[i]);
-				move->Debug(BME_DEBUG_SIMULATION);
+				move->Debug(_game, BME_DEBUG_SIMULATION);
 				g_stats.DisplayStats();
 			}
 
@@ -440,7 +379,7 @@ void BMC_BMAI3::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 
 		t.sims_run += check_sims;
 
-		if (t.sims_run >= t.sims)
+		if (t.sims_run >= t.sims || IsOutOfTime())
 			break;
 
 		if (!CullMoves(t))
@@ -454,17 +393,187 @@ void BMC_BMAI3::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
 			_game->GetPhasePlayerID(),
 			t.best_score,
 			t.best_score / t.sims_run * 100);
-		t.best_move->m_game = _game;
-		t.best_move->Debug(BME_DEBUG_SIMULATION);
+		t.best_move->Debug(_game, BME_DEBUG_SIMULATION);
 	}
 
 	OnEndEvaluation(_game, enter_level);
+	OnEndAction(_game);
 
 	_move = *t.best_move;
 
 	m_last_probability_win = t.best_score / t.sims_run;
 }
 
+// RETURNS: true if the opponent has not set swing either, so neither player may know the other's choice
+bool BMC_BMAI3::IsSimultaneousSetSwing(BMC_Game *_game)
+{
+	BMC_Player *opponent = _game->GetPlayer(!_game->GetPhasePlayerID());
+	return opponent->GetSwingDiceSet()==BMC_Player::SWING_SET_NOT && opponent->NeedsSetSwing();
+}
+
+// DESC: simultaneous swing setting is a matrix game.  Every pair of our and the opponent's swing actions is scored
+// with the same sims (sim s of every cell uses one RNG stream), fictitious play finds a mixed equilibrium, and our
+// action is drawn from our equilibrium mix.  This replaces the nested opponent search of the SWING_SET_READY
+// approach, where every one of our sims ran a full GetSetSwingAction() for the opponent.
+void BMC_BMAI3::GetSetSwingEquilibrium(BMC_Game *_game, BMC_MoveList &_movelist, BMC_Move &_move)
+{
+	INT pov = _game->GetPhasePlayerID();
+	INT opp = !pov;
+
+	// the opponent's actions, from their point of view
+	BMC_Game		opp_view(true);
+	BMC_MoveList	opp_movelist;
+	opp_view = *_game;
+	opp_view.SetSimulation(true);
+	opp_view.SetPhasePlayer(opp);
+	opp_view.GenerateValidSetSwing(opp_movelist);
+
+	INT enter_level;
+	OnStartEvaluation(_game, enter_level);
+
+	// keep the matrix within maxbranch at min_sims per cell
+	INT max_moves = std::max(2, (INT)std::sqrt((float)m_max_branch / m_min_sims));
+	if (_movelist.Size() > max_moves)
+		RandomlySelectMoves(_game, _movelist, max_moves);
+	if (opp_movelist.Size() > max_moves)
+		RandomlySelectMoves(&opp_view, opp_movelist, max_moves);
+
+	OnStartAction(_game, _movelist);
+
+	INT		rows = _movelist.Size();
+	INT		cols = opp_movelist.Size();
+	INT		sims = ComputeNumberSims(rows * cols);
+	U64		decision = _game->GetRNG().GetRand64();
+	std::vector<float> payoff(rows * cols, 0);
+	std::vector<INT> cell_sims(rows * cols, 0);
+	BMC_Game sim(true);
+	INT		s, i, j;
+	INT		total = 0;
+	bool	stopped = false;
+
+	g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d SetSwing equilibrium %d x %d Sims %d\n", sm_level, pov, rows, cols, sims);
+
+	// a sweep of the matrix can take most of the time limit, so the deadline is checked after every cell
+	for (s=0; s<sims && !stopped; s++)
+	{
+		for (i=0; i<rows && !stopped; i++)
+		{
+			for (j=0; j<cols; j++)
+			{
+				sim = *_game;
+				sim.SetSimulation(true);
+				sim.GetRNG().SetStream(BMC_RNG::MakeKey(decision, 0, s));
+				OnPreSimulation(sim);
+				sim.ApplySetSwing(*_movelist.Get(i));
+				sim.SetPhasePlayer(opp);
+				sim.ApplySetSwing(*opp_movelist.Get(j));
+				sim.SetPhasePlayer(pov);
+
+				float score;
+				if (sm_level >= m_max_ply)
+					score = ScoreLeaf(sim, pov, NULL);
+				else
+					score = sim.PlayRound_EvaluateMove(pov);
+
+				payoff[i * cols + j] += score;
+				cell_sims[i * cols + j]++;
+				total++;
+				OnPostSimulation(_game, enter_level);
+
+				if (IsOutOfTime())
+				{
+					stopped = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// each cell is averaged over the sims it got.  A cell the deadline left without any gets the mean of the
+	// others, so it neither attracts nor repels the mixes.
+	float mean = 0;
+	for (i=0; i<rows * cols; i++)
+		mean += payoff[i];
+	mean /= total;
+	for (i=0; i<rows * cols; i++)
+		payoff[i] = cell_sims[i]>0 ? payoff[i] / cell_sims[i] : mean;
+
+	std::vector<float> row_mix, col_mix;
+	SolveMatrixGame(payoff, rows, cols, row_mix, col_mix);
+
+	// draw our action from the mix, on a stream of its own so the choice is reproducible
+	BMC_RNG rng;
+	rng.SetStream(BMC_RNG::MakeKey(decision, 1));
+	float r = rng.GetFRand();
+	INT choice = rows - 1;
+	for (i=0; i<rows; i++)
+	{
+		r -= row_mix[i];
+		if (r < 0)
+		{
+			choice = i;
+			break;
+		}
+	}
+
+	m_last_probability_win = 0;
+	for (i=0; i<rows; i++)
+	{
+		for (j=0; j<cols; j++)
+			m_last_probability_win += row_mix[i] * payoff[i * cols + j] * col_mix[j];
+
+		if (enter_level < sm_debug_level && row_mix[i] > 0)
+		{
+			g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d swing mix %.1f%% ", sm_level, pov, row_mix[i] * 100);
+			_movelist.Get(i)->Debug(_game, BME_DEBUG_SIMULATION);
+		}
+	}
+
+	if (enter_level < sm_debug_level)
+	{
+		g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d equilibrium swing (%.1f%% win) ", sm_level, pov, m_last_probability_win * 100);
+		_movelist.Get(choice)->Debug(_game, BME_DEBUG_SIMULATION);
+	}
+
+	OnEndEvaluation(_game, enter_level);
+	OnEndAction(_game);
+
+	_move = *_movelist.Get(choice);
+	m_last_sims = total;
+}
+
+// DESC: fictitious play on a zero-sum matrix game.  Each round both players best-respond to the other's empirical
+// mix so far; the empirical mixes converge to an equilibrium.
+// PARAM: _payoff[row * _cols + col] is the row player's payoff, which the column player minimizes
+// POST: _row_mix and _col_mix hold the equilibrium mixes
+void BMC_BMAI3::SolveMatrixGame(std::vector<float> &_payoff, INT _rows, INT _cols, std::vector<float> &_row_mix, std::vector<float> &_col_mix)
+{
+	std::vector<double> row_total(_rows, 0), col_total(_cols, 0);	// payoff of each pure action against the other's plays
+	std::vector<INT> row_count(_rows, 0), col_count(_cols, 0);
+	INT i, j, k;
+	INT row = 0, col = 0;
+
+	for (k=0; k<BMD_EQUILIBRIUM_ITERATIONS; k++)
+	{
+		row_count[row]++;
+		col_count[col]++;
+		for (j=0; j<_cols; j++)
+			col_total[j] += _payoff[row * _cols + j];
+		for (i=0; i<_rows; i++)
+			row_total[i] += _payoff[i * _cols + col];
+
+		row = (INT)(std::max_element(row_total.begin(), row_total.end()) - row_total.begin());
+		col = (INT)(std::min_element(col_total.begin(), col_total.end()) - col_total.begin());
+	}
+
+	_row_mix.resize(_rows);
+	_col_mix.resize(_cols);
+	for (i=0; i<_rows; i++)
+		_row_mix[i] = (float)row_count[i] / BMD_EQUILIBRIUM_ITERATIONS;
+	for (j=0; j<_cols; j++)
+		_col_mix[j] = (float)col_count[j] / BMD_EQUILIBRIUM_ITERATIONS;
+}
+
 
 // DESC: instead of running all simulations for each move one at a time, run a limited number of simulations for
 // all moves and cull out
@@ -473,15 +582,28 @@ void BMC_BMAI3::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 {
 	m_last_probability_win = 1000;
 
+	// small enough to solve exactly?
+	if (m_endgame.CanSolve(_game) && m_endgame.Solve(_game, _move, m_last_probability_win))
+	{
+		if (m_last_probability_win==0 && _game->IsSurrenderAllowed())
+			_move.m_action = BME_ACTION_SURRENDER;
+		m_last_sims = 0;
+		return;
+	}
+
 	BMC_MoveList	movelist;
 	_game->GenerateValidAttacks(movelist);
 
+	// sims per move are budgeted on all the attacks, so a precull saves the sims of the attacks it drops
 	INT enter_level;
+	INT generated = movelist.Size();
 	OnStartEvaluation(_game, enter_level);
+	PreCullMoves(_game, movelist, enter_level);
+	OnStartAction(_game, movelist);
 
-	INT i, s;
-	BMC_Game	sim(true);
-	BMC_ThinkState	t(this,_game,movelist);
+	INT i;
+	BMC_ThinkState	t(this,_game,movelist,generated);
+	ForkMoves(t);
 
 	if (enter_level < sm_debug_level)
 	{
@@ -492,51 +614,16 @@ void BMC_BMAI3::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 
 	while (t.sims_run < t.sims)
 	{
-		int check_sims = std::min(m_sims_per_check, (t.sims-t.sims_run));
+		int check_sims = SimulateMoves(t, GetCheckSims(t), enter_level);
 
 		for (i=0; i<movelist.Size(); i++)
 		{
 			BMC_MoveAttack * attack = movelist.Get(i);
-			/*
-			if (attack->m_action != BME_ACTION_ATTACK)
-			{
-				float score = _game->ConvertWLTToWinProbability();
-				t.SetBestMove(attack, t.score[i] + score * check_sims);
-				break;
-			}
-			*/
-
-			for (s=0; s<check_sims; s++)
-			{
-				sim = *_game;
-				OnPreSimulation(sim);
-
-				// at max_ply, play the game out and score it as "win/tie/loss" (1/0.5/0)
-				if (sm_level >= m_max_ply)
-				{
-					BME_WLT rv = sim.PlayRound(attack);
-
-					// reverse score if this is player 1, since WLT is wrt player 0
-					if (rv==BME_WLT_TIE)
-						t.score[i] += 0.5f;
-					else if ((rv==BME_WLT_WIN) ^ (_game->GetPhasePlayerID()!=0))
-						t.score[i] += 1.0f;
-				}
-
-				// before max_ply, the next "GetAction" will be BMAI3.  Use "PlayFight_EvaluateMove" to simply play to that
-				// move and then use its estimate of winning chances as a more accurate score.
-				else
-					t.score[i] += sim.PlayFight_EvaluateMove(_game->GetPhasePlayerID(),*attack);
-
-				OnPostSimulation(_game, enter_level);
-			}
-
-			attack->m_game = _game;
 
 			if (sm_level<=sm_debug_level)
 			{
 				g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d m%d sims %d score %f ", sm_level, _game->GetPhasePlayerID(), i, check_sims, t.score[i]);
-				attack->Debug(BME_DEBUG_SIMULATION);
+				attack->Debug(_game, BME_DEBUG_SIMULATION);
 				if (sm_level <=1 )
 					g_stats.DisplayStats();
 			}
@@ -547,13 +634,16 @@ void BMC_BMAI3::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 		}
 		t.sims_run += check_sims;
 
-		if (t.sims_run >= t.sims)
+		if (t.sims_run >= t.sims || IsOutOfTime())
 			break;
 
 		if (!CullMoves(t))
 			break;
 	}
 
+	if (m_history)
+		UpdateHistory(t, enter_level);
+
 	// SURRENDER: if best move is 0% win, then surrender
 	if (t.best_score==0 && _game->IsSurrenderAllowed())
 		t.best_move->m_action = BME_ACTION_SURRENDER;
@@ -565,38 +655,547 @@ void BMC_BMAI3::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 		_game->GetPhasePlayerID(),
 		t.best_score,
 		t.best_score / t.sims_run * 100);
-	t.best_move->m_game = _game;
-	t.best_move->Debug(BME_DEBUG_SIMULATION);
+	t.best_move->Debug(_game, BME_DEBUG_SIMULATION);
 	}
 
 	OnEndEvaluation(_game, enter_level);
+	OnEndAction(_game);
 
 	_move = *t.best_move;
 
 	m_last_probability_win = t.best_score / t.sims_run;
+	m_last_sims = t.sims_run;
+}
+
+// DESC: the phase player's winning probability from an inner-ply GetAttackAction().  The move itself is not
+// needed, so when the transposition table is on, a state already searched at this level reuses the old result.
+// The search then draws its RNG stream from the state's key instead of from the sim that reached it, so its result
+// only depends on the state.  Whichever sim or worker stores a state first, a hit returns what a miss would have
+// computed, and a seed gives the same decisions for any number of threads.  A search cut short by the time limit
+// is not stored.
+float BMC_BMAI3::EvaluateAttackAction(BMC_Game *_game)
+{
+	if (!g_ttable.IsEnabled())
+	{
+		BMC_Move move;
+		GetAttackAction(_game, move);
+		return m_last_probability_win;
+	}
+
+	// autoply picks the ply and decay per decision, and both change the result
+	UINT decay_bits;
+	std::memcpy(&decay_bits, &m_ply_decay, sizeof(decay_bits));
+	U64 key = BMC_RNG::MakeKey(_game->GetStateHash(), sm_level | (m_max_ply << 8), decay_bits);
+
+	float probability;
+	INT sims;
+	bool hit = g_ttable.Probe(key, probability, sims);
+	g_stats.OnTransTableProbe(hit);
+	if (hit)
+		return probability;
+
+	BMC_Move move;
+	_game->GetRNG().SetStream(key);
+	GetAttackAction(_game, move);
+
+	if (!IsOutOfTime())
+		g_ttable.Store(key, m_last_probability_win, m_last_sims);
+
+	return m_last_probability_win;
+}
+
+// DESC: at the root action (not a simulation), start the clock for m_time_limit, apply autoply, and start a new
+// transposition table generation, since the ply and settings of the old entries may no longer apply
+void BMC_BMAI3::OnStartAction(BMC_Game *_game, BMC_MoveList &_movelist)
+{
+	if (_game->IsSimulation())
+		return;
+
+	g_ttable.NewSearch();
+
+	m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_time_limit);
+
+	if (m_auto_ply>0)
+		SelectPly(_game, _movelist.Size());
+
+	// after SelectPly(), so the workers search to the chosen ply
+	if (g_pool.IsParallel())
+		CreateWorkers();
+}
+
+// DESC: at the end of the root action, release the parallel workers and restore the settings autoply changed
+void BMC_BMAI3::OnEndAction(BMC_Game *_game)
+{
+	if (_game->IsSimulation())
+		return;
+
+	m_workers.clear();
+
+	if (m_auto_ply<=0)
+		return;
+
+	m_max_ply = m_saved_ply;
+	m_ply_decay = m_saved_decay;
+}
+
+// DESC: autoply.  Pick the deepest ply (up to m_auto_ply, or BMD_MAX_PLY_PREROUND outside the fight) and then the
+// largest ply decay (halving from the configured one) whose estimated rollouts fit the budget.  The budget is the
+// 'time' limit at the measured rollout rate, or m_auto_sims if there is no limit.  A small endgame fight goes deep,
+// a big swing decision stays at ply 1.
+void BMC_BMAI3::SelectPly(BMC_Game *_game, INT _moves)
+{
+	// below this, nested plies are already down to one sim per move
+	static const float c_min_decay = 1.0f / 512;
+
+	m_saved_ply = m_max_ply;
+	m_saved_decay = m_ply_decay;
+
+	double budget = m_auto_sims;
+	if (m_time_limit>0)
+		budget = m_time_limit / 1000.0 * MeasureRolloutRate(_game);
+
+	INT max_ply = m_auto_ply;
+	if (_game->GetPhase()!=BME_PHASE_FIGHT && max_ply>BMD_MAX_PLY_PREROUND)
+		max_ply = BMD_MAX_PLY_PREROUND;
+
+	INT ply = 1;
+	float decay = m_saved_decay;
+	for (INT p=max_ply; p>1 && ply==1; p--)
+	{
+		for (float d=m_saved_decay; d>=c_min_decay; d*=0.5f)
+		{
+			if (EstimateRollouts(_game, _moves, p, d) <= budget)
+			{
+				ply = p;
+				decay = d;
+				break;
+			}
+		}
+	}
+
+	m_max_ply = ply;
+	m_ply_decay = decay;
+
+	g_logger.Log(BME_DEBUG_SIMULATION, "autoply: moves %d budget %.0f ply %d decay %.3f est %.0f\n",
+		_moves, budget, ply, decay, EstimateRollouts(_game, _moves, ply, decay));
+}
+
+// DESC: the rollouts a search to _ply would run without culling: the product of moves*sims over the plies, as in
+// the leaves estimate of BMC_Stats::DisplayStats().  Ply 1 uses the actual movelist.  Deeper plies use the average
+// moves seen at that ply so far, or else the root moves in a fight and BMD_AUTOPLY_MOVES outside it.
+double BMC_BMAI3::EstimateRollouts(BMC_Game *_game, INT _moves, INT _ply, float _decay)
+{
+	double rollouts = 1;
+
+	for (INT level=1; level<=_ply; level++)
+	{
+		INT moves = _moves;
+		if (level>1)
+		{
+			float seen = g_stats.GetAverageMoves(level);
+			if (seen>0)
+				moves = (INT)(seen + 0.5f);
+			else if (_game->GetPhase()!=BME_PHASE_FIGHT)
+				moves = BMD_AUTOPLY_MOVES;
+		}
+		if (moves<1)
+			moves = 1;
+
+		rollouts *= (double)moves * ComputeNumberSims(moves, level, _decay);
+	}
+
+	return rollouts;
+}
+
+// RETURNS: QAI rollouts per second from this position, timed over BMD_AUTOPLY_RATE_SIMS rollouts
+double BMC_BMAI3::MeasureRolloutRate(BMC_Game *_game)
+{
+	BMC_Game	sim(true);
+	U64			hash = _game->GetStateHash();
+	auto		start = std::chrono::steady_clock::now();
+
+	for (INT r=0; r<BMD_AUTOPLY_RATE_SIMS; r++)
+	{
+		sim = *_game;
+		sim.SetSimulation(true);
+		sim.GetRNG().SetStream(BMC_RNG::MakeKey(hash, r));
+		sim.SetAI(0, m_qai);
+		sim.SetAI(1, m_qai);
+		sim.PlayRound(NULL);
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return BMD_AUTOPLY_RATE_SIMS / std::max(seconds, 1e-6);
+}
+
+// DESC: checked cooperatively before every sim, at every level.  Once it is true, each loop drops the batch it is
+// in and stops with its best move so far, and the remaining sims are played out by QAI.
+bool BMC_BMAI3::IsOutOfTime()
+{
+	return m_time_limit > 0 && std::chrono::steady_clock::now() >= m_deadline;
+}
+
+// DESC: sims to run in the next batch of the _t loop.  Past the deadline, nested searches still need an estimate,
+// so they get one (QAI) sim per move.
+INT BMC_BMAI3::GetCheckSims(BMC_ThinkState &_t)
+{
+	if (IsOutOfTime())
+		return 1;
+
+	return std::min(m_sims_per_check, (_t.sims-_t.sims_run));
+}
+
+// DESC: RNG stream for sim _s (counted from the start of the decision) of move _i in the movelist.  With common
+// random numbers, sim _s of every move uses the same stream, so moves are compared on the same dice luck (as far
+// as they roll the same dice in the same order) and the difference between their scores has less noise.
+U64 BMC_BMAI3::GetSimulationKey(BMC_ThinkState &_t, INT _i, INT _s)
+{
+	if (m_common_random)
+		return BMC_RNG::MakeKey(_t.decision, 0, _s);
+
+	return BMC_RNG::MakeKey(_t.decision, _t.move_index[_i], _s);
+}
+
+// DESC: run simulation _s (counted from the start of the decision) of move _i and score it for the phase player
+// PARAM: _sim is scratch space for the simulation
+// RETURNS: 1/0.5/0 at max ply, otherwise the winning probability estimated by the next BMAI3 action
+float BMC_BMAI3::SimulateMove(BMC_Game &_sim, BMC_ThinkState &_t, INT _i, INT _s, INT _enter_level)
+{
+	BMC_Game *	game = _t.game;
+	INT		pov = game->GetPhasePlayerID();
+	float	score = 0;
+
+	// work on a copy of the move, since applying an attack updates it
+	BMC_Move move = *_t.movelist.Get(_i);
+	bool	forked = !_t.fork.empty() && _t.fork[_i].applied;
+
+	_sim = forked ? _t.fork[_i].game : *game;
+	_sim.SetSimulation(true);
+	_sim.GetRNG().SetStream(GetSimulationKey(_t, _i, _s));
+	// QMC: the sims of a move share one randomized sequence, so its key is the simulation key without the sim
+	if (m_quasi_random)
+		_sim.GetRNG().SetQuasiRandom(BMC_RNG::MakeKey(_t.decision, m_common_random ? 0 : _t.move_index[_i]), _s, BMD_QMC_DIMS);
+	if (m_control_variate)
+		_sim.GetRNG().TrackLuck(GetRerolledDice(game, move));
+	if (forked)
+		move = _t.fork[_i].move;
+	OnPreSimulation(_sim);
+
+	switch (game->GetPhase())
+	{
+	case BME_PHASE_FIGHT:
+		// at max_ply, score the round from here (see ScoreLeaf())
+		if (sm_level >= m_max_ply || IsOutOfTime())
+			score = ScoreLeaf(_sim, pov, &move, forked);
+
+		// before max_ply, the next "GetAction" will be BMAI3.  Use "PlayFight_EvaluateMove" to simply play to that
+		// move and then use its estimate of winning chances as a more accurate score.
+		else
+			score = _sim.PlayFight_EvaluateMove(pov, move, forked);
+
+		OnPostSimulation(game, _enter_level);
+		return score;
+
+	case BME_PHASE_PREROUND:
+		/*
+		// for max ply 3:
+			// at ply 1, set swing status to "READY" which means that, if our opponent hasn't set swing, then the
+			// opponent's GetSetSwingAction() will be done without the knowledge of what our swing action is.  This
+			// means the opponent will recursively call GetSetSwingAction() for us.  This is more realistic, since
+			// our move will then be the "counter-move" to the "safest opening move," instead of being the
+			// "safest opening move."  In Hope-Hope, if you know the other player's swing you have a 65% chance of winning.
+			// Of course, then someone could play one level ahead of BMAI and counter the counter to the safest...
+
+			// TODO: throw randomness in the mix
+			// NOTE:	Hope vs Hope	ply 2, without this, says	Y2-5, 35%
+			//							ply 2, with this			Y4, 40%
+			//							ply 3, without this
+			//							ply 3, with this			Y6, 75%
+
+		// we don't do this for max ply 2, since it would make the opponent assume we are using QAI to pick our swing
+		*/
+#ifdef _DEBUG
+		_sim.ApplySetSwing(move, sm_level>1);
+#else
+		_sim.ApplySetSwing(move);
+#endif
+		break;
+
+	case BME_PHASE_INITIATIVE_CHANCE:
+		_sim.ApplyUseChance(move);
+		break;
+
+	case BME_PHASE_INITIATIVE_FOCUS:
+		_sim.ApplyUseFocus(move);
+		break;
+
+	default:
+		BM_ASSERT(0);
+		break;
+	}
+
+	// at max_ply, score the round from here (see ScoreLeaf())
+	if (sm_level >= m_max_ply)
+		score = ScoreLeaf(_sim, pov, NULL);
+
+	// before max_ply, use the next BMAI3 action's estimate of winning chances
+	else
+		score = _sim.PlayRound_EvaluateMove(pov);
+
+	OnPostSimulation(game, _enter_level);
+	return score;
+}
+
+// DESC: score a simulation at max ply for _pov, starting with fight action _move if not NULL.  A rollout plays the round
+// out and scores it as "win/tie/loss" (1/0.5/0).  With an evaluator, the round is played to the next fight position
+// and estimated instead, or both are mixed by m_evaluator_mix.
+// PARAM: _forked if _sim is the fork point of _move (see ForkMoves())
+float BMC_BMAI3::ScoreLeaf(BMC_Game &_sim, INT _pov, BMC_Move *_move, bool _forked)
+{
+	float estimate = 0;
+	if (m_evaluator && m_evaluator_mix>0)
+	{
+		// only copy the game if the rollout still needs it
+		BMC_Game	copy(true);
+		BMC_Game *	leaf = &_sim;
+		if (m_evaluator_mix<1)
+		{
+			copy = _sim;
+			leaf = &copy;
+		}
+
+		bool open = true;
+		if (_move)
+		{
+			BMC_Move move = *_move;
+			open = leaf->ApplyFightAction(move, _forked);
+		}
+		else
+			leaf->PlayToFight();
+
+		if (open && !leaf->FightOver())
+			estimate = m_evaluator->Evaluate(leaf, _pov);
+		else
+		{
+			float margin = leaf->GetPlayer(_pov)->GetScore() - leaf->GetPlayer(!_pov)->GetScore();
+			estimate = margin>0 ? 1.0f : (margin<0 ? 0.0f : 0.5f);
+		}
+
+		if (m_evaluator_mix>=1)
+			return estimate;
+	}
+
+	BME_WLT rv = _sim.PlayRound(_move, _forked);
+
+	// reverse score if this is player 1, since WLT is wrt player 0
+	float score = 0;
+	if (rv==BME_WLT_TIE)
+		score = 0.5f;
+	else if ((rv==BME_WLT_WIN) ^ (_pov!=0))
+		score = 1.0f;
+
+	// a fight ended by the tablebase scores its exact value instead of the drawn result
+	if (_sim.GetFightValue()>=0)
+		score = (_pov==0) ? _sim.GetFightValue() : 1 - _sim.GetFightValue();
+
+	if (m_evaluator && m_evaluator_mix>0)
+		score = m_evaluator_mix * estimate + (1 - m_evaluator_mix) * score;
+	return score;
+}
+
+// DESC: run _check_sims simulations for every move in the movelist and add the results to _t.score
+// RETURNS: the sims added per move.  If the deadline passes during a batch that started before it, the batch is
+// dropped (0), or for the first batch of the loop, replaced by one (QAI) sim per move (1), see GetCheckSims().
+INT BMC_BMAI3::SimulateMoves(BMC_ThinkState &_t, INT _check_sims, INT _enter_level)
+{
+	if (g_pool.IsParallel())
+		return SimulateMovesParallel(_t, _check_sims, _enter_level);
+
+	INT i, k, s;
+	BMC_Game	sim(true);
+
+	// a batch that starts past the deadline is cheap, so only one that starts before it can be cut short
+	bool	timed = m_time_limit>0 && !IsOutOfTime();
+	bool	stopped = false;
+	BMC_FloatVector	saved_score, saved_score2;
+	std::vector<BMC_ControlSums> saved_control;
+	if (timed)
+	{
+		saved_score = _t.score;
+		saved_score2 = _t.score2;
+		saved_control = _t.control;
+	}
+
+	// with the history heuristic, likely best moves run first, so the others can stop as soon as the cull after
+	// this batch is certain to remove them.  The scores of the moves that finish do not depend on the order.
+	std::vector<INT> order;
+	GetMoveOrder(_t, order);
+	bool	cutoff = m_history && m_racing_delta<=0 && !m_control_variate;
+	float	lead = -1;	// best score of the moves that finished this batch
+
+	for (k=0; k<_t.movelist.Size() && !stopped; k++)
+	{
+		i = order[k];
+		for (s=0; s<_check_sims; s++)
+		{
+			if (timed && IsOutOfTime())
+			{
+				stopped = true;
+				break;
+			}
+
+			// every remaining sim is at most a win
+			if (cutoff && lead>=0 && IsCertainCull(_t, i, _t.score[i] + _check_sims - s, lead, _t.sims_run + _check_sims))
+			{
+				g_stats.OnHistoryCutoff(_check_sims - s);
+				break;
+			}
+
+			float score = SimulateMove(sim, _t, i, _t.sims_run + s, _enter_level);
+			_t.score[i] += score;
+			_t.score2[i] += score * score;
+
+			if (m_control_variate)
+			{
+				BMC_ControlSums &c = _t.control[i];
+				float luck = sim.GetRNG().GetLuck();
+				c.y += score;
+				c.x += luck;
+				c.x2 += luck * luck;
+				c.xy += luck * score;
+			}
+		}
+
+		if (s==_check_sims && _t.score[i] > lead)
+			lead = _t.score[i];
+	}
+
+	if (stopped)
+	{
+		_t.score.swap(saved_score);
+		_t.score2.swap(saved_score2);
+		_t.control.swap(saved_control);
+		return _t.sims_run>0 ? 0 : SimulateMoves(_t, 1, _enter_level);
+	}
+
+	if (m_control_variate)
+		ApplyControlVariate(_t, _t.sims_run + _check_sims);
+	return _check_sims;
+}
+
+// DESC: root-parallel version of SimulateMoves().  Each move's batch of sims is split into jobs on the
+// thread pool.  Every worker uses its own copy of this AI (m_workers), since nested plies call back into it, and its
+// own sm_level/g_stats.  Each sim uses the same RNG stream as in the serial loop, and results are stored
+// per simulation and then summed in order, so the outcome does not depend on the number of threads.
+// NOTE: the history heuristic is serial only.  The cutoff needs the lead of the moves that already finished the
+// batch, so here every move runs its full batch in movelist order.  Nested plies inside the workers run the serial
+// SimulateMoves() with their own thread_local history table.  Those tables are not merged, and only the decision
+// itself updates the calling thread's table.
+INT BMC_BMAI3::SimulateMovesParallel(BMC_ThinkState &_t, INT _check_sims, INT _enter_level)
+{
+	INT moves = _t.movelist.Size();
+	INT threads = g_pool.GetThreads();
+
+	// split each move's batch if there are not enough moves to keep all workers busy
+	INT jobs_per_move = (threads * 2 + moves - 1) / moves;
+	if (jobs_per_move > _check_sims)
+		jobs_per_move = _check_sims;
+	if (jobs_per_move < 1)
+		jobs_per_move = 1;
+	INT jobs = moves * jobs_per_move;
+
+	// OnStartAction() makes the workers for a root action, anything else gets them here
+	if ((INT)m_workers.size()!=threads)
+		CreateWorkers();
+
+	std::vector<float>		results(moves * _check_sims);
+	std::vector<float>		luck(moves * _check_sims);
+	BMC_Stats *	caller_stats = &g_stats;
+	BMC_Stats	worker_stats;
+	std::mutex	stats_mutex;
+	bool		timed = m_time_limit>0 && !IsOutOfTime();
+	std::atomic<bool> stopped(false);
+
+	g_pool.Run(jobs, [&](INT _job, INT _worker)
+	{
+		INT i = _job / jobs_per_move;
+		INT part = _job % jobs_per_move;
+		INT s_start = _check_sims * part / jobs_per_move;
+		INT s_end = _check_sims * (part+1) / jobs_per_move;
+		BMC_Game	sim(true);
+
+		sm_level = _enter_level + 1;
+
+		for (INT s=s_start; s<s_end && !stopped; s++)
+		{
+			if (timed && IsOutOfTime())
+			{
+				stopped = true;
+				break;
+			}
+			results[i * _check_sims + s] = m_workers[_worker].SimulateMove(sim, _t, i, _t.sims_run + s, _enter_level);
+			luck[i * _check_sims + s] = sim.GetRNG().GetLuck();
+		}
+
+		// hand the worker's counters back to the calling thread
+		if (&g_stats != caller_stats)
+		{
+			std::lock_guard<std::mutex> lock(stats_mutex);
+			worker_stats.Merge(g_stats);
+			g_stats.ClearCounters();
+		}
+	});
+
+	g_stats.Merge(worker_stats);
+
+	// as in SimulateMoves(), a batch cut short by the deadline is dropped
+	if (stopped)
+		return _t.sims_run>0 ? 0 : SimulateMovesParallel(_t, 1, _enter_level);
+
+	for (INT i=0; i<moves; i++)
+		for (INT s=0; s<_check_sims; s++)
+		{
+			float score = results[i * _check_sims + s];
+			_t.score[i] += score;
+			_t.score2[i] += score * score;
+
+			if (m_control_variate)
+			{
+				BMC_ControlSums &c = _t.control[i];
+				float l = luck[i * _check_sims + s];
+				c.y += score;
+				c.x += l;
+				c.x2 += l * l;
+				c.xy += l * score;
+			}
+		}
+
+	if (m_control_variate)
+		ApplyControlVariate(_t, _t.sims_run + _check_sims);
+	return _check_sims;
+}
+
+// DESC: copy this AI for each pool thread.  The copies are made once per root action rather than per batch, since
+// each one carries the whole AI (including the endgame solver).
+void BMC_BMAI3::CreateWorkers()
+{
+	std::vector<BMC_BMAI3> workers;
+	m_workers.clear();		// so the copies do not copy the old workers
+	workers.assign(g_pool.GetThreads(), *this);
+	m_workers.swap(workers);
 }
 
 // RETURN: true to continue running simulations, false if there is no point in continuing simulations (one move left)
 bool BMC_BMAI3::CullMoves(BMC_ThinkState &t)
 {
+	if (m_racing_delta>0)
+		return RaceMoves(t);
+
 	if (t.movelist.Size()==1)
 		return false;
 
 	//// compare and cull any moves that are not doing well
 
-	// cull threshold (percentage below best score)
-	// at 0% of sims, must be 25% of best_score to be cut
-	// at 100% of sims, must be 95% of best_score to be cut
-	float best_score_threshold_delta = m_max_best_score_threshold - m_min_best_score_threshold;
-	float best_score_threshold = m_min_best_score_threshold + t.PercSimsRun() * best_score_threshold_delta;
-
-	// delta points threshold - half of 'sims per check' at start, 0 at end
-	float delta_points_threshold = ( 1.0f - t.PercSimsRun() ) * m_sims_per_check * 0.5f;
-
-	// [adhoc] clamp the points threshold at best_score, so we cull 0-point moves, unless the best move has only 0/1 points
-	if (t.best_score>1 && delta_points_threshold>=t.best_score)
-		delta_points_threshold = t.best_score;
-
 	if (sm_level<=sm_debug_level)
 	{
 	g_logger.Log(BME_DEBUG_BMAI, "l%d p%d cullcheck mvs %d sims %d/%d thresh %f\n",
@@ -604,33 +1203,13 @@ bool BMC_BMAI3::CullMoves(BMC_ThinkState &t)
 		t.game->GetPhasePlayerID(),
 		t.movelist.Size(),
 		t.sims_run,t.sims,
-		best_score_threshold);
+		m_min_best_score_threshold + t.PercSimsRun() * (m_max_best_score_threshold - m_min_best_score_threshold));
 	}
 
-	// cull moves that are one stddev below AND less than half of the best move (since we probably don't want to
-	// cut any if stddev is low)
 	int i;
 	for (i=0; i<t.movelist.Size(); i++)
 	{
-		//// reasons to cull
-		int cull = 0;
-		float delta_points = t.best_score - t.score[i];
-		float min_delta_points = delta_points_threshold;
-
-		// [adhoc] TRIP: these tend to really fill the movelist, and heuristically tend to be of lesser value, so reduce the 'dpt' for them
-		BMC_MoveAttack * attack = t.movelist.Get(i);
-		if (attack->m_action == BME_ACTION_ATTACK && attack->m_attack == BME_ATTACK_TRIP)
-			min_delta_points *= 0.5f;
-
-		// 1) not enough sims left to catchup to best_move
-		if (delta_points>=(t.sims-t.sims_run))
-			cull = 1;
-
-		// 2) not at threshold score (relative to best_score - increasing threshold)
-		//    AND delta_points big enough (or sims run big enough)
-		else if (t.score[i]<t.best_score*best_score_threshold && delta_points>=min_delta_points)
-			cull = 2;
-
+		int cull = GetCull(t, i, t.score[i], t.best_score, t.sims_run);
 		if (cull)
 		{
 			if (sm_level<=sm_debug_level)
@@ -644,12 +1223,10 @@ bool BMC_BMAI3::CullMoves(BMC_ThinkState &t)
 				t.score[i] / t.sims_run * 100,
 				t.score[i],
 				t.best_score);
-			t.movelist.Get(i)->Debug(BME_DEBUG_BMAI);
+			t.movelist.Get(i)->Debug(t.game, BME_DEBUG_BMAI);
 			}
 
-			// cull move - this swaps in last move
-			t.score[i] = t.score[t.movelist.Size()-1];
-			t.movelist.Remove(i);
+			RemoveMove(t, i);
 			i--;
 		}
 	}
@@ -660,17 +1237,375 @@ bool BMC_BMAI3::CullMoves(BMC_ThinkState &t)
 	return true;
 }
 
+// DESC: precull.  Wide fights have hundreds of attacks, and each would get a full batch of sims before CullMoves()
+// sees it.  Instead rank them by the points swing of one simulated attack (ScoreAttack()) and keep the best
+// m_precull_keep, any within m_precull_margin points of the last of those, and m_precull_sample of the rest at
+// random, so an attack the static score misjudges can still be found.  Actions other than attacks are always kept.
+// The kept moves stay in movelist order.
+void BMC_BMAI3::PreCullMoves(BMC_Game *_game, BMC_MoveList &_movelist, INT _enter_level)
+{
+	INT i, moves = _movelist.Size();
+	if (m_precull_keep<=0 || moves <= m_precull_keep + m_precull_sample)
+		return;
+
+	std::vector<float> value(moves);
+	std::vector<INT> order(moves);
+	for (i=0; i<moves; i++)
+	{
+		BMC_Move *move = _movelist.Get(i);
+		value[i] = (move->m_action==BME_ACTION_ATTACK) ? ScoreAttack(_game, *move) : std::numeric_limits<float>::max();
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&value](INT _a, INT _b) { return value[_a] > value[_b]; });
+
+	INT keep = m_precull_keep;
+	float last_kept = value[order[keep-1]];
+	while (keep<moves && value[order[keep]] >= last_kept - m_precull_margin)
+		keep++;
+
+	INT sample = std::min(m_precull_sample, moves - keep);
+	for (i=0; i<sample; i++)
+		std::swap(order[keep+i], order[keep+i + _game->GetRNG().GetRand(moves-keep-i)]);
+	INT kept = keep + sample;
+
+	if (_enter_level < sm_debug_level)
+	{
+		// the safety margin is how far the best dropped attack scored below the last one kept on merit
+		float best_dropped = -std::numeric_limits<float>::max();
+		for (i=kept; i<moves; i++)
+			best_dropped = std::max(best_dropped, value[order[i]]);
+		g_logger.Log(BME_DEBUG_SIMULATION, "l%d p%d precull mvs %d -> %d (top %d, sample %d, margin %.1f)\n", sm_level,
+			_game->GetPhasePlayerID(), moves, kept, keep, sample, last_kept - best_dropped);
+	}
+
+	std::sort(order.begin(), order.begin() + kept);
+	BMC_MoveList precull;
+	for (i=0; i<kept; i++)
+		precull.Add(*_movelist.Get(order[i]));
+	_movelist = precull;
+}
+
+// DESC: the rules of CullMoves() for move _i with _score, if the best move has _best_score, after _sims_run sims
+// RETURNS: 0 to keep the move, otherwise the rule that culls it
+// NOTE: both rules hold for any lower _score or higher _best_score, which IsCertainCull() relies on
+INT BMC_BMAI3::GetCull(BMC_ThinkState &_t, INT _i, float _score, float _best_score, INT _sims_run)
+{
+	float perc_sims_run = (float)_sims_run / _t.sims;
+
+	// cull threshold (percentage below best score)
+	// at 0% of sims, must be 25% of best_score to be cut
+	// at 100% of sims, must be 95% of best_score to be cut
+	float best_score_threshold_delta = m_max_best_score_threshold - m_min_best_score_threshold;
+	float best_score_threshold = m_min_best_score_threshold + perc_sims_run * best_score_threshold_delta;
+
+	// delta points threshold - half of 'sims per check' at start, 0 at end
+	float delta_points_threshold = ( 1.0f - perc_sims_run ) * m_sims_per_check * 0.5f;
+
+	// [adhoc] clamp the points threshold at best_score, so we cull 0-point moves, unless the best move has only 0/1 points
+	if (_best_score>1 && delta_points_threshold>=_best_score)
+		delta_points_threshold = _best_score;
+
+	// cull moves that are one stddev below AND less than half of the best move (since we probably don't want to
+	// cut any if stddev is low)
+	float delta_points = _best_score - _score;
+	float min_delta_points = delta_points_threshold;
+
+	// [adhoc] TRIP: these tend to really fill the movelist, and heuristically tend to be of lesser value, so reduce the 'dpt' for them
+	BMC_MoveAttack * attack = _t.movelist.Get(_i);
+	if (attack->m_action == BME_ACTION_ATTACK && attack->m_attack == BME_ATTACK_TRIP)
+		min_delta_points *= 0.5f;
+
+	// 1) not enough sims left to catchup to best_move
+	if (delta_points>=(_t.sims-_sims_run))
+		return 1;
+
+	// 2) not at threshold score (relative to best_score - increasing threshold)
+	//    AND delta_points big enough (or sims run big enough)
+	if (_score<_best_score*best_score_threshold && delta_points>=min_delta_points)
+		return 2;
+
+	return 0;
+}
+
+// DESC: racing version of CullMoves().  The sims of a move are samples in [0,1], and a move is culled once the
+// upper confidence bound of its mean is below the lower bound of the best mean.  The bounds are empirical-Bernstein
+// (Audibert, Munos, Szepesvari), which tighten quickly for moves whose results rarely vary.  The error rate
+// m_racing_delta is split over every move and every check, so the best move survives with probability 1-delta.
+// RETURN: true to continue running simulations, false if there is no point in continuing simulations (one move left)
+bool BMC_BMAI3::RaceMoves(BMC_ThinkState &t)
+{
+	if (t.movelist.Size()==1)
+		return false;
+
+	INT		moves = (INT)t.score.size();	// including culled moves
+	INT		checks = (t.sims + m_sims_per_check - 1) / m_sims_per_check;
+	float	n = (float)t.sims_run;
+	float	log_term = std::log(3.0f * moves * checks / m_racing_delta);
+
+	// confidence radius of each move.  With the control variate, score is the adjusted sum but score2 is raw, so
+	// the bounds use the raw sums (c.y) for a mean that matches the variance.
+	INT i, best = 0;
+	std::vector<float> mean(t.movelist.Size()), radius(t.movelist.Size());
+	for (i=0; i<t.movelist.Size(); i++)
+	{
+		mean[i] = (m_control_variate ? (float)t.control[i].y : t.score[i]) / n;
+		float variance = std::max(0.0f, t.score2[i] / n - mean[i] * mean[i]);
+		radius[i] = std::sqrt(2 * variance * log_term / n) + 3 * log_term / n;
+		if (mean[i] > mean[best])
+			best = i;
+	}
+
+	float best_lower = mean[best] - radius[best];
+
+	if (sm_level<=sm_debug_level)
+	{
+	g_logger.Log(BME_DEBUG_BMAI, "l%d p%d racecheck mvs %d sims %d/%d best %.3f lower %.3f\n",
+		sm_level,
+		t.game->GetPhasePlayerID(),
+		t.movelist.Size(),
+		t.sims_run,t.sims,
+		mean[best],
+		best_lower);
+	}
+
+	// walk backwards, so RemoveMove() only ever swaps in a move that has already been checked
+	for (i=t.movelist.Size()-1; i>=0; i--)
+	{
+		if (mean[i] + radius[i] >= best_lower)
+			continue;
+
+		if (sm_level<=sm_debug_level)
+		{
+		g_logger.Log(BME_DEBUG_BMAI, "l%d p%d RACE m%d sims %d perc %.1f upper %.1f best lower %.1f - ",
+			sm_level,
+			t.game->GetPhasePlayerID(),
+			i,
+			t.sims_run,
+			mean[i] * 100,
+			(mean[i] + radius[i]) * 100,
+			best_lower * 100);
+		t.movelist.Get(i)->Debug(t.game, BME_DEBUG_BMAI);
+		}
+
+		RemoveMove(t, i);
+	}
+
+	if (t.movelist.Size()==1)
+		return false;
+
+	return true;
+}
+
+// DESC: control variate.  The luck x of a move's own rerolls has a known mean of 0 and is correlated with the
+// result y, so y - beta*x is also an unbiased estimate of the move's score, with variance reduced by the factor
+// 1-rho^2 at the best beta = cov(x,y)/var(x).  Beta is estimated from the move's own sims, and score becomes
+// the adjusted sum (clamped to the possible range), so culling and move selection use it unchanged.
+// Reroll luck is used rather than the QAI/ScoreAttack() score differential: that differential depends on die sizes
+// more than values, so after the move it is nearly fixed and carries little information, and its expectation is not
+// known.  Luck is where the differential's randomness comes from, and its mean is exactly 0.
+// An adjusted score can go down from one batch to the next, so the running best move is cleared for the caller's
+// loop to pick it again from the current scores.
+// PARAM: _sims is the number of sims in the sums
+void BMC_BMAI3::ApplyControlVariate(BMC_ThinkState &_t, INT _sims)
+{
+	_t.SetBestMove(NULL, -1);
+
+	for (INT i=0; i<_t.movelist.Size(); i++)
+	{
+		BMC_ControlSums &c = _t.control[i];
+		double mean_x = c.x / _sims;
+		double mean_y = c.y / _sims;
+		double var_x = c.x2 / _sims - mean_x * mean_x;
+		double var_y = _t.score2[i] / _sims - mean_y * mean_y;
+		double cov = c.xy / _sims - mean_x * mean_y;
+
+		if (var_x < 1e-9 || var_y < 1e-9 || _sims < 2)
+		{
+			_t.score[i] = (float)c.y;
+			continue;
+		}
+
+		double beta = cov / var_x;
+		double adjusted = c.y - beta * c.x;
+		_t.score[i] = (float)std::min(std::max(adjusted, 0.0), (double)_sims);
+
+		double rho2 = std::min(cov * cov / (var_x * var_y), 0.99);
+		g_stats.OnControlVariate((float)(1 / (1 - rho2)));
+	}
+}
+
+// RETURNS: number of dice (counting twins) that _move itself rerolls, whose rolls are the first of the sim
+INT BMC_BMAI3::GetRerolledDice(BMC_Game *_game, BMC_Move &_move)
+{
+	INT d, dice = 0;
+	BMC_Player *pl = _game->GetPhasePlayer();
+
+	switch (_move.m_action)
+	{
+	case BME_ACTION_ATTACK:
+		if (_move.MultipleAttackers())
+		{
+			for (d=0; d<pl->GetAvailableDice(); d++)
+				if (_move.m_attackers.IsSet(d))
+					dice += pl->GetDie(d)->Dice();
+		}
+		else
+			dice = pl->GetDie(_move.m_attacker)->Dice();
+		break;
+
+	case BME_ACTION_USE_CHANCE:
+		for (d=0; d<pl->GetAvailableDice(); d++)
+			if (_move.m_chance_reroll.IsSet(d))
+				dice += pl->GetDie(d)->Dice();
+		break;
+
+	default:
+		break;
+	}
+
+	return dice;
+}
+
+// DESC: cull move _i - this swaps in the last move
+void BMC_BMAI3::RemoveMove(BMC_ThinkState &t, INT _i)
+{
+	INT last = t.movelist.Size()-1;
+
+	t.score[_i] = t.score[last];
+	t.score2[_i] = t.score2[last];
+	t.control[_i] = t.control[last];
+	t.move_index[_i] = t.move_index[last];
+	if (!t.fork.empty())
+	{
+		t.fork[_i] = t.fork[last];
+		t.fork.pop_back();
+	}
+	if (t.best_move == t.movelist.Get(last))
+		t.best_move = t.movelist.Get(_i);
+	t.movelist.Remove(_i);
+}
+
+// DESC: fork points.  ApplyAttackPlayer() (captures, and side changes such as TURBO, BERSERK, MIGHTY and WEAK)
+// does not roll any dice, so it is applied once for each attack here, and every sim of the attack copies the
+// result instead of the root game.  Passes and surrenders are not forked.
+void BMC_BMAI3::ForkMoves(BMC_ThinkState &_t)
+{
+	INT i, moves = _t.movelist.Size();
+	_t.fork.resize(moves);
+	for (i=0; i<moves; i++)
+	{
+		BMC_ForkPoint &fork = _t.fork[i];
+		fork.move = *_t.movelist.Get(i);
+		fork.applied = (fork.move.m_action == BME_ACTION_ATTACK);
+		if (!fork.applied)
+			continue;
+
+		fork.game = *_t.game;
+		fork.game.SetSimulation(true);
+		fork.game.ApplyAttackPlayer(fork.move);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// history heuristic
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// RETURNS: the history table entry of _move, by attack type and the total sides of its attacking and target dice,
+// or NULL if it is neither an attack nor a pass
+float * BMC_BMAI3::GetHistoryEntry(BMC_Game *_game, BMC_Move &_move)
+{
+	if (_move.m_action == BME_ACTION_PASS)
+		return &sm_history[BME_ATTACK_INVALID][0][0];
+	if (_move.m_action != BME_ACTION_ATTACK)
+		return NULL;
+
+	BMC_Player *attacker = _game->GetPlayer(_move.m_attacker_player);
+	BMC_Player *target = _game->GetPlayer(_move.m_target_player);
+	INT attacker_sides = 0;
+	INT target_sides = 0;
+	INT d;
+
+	for (d=0; d<attacker->GetAvailableDice(); d++)
+	{
+		if (_move.MultipleAttackers() ? _move.m_attackers.IsSet(d) : d==_move.m_attacker)
+			attacker_sides += attacker->GetDie(d)->GetSidesMax();
+	}
+	for (d=0; d<target->GetAvailableDice(); d++)
+	{
+		if (_move.MultipleTargets() ? _move.m_targets.IsSet(d) : d==_move.m_target)
+			target_sides += target->GetDie(d)->GetSidesMax();
+	}
+
+	return &sm_history[_move.m_attack][std::min(attacker_sides, BMD_HISTORY_SIDES-1)][std::min(target_sides, BMD_HISTORY_SIDES-1)];
+}
+
+// DESC: the order SimulateMoves() runs the moves in.  With the history heuristic, moves whose kind of attack was
+// the best move most often go first, otherwise it is the movelist order.
+void BMC_BMAI3::GetMoveOrder(BMC_ThinkState &_t, std::vector<INT> &_order)
+{
+	INT i, moves = _t.movelist.Size();
+	std::vector<float> value(moves, 0);
+
+	_order.resize(moves);
+	for (i=0; i<moves; i++)
+	{
+		_order[i] = i;
+		float *h = m_history ? GetHistoryEntry(_t.game, *_t.movelist.Get(i)) : NULL;
+		if (h)
+			value[i] = *h;
+	}
+
+	if (m_history)
+		std::stable_sort(_order.begin(), _order.end(), [&value](INT _a, INT _b) { return value[_a] > value[_b]; });
+}
+
+// DESC: credit the best move of a finished decision by the square of the plies searched below it (as in chess
+// engines), so deep decisions count most.  All entries are halved when one gets too big, so old games fade.
+void BMC_BMAI3::UpdateHistory(BMC_ThinkState &_t, INT _enter_level)
+{
+	float *h = GetHistoryEntry(_t.game, *_t.best_move);
+	if (!h)
+		return;
+
+	float plies = (float)std::max(m_max_ply - _enter_level, 1);
+	*h += plies * plies;
+
+	if (*h > BMD_HISTORY_MAX)
+	{
+		float *entry = &sm_history[0][0][0];
+		for (size_t e=0; e<sizeof(sm_history)/sizeof(float); e++)
+			entry[e] *= 0.5f;
+	}
+}
+
+// DESC: will move _i be culled after this batch, if it scores at most _max_score by then and another move that
+// finished the batch has _lead?  When no cull follows (the last batch), only a move that cannot reach _lead is
+// stopped, so the best move never changes.
+bool BMC_BMAI3::IsCertainCull(BMC_ThinkState &_t, INT _i, float _max_score, float _lead, INT _sims_run)
+{
+	if (_sims_run >= _t.sims)
+		return _max_score < _lead;
+
+	return GetCull(_t, _i, _max_score, _lead, _sims_run) != 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 // BMC_ThinkState
 ///////////////////////////////////////////////////////////////////////////////////////////
 
-BMC_BMAI3::BMC_ThinkState::BMC_ThinkState(BMC_BMAI3 *_ai, BMC_Game *_game, BMC_MoveList &_movelist) :
-	score(_movelist.Size()), sims_run(0), best_move(NULL), movelist(_movelist),
+// PARAM: _budget_moves is the number of moves the sims are budgeted on, if not the size of the movelist
+BMC_BMAI3::BMC_ThinkState::BMC_ThinkState(BMC_BMAI3 *_ai, BMC_Game *_game, BMC_MoveList &_movelist, INT _budget_moves) :
+	sims_run(0), score(_movelist.Size()), score2(_movelist.Size()), control(_movelist.Size()), move_index(_movelist.Size()), best_move(NULL), movelist(_movelist),
 	game(_game)
 {
 	best_score = -1;
 	for (int i=0; i<_movelist.Size(); i++)
+	{
 		score[i] = 0;
-	sims = _ai->ComputeNumberSims(_movelist.Size());
+		score2[i] = 0;
+		move_index[i] = i;
+	}
+	decision = _game->GetRNG().GetRand64();
+	sims = _ai->ComputeNumberSims(_budget_moves>0 ? _budget_moves : _movelist.Size());
 	g_stats.OnPlyAction(_ai->GetLevel(), _movelist.Size(), sims);
 }
@@ -10,12 +10,34 @@
 // REVISION HISTORY:
 // drp030321 - partial split out to individual headers
 // dbl100824 - migrated this logic from bmai_ai.h
+// dbl101626 - simulation batches shared by all Get*Action methods, optionally run on the thread pool
+// dbl101626 - every simulation runs on its own RNG stream keyed by (decision, move, sim)
+// dbl101626 - optional racing cull based on empirical-Bernstein confidence bounds
+// dbl101626 - EvaluateAttackAction() for inner plies, using the transposition table
+// dbl101626 - optional time limit per root action (anytime search)
+// dbl101626 - autoply: pick ply and ply decay per root action from a cost model
+// dbl101626 - common random numbers mode
+// dbl101626 - quasi-random first die rolls of each simulation
+// dbl101626 - control variate on the luck of the move's rerolls
+// dbl101626 - exact endgame solver for small fights
+// dbl101626 - swing equilibrium mode for simultaneous swing setting
+// dbl101626 - opening book for root swing decisions
+// dbl101626 - optional leaf evaluator at max ply
+// dbl101626 - history heuristic: moves simulated in history order, and cut off once their cull is certain
+// dbl101626 - optional precull of attacks by a static score before the first simulation
+// dbl101626 - fork points: each attack's deterministic step is applied once, and its sims start from there
+// dbl101626 - parallel workers' AI copies are kept for the whole root action
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
+#include <chrono>
+#include <vector>
 #include "bmai_lib.h"
 #include "BMC_BMAI.h"
+#include "BMC_Endgame.h"
+#include "BMC_Evaluator.h"
+#include "BMC_OpeningBook.h"
 
 
 // BMAI v2 for testing strategies
@@ -27,24 +49,75 @@ public:
 	virtual	void	GetSetSwingAction(BMC_Game *_game, BMC_Move &_move);
 	virtual void	GetUseFocusAction(BMC_Game *_game, BMC_Move &_move);
 	virtual void	GetUseChanceAction(BMC_Game *_game, BMC_Move &_move);
+	float			EvaluateAttackAction(BMC_Game *_game);
+
+	// mutators
+	void	SetRacing(float _delta) { m_racing_delta = _delta; }
+	void	SetTimeLimit(INT _ms) { m_time_limit = _ms; }
+	void	SetAutoPly(INT _max_ply, INT _sims) { m_auto_ply = _max_ply; m_auto_sims = _sims; }
+	void	SetCommonRandom(bool _crn) { m_common_random = _crn; }
+	void	SetQuasiRandom(bool _qmc) { m_quasi_random = _qmc; }
+	void	SetControlVariate(bool _cv) { m_control_variate = _cv; }
+	void	SetEndgameDice(INT _d) { m_endgame.SetMaxDice(_d); }
+	void	SetSwingEquilibrium(bool _e) { m_swing_equilibrium = _e; }
+	void	SetOpeningBook(BMC_OpeningBook *_book) { m_opening_book = _book; }
+	void	SetEvaluator(BMC_Evaluator *_evaluator, float _mix) { m_evaluator = _evaluator; m_evaluator_mix = _mix; }
+	void	SetHistory(bool _history) { m_history = _history; }
+	void	SetPreCull(INT _keep, INT _sample, float _margin) { m_precull_keep = _keep; m_precull_sample = _sample; m_precull_margin = _margin; }
 
 	// accessors
 	float	GetLastProbabilityWin() { return m_last_probability_win; }
+	float	GetRacing() { return m_racing_delta; }
+	INT		GetTimeLimit() { return m_time_limit; }
+	INT		GetAutoPly() { return m_auto_ply; }
+	INT		GetAutoSims() { return m_auto_sims; }
+	bool	GetCommonRandom() { return m_common_random; }
+	bool	GetQuasiRandom() { return m_quasi_random; }
+	bool	GetControlVariate() { return m_control_variate; }
+	INT		GetEndgameDice() { return m_endgame.GetMaxDice(); }
+	bool	GetSwingEquilibrium() { return m_swing_equilibrium; }
+	BMC_OpeningBook *	GetOpeningBook() { return m_opening_book; }
+	BMC_Evaluator *	GetEvaluator() { return m_evaluator; }
+	float	GetEvaluatorMix() { return m_evaluator_mix; }
+	bool	GetHistory() { return m_history; }
+	INT		GetPreCullKeep() { return m_precull_keep; }
+	INT		GetPreCullSample() { return m_precull_sample; }
+	float	GetPreCullMargin() { return m_precull_margin; }
+	virtual bool	IsOutOfTime();
 
 	// class testing
 	virtual bool	IsBMAI3() { return true; }
 
 protected:
+	// per-move sums for the control variate: sim results y and reroll luck x
+	struct BMC_ControlSums {
+		BMC_ControlSums() : y(0), x(0), x2(0), xy(0) {}
+		double			y, x, x2, xy;
+	};
+
+	// an attack's game after its deterministic ApplyAttackPlayer() step, which every sim of the move starts from
+	struct BMC_ForkPoint {
+		BMC_ForkPoint() : game(true), applied(false) {}
+		BMC_Game		game;
+		BMC_Move		move;		// as updated by ApplyAttackPlayer()
+		bool			applied;	// false for a pass or surrender, whose sims start from the game itself
+	};
+
 	// getaction state
 	class BMC_ThinkState {
 	public:
-		BMC_ThinkState(BMC_BMAI3 *_ai, BMC_Game *_game, BMC_MoveList &_movelist);
+		BMC_ThinkState(BMC_BMAI3 *_ai, BMC_Game *_game, BMC_MoveList &_movelist, INT _budget_moves = 0);
 		float			PercSimsRun() { return (float)sims_run / sims; }
 		void			SetBestMove(BMC_Move *_move, float _score) { best_move = _move; best_score = _score; }
 
 		int				sims;
 		int				sims_run;
 		BMC_FloatVector	score;
+		BMC_FloatVector	score2;			// sum of squared sim results, for the variance
+		std::vector<BMC_ControlSums> control;	// if m_control_variate, score is the adjusted sum
+		std::vector<INT> move_index;	// original index of each move in movelist, kept in step with culls
+		std::vector<BMC_ForkPoint> fork;	// fights only, kept in step with culls
+		U64				decision;		// RNG key for this decision, drawn from the game's stream
 		float			best_score;
 		BMC_Move *		best_move;
 		BMC_MoveList &	movelist;
@@ -53,10 +126,68 @@ protected:
 	friend class BMC_ThinkState;
 
 	bool			CullMoves(BMC_ThinkState &_t);
-	void			RandomlySelectMoves(BMC_MoveList &_movelist, int _max);
+	void			PreCullMoves(BMC_Game *_game, BMC_MoveList &_movelist, INT _enter_level);
+	INT				GetCull(BMC_ThinkState &_t, INT _i, float _score, float _best_score, INT _sims_run);
+	INT				GetCheckSims(BMC_ThinkState &_t);
+	void			OnStartAction(BMC_Game *_game, BMC_MoveList &_movelist);
+	void			OnEndAction(BMC_Game *_game);
+
+	// autoply
+	void			SelectPly(BMC_Game *_game, INT _moves);
+	double			EstimateRollouts(BMC_Game *_game, INT _moves, INT _ply, float _decay);
+	double			MeasureRolloutRate(BMC_Game *_game);
+	bool			RaceMoves(BMC_ThinkState &_t);
+	void			RemoveMove(BMC_ThinkState &_t, INT _i);
+	void			ForkMoves(BMC_ThinkState &_t);
+	void			ApplyControlVariate(BMC_ThinkState &_t, INT _sims);
+	static INT		GetRerolledDice(BMC_Game *_game, BMC_Move &_move);
+	void			RandomlySelectMoves(BMC_Game *_game, BMC_MoveList &_list, int _max);
+
+	// history heuristic
+	static float *	GetHistoryEntry(BMC_Game *_game, BMC_Move &_move);
+	void			GetMoveOrder(BMC_ThinkState &_t, std::vector<INT> &_order);
+	void			UpdateHistory(BMC_ThinkState &_t, INT _enter_level);
+	bool			IsCertainCull(BMC_ThinkState &_t, INT _i, float _max_score, float _lead, INT _sims_run);
+
+	// swing equilibrium
+	bool			IsSimultaneousSetSwing(BMC_Game *_game);
+	void			GetSetSwingEquilibrium(BMC_Game *_game, BMC_MoveList &_movelist, BMC_Move &_move);
+	static void		SolveMatrixGame(std::vector<float> &_payoff, INT _rows, INT _cols, std::vector<float> &_row_mix, std::vector<float> &_col_mix);
+
+	// simulations
+	float			ScoreLeaf(BMC_Game &_sim, INT _pov, BMC_Move *_move, bool _forked = false);
+	float			SimulateMove(BMC_Game &_sim, BMC_ThinkState &_t, INT _i, INT _s, INT _enter_level);
+	U64				GetSimulationKey(BMC_ThinkState &_t, INT _i, INT _s);
+	INT				SimulateMoves(BMC_ThinkState &_t, INT _check_sims, INT _enter_level);
+	INT				SimulateMovesParallel(BMC_ThinkState &_t, INT _check_sims, INT _enter_level);
+	void			CreateWorkers();
 
 	int				m_sims_per_check;
 	float			m_min_best_score_threshold;
 	float			m_max_best_score_threshold;
+	bool			m_common_random;	// sim s of every move uses the same RNG stream
+	bool			m_quasi_random;		// the first die rolls of sim s are point s of a randomized Halton sequence
+	bool			m_control_variate;	// adjust scores by the luck of the move's own rerolls
+	bool			m_swing_equilibrium;	// set swing from a mixed equilibrium when the opponent sets swing at the same time
+	BMC_OpeningBook *	m_opening_book;	// root swing decisions by matchup, NULL for none
+	BMC_Evaluator *	m_evaluator;	// leaf estimates at max ply, NULL for rollouts only
+	float			m_evaluator_mix;	// weight of the evaluator against the rollout, 1 skips the rollout
+	bool			m_history;			// order moves by the history table and cut off moves certain to be culled (serial SimulateMoves() only)
+	INT				m_precull_keep;		// attacks kept by their static score before simulating, 0 for no precull
+	INT				m_precull_sample;	// other attacks kept at random
+	float			m_precull_margin;	// points below the last kept score that are kept too
+	float			m_racing_delta;		// error rate for RaceMoves(), 0 to use the CullMoves() thresholds
 	float			m_last_probability_win;
+	INT				m_last_sims;		// sims run by the last GetAttackAction()
+	INT				m_time_limit;		// ms per root action, 0 for no limit
+	std::chrono::steady_clock::time_point	m_deadline;	// set by OnStartAction() at the root, copied to parallel workers
+	INT				m_auto_ply;			// autoply max ply, 0 for off
+	INT				m_auto_sims;		// autoply rollouts per action, if there is no time limit
+	INT				m_saved_ply;		// settings restored by OnEndAction() after autoply
+	float			m_saved_decay;
+	BMC_Endgame		m_endgame;			// solves fights with few dice exactly instead of sampling
+	std::vector<BMC_BMAI3>	m_workers;	// one copy of this AI per pool thread, made by OnStartAction() for the root action
+
+	// how often each kind of attack was the best move, weighted by the plies searched below it
+	static thread_local float	sm_history[BME_ATTACK_MAX][BMD_HISTORY_SIDES][BMD_HISTORY_SIDES];
 };
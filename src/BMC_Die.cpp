@@ -11,11 +11,16 @@
 // dbl021125 - stealth dice can only interface with skill attacks
 // dbl032526 - allow single-die skill; enforce that Stealth overrides added attacks and only interacts via multi-die skill
 // dbl040626 - fix NOTSET assert checks and make attacker/trip rerolls and warrior Konstant handling state-driven
+// dbl101626 - rolls take the game's BMC_RNG instead of the global
+// dbl101626 - added GetStateHash()
+// dbl101626 - Roll() uses GetDieRoll(), which can be quasi-random
+// dbl101626 - RecomputeAttacks() looks up a shared attack type, built once by ComputeAttackType()
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BMC_Die.h"
 
 #include <cstdio>
+#include <cstring>
 #include "BMC_Game.h"
 #include "BMC_Logger.h"
 #include "BMC_Player.h"
@@ -38,93 +43,172 @@ void BMC_Die::Reset()
 	m_state = BME_STATE_NOTUSED;
 	m_value_total = 0;
 	m_sides_max = 0;
+	m_attack_type = 0;
 }
 
-void BMC_Die::RecomputeAttacks()
+// the die state that decides its attack type, as bits of an attack type key
+enum BME_ATTACK_KEY
 {
-	BM_ASSERT(m_state!=BME_STATE_NOTSET);
+	BME_ATTACK_KEY_UNSKILLED	= 0x0001,
+	BME_ATTACK_KEY_SPEED		= 0x0002,
+	BME_ATTACK_KEY_TRIP			= 0x0004,
+	BME_ATTACK_KEY_SHADOW		= 0x0008,
+	BME_ATTACK_KEY_KONSTANT		= 0x0010,
+	BME_ATTACK_KEY_INSULT		= 0x0020,
+	BME_ATTACK_KEY_BERSERK		= 0x0040,
+	BME_ATTACK_KEY_STEALTH		= 0x0080,
+	BME_ATTACK_KEY_WARRIOR		= 0x0100,
+	BME_ATTACK_KEY_QUEER_ODD	= 0x0200,	// queer with an odd value
+	BME_ATTACK_KEY_DIZZY		= 0x0400,
+	BME_ATTACK_KEYS				= 0x0800
+};
+
+// at most one per combination of attacks and vulnerabilities: 64 attack sets times 4 vulnerability sets
+BMC_AttackType	BMC_Die::sm_attack_types[256];
+U8				BMC_Die::sm_attack_type_index[BME_ATTACK_KEYS];
+INT				BMC_Die::sm_attack_type_count = 0;
+bool			BMC_Die::sm_attack_types_built = BMC_Die::BuildAttackTypes();
+
+// DESC: fill sm_attack_types with the distinct attack types of all keys, and sm_attack_type_index with the type
+// of each key.  Run once at startup, so the tables are read-only while games are played (on any thread).
+bool BMC_Die::BuildAttackTypes()
+{
+	for (INT key=0; key<BME_ATTACK_KEYS; key++)
+	{
+		BMC_AttackType type;
+		ComputeAttackType(key, type);
+
+		INT t;
+		for (t=0; t<sm_attack_type_count; t++)
+		{
+			if (std::memcmp(&sm_attack_types[t], &type, sizeof(type))==0)
+				break;
+		}
+		if (t==sm_attack_type_count)
+		{
+			BM_ASSERT(t < (INT)(sizeof(sm_attack_types)/sizeof(sm_attack_types[0])));
+			sm_attack_types[sm_attack_type_count++] = type;
+		}
+		sm_attack_type_index[key] = t;
+	}
+
+	return true;
+}
+
+// PARAM: _key is a set of BME_ATTACK_KEY bits
+void BMC_Die::ComputeAttackType(INT _key, BMC_AttackType &_type)
+{
+	BMC_BitArray<BME_ATTACK_MAX> &attacks = _type.attacks;
+	BMC_BitArray<BME_ATTACK_MAX> &vulnerabilities = _type.vulnerabilities;
 
 	// by default vulnerable to all
-	m_vulnerabilities.SetAll();
+	vulnerabilities.SetAll();
 
-	m_attacks.Clear();
+	attacks.Clear();
 
 	// POWER and SKILL - by default for all dice
-	m_attacks.Set(BME_ATTACK_POWER);
-	m_attacks.Set(BME_ATTACK_SKILL);
+	attacks.Set(BME_ATTACK_POWER);
+	attacks.Set(BME_ATTACK_SKILL);
 
 	// Handle specific dice types
 
 	// UNSKILLED [The Flying Squirrel]
 	// TODO: does WARRIOR override this? (currently)
-	if (HasProperty(BME_PROPERTY_UNSKILLED))
-		m_attacks.Clear(BME_ATTACK_SKILL);
+	if (_key & BME_ATTACK_KEY_UNSKILLED)
+		attacks.Clear(BME_ATTACK_SKILL);
 
 	// SPEED
-	if (HasProperty(BME_PROPERTY_SPEED))
-		m_attacks.Set(BME_ATTACK_SPEED);
+	if (_key & BME_ATTACK_KEY_SPEED)
+		attacks.Set(BME_ATTACK_SPEED);
 
 	// TRIP
-	if (HasProperty(BME_PROPERTY_TRIP))
-		m_attacks.Set(BME_ATTACK_TRIP);
+	if (_key & BME_ATTACK_KEY_TRIP)
+		attacks.Set(BME_ATTACK_TRIP);
 
 	// SHADOW
-	if (HasProperty(BME_PROPERTY_SHADOW))
+	if (_key & BME_ATTACK_KEY_SHADOW)
 	{
-		m_attacks.Set(BME_ATTACK_SHADOW);
-		m_attacks.Clear(BME_ATTACK_POWER);
+		attacks.Set(BME_ATTACK_SHADOW);
+		attacks.Clear(BME_ATTACK_POWER);
 	}
 
 	// KONSTANT
-	if (HasProperty(BME_PROPERTY_KONSTANT))
-		m_attacks.Clear(BME_ATTACK_POWER);
+	if (_key & BME_ATTACK_KEY_KONSTANT)
+		attacks.Clear(BME_ATTACK_POWER);
 
 	// INSULT
-	if (HasProperty(BME_PROPERTY_INSULT))
-		m_vulnerabilities.Clear(BME_ATTACK_SKILL);
+	if (_key & BME_ATTACK_KEY_INSULT)
+		vulnerabilities.Clear(BME_ATTACK_SKILL);
 
 	// BERSERK
-	if (HasProperty(BME_PROPERTY_BERSERK))
+	if (_key & BME_ATTACK_KEY_BERSERK)
 	{
-		m_attacks.Set(BME_ATTACK_BERSERK);
-		m_attacks.Clear(BME_ATTACK_SKILL);
+		attacks.Set(BME_ATTACK_BERSERK);
+		attacks.Clear(BME_ATTACK_SKILL);
 	}
 
 	// stealth dice
 	// - can only ATTACK with (multi-die) skill attack
 	// - can only BE ATTACKED BY (multi-die) skill attacked
-	if (HasProperty(BME_PROPERTY_STEALTH))
+	if (_key & BME_ATTACK_KEY_STEALTH)
 	{
-		m_attacks.Clear();
-		m_attacks.Set(BME_ATTACK_SKILL);
-		m_vulnerabilities.Clear();
-		m_vulnerabilities.Set(BME_ATTACK_SKILL);
+		attacks.Clear();
+		attacks.Set(BME_ATTACK_SKILL);
+		vulnerabilities.Clear();
+		vulnerabilities.Set(BME_ATTACK_SKILL);
 	}
 
 	// WARRIOR
 	// - cannot be attacked
 	// - can only skill attack (with non-warrior)
-	if (HasProperty(BME_PROPERTY_WARRIOR))
+	if (_key & BME_ATTACK_KEY_WARRIOR)
 	{
-		m_vulnerabilities.Clear();
-		m_attacks.Clear();
-		m_attacks.Set(BME_ATTACK_SKILL);
+		vulnerabilities.Clear();
+		attacks.Clear();
+		attacks.Set(BME_ATTACK_SKILL);
 	}
 
-	// queer dice
-	if (HasProperty(BME_PROPERTY_QUEER))
+	// queer dice: odd means acts as a shadow die
+	if (_key & BME_ATTACK_KEY_QUEER_ODD)
 	{
-		if (m_value_total % 2 == 1)	// odd means acts as a shadow die
-		{
-			m_attacks.Set(BME_ATTACK_SHADOW);
-			m_attacks.Clear(BME_ATTACK_POWER);
-		}
+		attacks.Set(BME_ATTACK_SHADOW);
+		attacks.Clear(BME_ATTACK_POWER);
 	}
 
 	// FOCUS: if dizzy no attacks
+	if (_key & BME_ATTACK_KEY_DIZZY)
+		attacks.Clear();
+}
+
+void BMC_Die::RecomputeAttacks()
+{
+	BM_ASSERT(m_state!=BME_STATE_NOTSET);
+
+	INT key = 0;
+	if (HasProperty(BME_PROPERTY_UNSKILLED))
+		key |= BME_ATTACK_KEY_UNSKILLED;
+	if (HasProperty(BME_PROPERTY_SPEED))
+		key |= BME_ATTACK_KEY_SPEED;
+	if (HasProperty(BME_PROPERTY_TRIP))
+		key |= BME_ATTACK_KEY_TRIP;
+	if (HasProperty(BME_PROPERTY_SHADOW))
+		key |= BME_ATTACK_KEY_SHADOW;
+	if (HasProperty(BME_PROPERTY_KONSTANT))
+		key |= BME_ATTACK_KEY_KONSTANT;
+	if (HasProperty(BME_PROPERTY_INSULT))
+		key |= BME_ATTACK_KEY_INSULT;
+	if (HasProperty(BME_PROPERTY_BERSERK))
+		key |= BME_ATTACK_KEY_BERSERK;
+	if (HasProperty(BME_PROPERTY_STEALTH))
+		key |= BME_ATTACK_KEY_STEALTH;
+	if (HasProperty(BME_PROPERTY_WARRIOR))
+		key |= BME_ATTACK_KEY_WARRIOR;
+	if (HasProperty(BME_PROPERTY_QUEER) && m_value_total % 2 == 1)
+		key |= BME_ATTACK_KEY_QUEER_ODD;
 	if (m_state == BME_STATE_DIZZY)
-		m_attacks.Clear();
+		key |= BME_ATTACK_KEY_DIZZY;
 
+	m_attack_type = sm_attack_type_index[key];
 }
 
 // POST: all data related to current value have not been set up
@@ -165,7 +249,7 @@ void BMC_Die::OnUseReserve()
 	BM_ASSERT(HasProperty(BME_PROPERTY_RESERVE));
 	BM_ASSERT(m_state==BME_STATE_RESERVE);
 
-	m_properties &= ~BME_PROPERTY_RESERVE;
+	RemoveProperty(BME_PROPERTY_RESERVE);
 	m_state = BME_STATE_NOTSET;
 }
 
@@ -217,7 +301,7 @@ void BMC_Die::SetFocus(INT _v)
 	RecomputeAttacks();
 }
 
-void BMC_Die::Roll()
+void BMC_Die::Roll(BMC_RNG &_rng)
 {
 	if (!IsUsed())
 		return;
@@ -235,7 +319,7 @@ void BMC_Die::Roll()
 		if (HasProperty(BME_PROPERTY_WARRIOR) || HasProperty(BME_PROPERTY_MAXIMUM))
 			m_value_total += m_sides[i];
 		else
-			m_value_total += g_rng.GetRand(m_sides[i])+1;
+			m_value_total += _rng.GetDieRoll(m_sides[i])+1;
 	}
 
 	m_state = BME_STATE_READY;
@@ -282,7 +366,7 @@ float BMC_Die::GetScore(bool _own)
 
 // DESC: deal with all deterministic effects of attacking, including TURBO
 // PARAM: _actually_attacking is normally true, but may be false for forced attack rerolls like ORNERY
-void BMC_Die::OnApplyAttackPlayer(BMC_Move &_move, BMC_Player *_owner, bool _actually_attacking)
+void BMC_Die::OnApplyAttackPlayer(BMC_Move &_move, BMC_Player *_owner, BMC_Player *_target, bool _actually_attacking)
 {
     // TODO determine how this may conflict with the design of `bool _actually_attacking`
     BM_ASSERT(c_attack_type[_move.m_attack]!=BME_ATTACK_TYPE_0_0);
@@ -300,7 +384,7 @@ void BMC_Die::OnApplyAttackPlayer(BMC_Move &_move, BMC_Player *_owner, bool _act
 		_owner->OnDieSidesChanging(this);
 		m_sides[0] = (m_sides[0]+1) / 2;
 		m_sides_max = m_sides[0];
-		m_properties &= ~BME_PROPERTY_BERSERK;
+		RemoveProperty(BME_PROPERTY_BERSERK);
 		_owner->OnDieSidesChanged(this);
 	}
 
@@ -316,20 +400,18 @@ void BMC_Die::OnApplyAttackPlayer(BMC_Move &_move, BMC_Player *_owner, bool _act
 		// TODO also support 1_N attacks that are only targettting 1 die like speed or skill attack
 		if (c_attack_type[_move.m_attack]==BME_ATTACK_TYPE_1_1 || c_attack_type[_move.m_attack]==BME_ATTACK_TYPE_N_1)
 		{
-			BMC_Player *target = _move.m_game->GetPlayer(_move.m_target_player);
-
 			_owner->OnDieSidesChanging(this);
-			if (target->GetDie(_move.m_target)->HasProperty(BME_PROPERTY_TWIN) )
+			if (_target->GetDie(_move.m_target)->HasProperty(BME_PROPERTY_TWIN) )
 			{
 				AddProperty(BME_PROPERTY_TWIN);
-				m_sides_max = target->GetDie(_move.m_target)->GetSidesMax();
-				for (int i = 0; i<target->GetDie(_move.m_target)->Dice(); i++)
-					m_sides[i] = target->GetDie(_move.m_target)->GetSides(i);
+				m_sides_max = _target->GetDie(_move.m_target)->GetSidesMax();
+				for (int i = 0; i<_target->GetDie(_move.m_target)->Dice(); i++)
+					m_sides[i] = _target->GetDie(_move.m_target)->GetSides(i);
 			}
 			else
 			{
 				RemoveProperty(BME_PROPERTY_TWIN);
-				m_sides_max = m_sides[0] = target->GetDie(_move.m_target)->GetSidesMax();
+				m_sides_max = m_sides[0] = _target->GetDie(_move.m_target)->GetSidesMax();
 			}
 			_owner->OnDieSidesChanged(this);
 		}
@@ -360,7 +442,7 @@ void BMC_Die::OnApplyAttackPlayer(BMC_Move &_move, BMC_Player *_owner, bool _act
 	if (HasProperty(BME_PROPERTY_WARRIOR))
 	{
 		_owner->OnDiePropertiesChanging(this);
-		m_properties &= ~BME_PROPERTY_WARRIOR;
+		RemoveProperty(BME_PROPERTY_WARRIOR);
 		if (HasProperty(BME_PROPERTY_KONSTANT))
 			RecomputeAttacks();
 		_owner->OnDiePropertiesChanged(this);
@@ -405,7 +487,7 @@ void BMC_Die::OnBeforeRollInGame(BMC_Player *_owner)
 	}
 }
 
-void BMC_Die::OnApplyAttackNatureRollAttacker(BMC_Move &_move, BMC_Player *_owner)
+void BMC_Die::OnApplyAttackNatureRollAttacker(BMC_Move &_move, BMC_Player *_owner, BMC_RNG &_rng)
 {
 	INT i;
 
@@ -422,15 +504,15 @@ void BMC_Die::OnApplyAttackNatureRollAttacker(BMC_Move &_move, BMC_Player *_owne
 			switch (swing)
 			{
 			case BME_SWING_X:
-				m_sides[i] = c_mood_sides_X[g_rng.GetRand(BMD_MOOD_SIDES_RANGE_X)];
+				m_sides[i] = c_mood_sides_X[_rng.GetRand(BMD_MOOD_SIDES_RANGE_X)];
 				break;
 			case BME_SWING_V:
-				m_sides[i] = c_mood_sides_V[g_rng.GetRand(BMD_MOOD_SIDES_RANGE_V)];
+				m_sides[i] = c_mood_sides_V[_rng.GetRand(BMD_MOOD_SIDES_RANGE_V)];
 				break;
 			default:
 				// some BM use MOOD SWING on other than X and V
 				delta = c_swing_sides_range[swing][1] - c_swing_sides_range[swing][0];
-				m_sides[i] = g_rng.GetRand(delta+1)+ c_swing_sides_range[swing][0];
+				m_sides[i] = _rng.GetRand(delta+1)+ c_swing_sides_range[swing][0];
 				break;
 			}
 			m_sides_max += m_sides[i];
@@ -441,14 +523,23 @@ void BMC_Die::OnApplyAttackNatureRollAttacker(BMC_Move &_move, BMC_Player *_owne
 
 	// reroll
 	if (GetState()==BME_STATE_NOTSET)
-		Roll();
+		Roll(_rng);
 }
 
-void BMC_Die::OnApplyAttackNatureRollTripped()
+void BMC_Die::OnApplyAttackNatureRollTripped(BMC_RNG &_rng)
 {
 	// reroll
 	if (GetState()==BME_STATE_NOTSET)
-		Roll();
+		Roll(_rng);
+}
+
+// DESC: hash key of this die in slot _slot of player _player.  The key is a hash of (slot, die state) rather
+// than an entry in a random table, so it covers every value/sides/properties combination without the storage.
+U64 BMC_Die::GetStateHash(INT _player, INT _slot)
+{
+	U64 slot = (_player << 8) | _slot;
+	U64 state = m_state | (m_value_total << 8) | (m_sides[0] << 16) | (m_sides[1] << 24);
+	return BMC_RNG::MakeKey(slot, state, GetProperties());
 }
 
 void BMC_Die::Debug(BME_DEBUG _cat)
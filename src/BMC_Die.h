@@ -10,16 +10,31 @@
 // dbl100524 - further split out of individual headers
 // dbl021125 - CanDoAttack()/CanBeAttacked() now take a BME_ATTACK
 // dbl032526 - allow single-die skill; enforce that Stealth overrides added attacks and only interacts via multi-die skill
+// dbl101626 - GetStateHash() for state hashing
+// dbl101626 - SetOriginalIndex()
+// dbl101626 - no vtable, so dice are trivially copyable (24b)
+// dbl101626 - OnApplyAttackPlayer() takes the target player, moves no longer hold the game
+// dbl101626 - attacks and vulnerabilities are an index into a shared table of attack types
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
+#include <type_traits>
 #include "BMC_BitArray.h"
 #include "BMC_DieData.h"
 #include "BMC_Move.h"
 
 
 class BMC_Player;
+class BMC_RNG;
+
+// the attacks a die can make and the attacks that can be made on it.  Only a few combinations occur, so each one
+// is stored once in BMC_Die::sm_attack_types and dice keep its index.
+struct BMC_AttackType
+{
+	BMC_BitArray<BME_ATTACK_MAX>	attacks;
+	BMC_BitArray<BME_ATTACK_MAX>	vulnerabilities;
+};
 
 class BMC_Die : public BMC_DieData
 {
@@ -27,9 +42,9 @@ class BMC_Die : public BMC_DieData
 
 public:
 	// setup
-	virtual void Reset();
+	void		Reset();
 	void		SetDie(BMC_DieData *_data);
-	void		Roll();
+	void		Roll(BMC_RNG &_rng);
 	void		GameRoll(BMC_Player *_owner);
 
 	// methods
@@ -38,8 +53,8 @@ public:
 	void		SetFocus(INT _v);
 
 	// accessors
-	bool		CanDoAttack(BME_ATTACK _attack) { return m_attacks.IsSet(_attack); }
-	bool		CanBeAttacked(BME_ATTACK _attack) { return m_vulnerabilities.IsSet(_attack); }
+	bool		CanDoAttack(BME_ATTACK _attack) { return sm_attack_types[m_attack_type].attacks.IsSet(_attack); }
+	bool		CanBeAttacked(BME_ATTACK _attack) { return sm_attack_types[m_attack_type].vulnerabilities.IsSet(_attack); }
 	INT			GetValueTotal() { return m_value_total; }
 	INT			GetSidesMax() { return m_sides_max; }
 	bool		IsAvailable() { return m_state == BME_STATE_READY || m_state == BME_STATE_DIZZY; }
@@ -48,17 +63,20 @@ public:
 	float		GetScore(bool _own);
 	INT			GetOriginalIndex() { return m_original_index; }
 	BME_STATE	GetState() { return (BME_STATE)m_state; }
+	U64			GetStateHash(INT _player, INT _slot);
+	static INT	GetAttackTypeCount() { return sm_attack_type_count; }
 
 	// mutators
 	void		SetState(BME_STATE _state) { m_state = _state; }
+	void		SetOriginalIndex(INT _i) { m_original_index = _i; }
 	void		CheatSetValueTotal(INT _v) { m_value_total = _v; }	// used for some functions
 
 	// events
 	void		OnDieChanged();
 	void		OnSwingSet(INT _swing, U8 _value);
-	void		OnApplyAttackPlayer(BMC_Move &_move, BMC_Player *_owner, bool _actually_attacking = true);
-	void		OnApplyAttackNatureRollAttacker(BMC_Move &_move, BMC_Player *_owner);
-	void		OnApplyAttackNatureRollTripped();
+	void		OnApplyAttackPlayer(BMC_Move &_move, BMC_Player *_owner, BMC_Player *_target, bool _actually_attacking = true);
+	void		OnApplyAttackNatureRollAttacker(BMC_Move &_move, BMC_Player *_owner, BMC_RNG &_rng);
+	void		OnApplyAttackNatureRollTripped(BMC_RNG &_rng);
 	void		OnBeforeRollInGame(BMC_Player *_owner);
 	void		OnUseReserve();
 	void		OnDizzyRecovered();
@@ -69,11 +87,22 @@ protected:
 	void		RecomputeAttacks();
 
 private:
+	static void	ComputeAttackType(INT _key, BMC_AttackType &_type);
+	static bool	BuildAttackTypes();
+
+	static BMC_AttackType	sm_attack_types[];		// each distinct attack type once, built at startup
+	static U8				sm_attack_type_index[];	// attack type of each key (see RecomputeAttacks())
+	static INT				sm_attack_type_count;
+	static bool				sm_attack_types_built;
+
 	U8			m_state;				// should be BME_STATE
 	U8			m_value_total;			// current total value of all dice, redundant
 	U8			m_sides_max;			// max value of dice (based on m_sides), redundant
 	U8			m_original_index;		// save original index for interface
-	BMC_BitArray<BME_ATTACK_MAX>	m_attacks;
-	BMC_BitArray<BME_ATTACK_MAX>	m_vulnerabilities;
+	U8			m_attack_type;			// index into sm_attack_types
 	//U8			m_value[BMD_MAX_TWINS];	// current value of dice, not really necessary (and often not known!)
 };
+
+// dice are copied with the game (BMC_Game is trivially copyable), so keep them small and free of anything a flat copy can break
+static_assert(std::is_trivially_copyable<BMC_Die>::value, "BMC_Die must be trivially copyable");
+static_assert(sizeof(BMC_Die) <= 24, "BMC_Die has grown, check the copy cost");
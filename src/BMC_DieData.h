@@ -8,6 +8,9 @@
 // REVISION HISTORY:
 // drp030321 - partial split out to individual headers
 // dbl100524 - further split out of individual headers
+// dbl101626 - GetProperties() accessor for state hashing
+// dbl101626 - Reset() is no longer virtual, so dice have no vtable
+// dbl101626 - SetProperties() and SetSwingType() mutators
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
@@ -23,7 +26,7 @@ class BMC_DieData
 
 public:
     BMC_DieData();
-    virtual void  Reset();
+    void		Reset();
 
     // methods
     void		Debug(BME_DEBUG _cat = BME_DEBUG_ALWAYS);
@@ -35,11 +38,13 @@ public:
     // drp022521 - fixed to return INT instead of bool
     INT			Dice() { return (m_properties & BME_PROPERTY_TWIN) ? 2 : 1; }
     INT			GetSides(INT _t) { return m_sides[_t]; }
+    U64			GetProperties() { return m_properties; }
 
 	// mutators
-	void		AddProperty(BME_PROPERTY _p) { m_properties |= _p; }
-	void		RemoveProperty(BME_PROPERTY _p) { m_properties &= ~_p; }
-
+	void		SetProperties(U64 _p) { m_properties = _p; }
+	void		AddProperty(U64 _p) { m_properties |= _p; }
+	void		RemoveProperty(U64 _p) { m_properties &= ~_p; }
+	void		SetSwingType(INT _d, BME_SWING _swing) { m_swing_type[_d] = _swing; }
 
 protected:
     U64			m_properties;
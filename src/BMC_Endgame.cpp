@@ -0,0 +1,357 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_Endgame.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: exact expectimax solver for small fights
+//
+// REVISION HISTORY:
+// dbl101626 - added for BMAI3 endgames
+// dbl101626 - Star2 probing at chance nodes
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_Endgame.h"
+
+#include <algorithm>
+#include <cmath>
+#include "BMC_Logger.h"
+
+
+// dice that change size during the fight, or roll anything other than their values
+static const U64 c_endgame_excluded =
+	BME_PROPERTY_MOOD | BME_PROPERTY_TURBO | BME_PROPERTY_MIGHTY | BME_PROPERTY_WEAK | BME_PROPERTY_ORNERY |
+	BME_PROPERTY_DOPPLEGANGER | BME_PROPERTY_MORPHING | BME_PROPERTY_RADIOACTIVE | BME_PROPERTY_BERSERK |
+	BME_PROPERTY_WARRIOR | BME_PROPERTY_VALUE;
+
+thread_local std::unordered_map<U64, float> BMC_Endgame::sm_cache;
+
+BMC_Endgame::BMC_Endgame()
+{
+	m_max_dice = 0;
+	m_nodes = 0;
+	m_aborted = false;
+}
+
+bool BMC_Endgame::CanSolve(BMC_Game *_game)
+{
+	if (m_max_dice<=0 || _game->GetPhase()!=BME_PHASE_FIGHT)
+		return false;
+
+	INT p, d, dice = 0;
+	for (p=0; p<BMD_MAX_PLAYERS; p++)
+	{
+		BMC_Player *player = _game->GetPlayer(p);
+		for (d=0; d<player->GetAvailableDice(); d++)
+		{
+			BMC_Die *die = player->GetDie(d);
+			if (die->GetProperties() & c_endgame_excluded)
+				return false;
+			dice++;
+		}
+	}
+
+	return dice <= m_max_dice;
+}
+
+// DESC: find the best fight action of the phase player
+// RETURNS: false if the search was too big, otherwise _move and its exact winning _probability
+bool BMC_Endgame::Solve(BMC_Game *_game, BMC_Move &_move, float &_probability)
+{
+	BM_ASSERT(_game->GetPhase()==BME_PHASE_FIGHT);
+
+	if (sm_cache.size() > BMD_ENDGAME_MAX_CACHE)
+		sm_cache.clear();
+
+	m_nodes = 0;
+	m_aborted = false;
+
+	INT			pov = _game->GetPhasePlayerID();
+	BMC_MoveList movelist;
+	_game->GenerateValidAttacks(movelist);
+
+	INT		best = -1;
+	float	best_value = -1;
+	for (INT i=0; i<movelist.Size(); i++)
+	{
+		// search each move with the window that can still beat the best, wrt player 0
+		float value;
+		if (pov==0)
+			value = SearchMove(*_game, *movelist.Get(i), 0, std::max(best_value, 0.0f), 1);
+		else
+			value = 1 - SearchMove(*_game, *movelist.Get(i), 0, 0, best_value<0 ? 1 : 1 - best_value);
+
+		if (m_aborted)
+			return false;
+
+		if (value > best_value)
+		{
+			best_value = value;
+			best = i;
+		}
+	}
+
+	g_logger.Log(BME_DEBUG_SIMULATION, "endgame p%d moves %d nodes %d win %.3f\n", pov, movelist.Size(), m_nodes, best_value);
+
+	_move = *movelist.Get(best);
+	_probability = best_value;
+	return true;
+}
+
+// DESC: decision node
+// RETURNS: the value for player 0, exact if it is inside (_alpha,_beta), otherwise a bound on the far side
+float BMC_Endgame::Search(BMC_Game &_state, INT _depth, float _alpha, float _beta)
+{
+	float lo, hi;
+	GetBounds(_state, lo, hi);
+	if (lo>=_beta || lo==hi)
+		return lo;
+	if (hi<=_alpha)
+		return hi;
+
+	U64 hash = _state.GetStateHash();
+	auto cached = sm_cache.find(hash);
+	if (cached!=sm_cache.end())
+		return cached->second;
+
+	if (++m_nodes > BMD_ENDGAME_MAX_NODES || _depth > BMD_ENDGAME_MAX_DEPTH)
+	{
+		m_aborted = true;
+		return lo;
+	}
+
+	bool		maximize = (_state.GetPhasePlayerID()==0);
+	float		alpha = std::max(_alpha, lo);
+	float		beta = std::min(_beta, hi);
+	float		best = maximize ? lo : hi;
+	BMC_MoveList movelist;
+	_state.GenerateValidAttacks(movelist);
+
+	for (INT i=0; i<movelist.Size(); i++)
+	{
+		float value = SearchMove(_state, *movelist.Get(i), _depth, alpha, beta);
+		if (m_aborted)
+			return best;
+
+		if (maximize)
+		{
+			best = std::max(best, value);
+			alpha = std::max(alpha, value);
+		}
+		else
+		{
+			best = std::min(best, value);
+			beta = std::min(beta, value);
+		}
+
+		if (alpha>=beta)
+			break;
+	}
+
+	if (best>_alpha && best<_beta)
+		sm_cache[hash] = best;
+
+	return best;
+}
+
+// DESC: apply _move to _sim (a copy of _state) with the die rolls in _script.  Rolls past the end of the script are
+// 0 and are added to it, and _sides gets the sides of every roll.
+// RETURNS: true if that ended the fight
+bool BMC_Endgame::ApplyOutcome(BMC_Game &_state, BMC_Move &_move, BMC_Game &_sim, std::vector<U8> &_script, std::vector<U8> &_sides)
+{
+	BMC_Move move = _move;
+	_sim = _state;
+	_sim.SetSimulation(true);
+	_sim.GetRNG().SetScript(&_script, &_sides);
+	bool over = !_sim.ApplyFightAction(move) || _sim.FightOver() || _sim.GetPhase()!=BME_PHASE_FIGHT;
+	_script.resize(_sim.GetRNG().GetScriptRolls());
+	_sim.GetRNG().SetScript(NULL, NULL);
+	return over;
+}
+
+// DESC: advance _script like an odometer over the sides that were rolled, dropping rolls that the new prefix no
+// longer makes
+// RETURNS: false once every roll sequence has been enumerated
+bool BMC_Endgame::NextOutcome(std::vector<U8> &_script, std::vector<U8> &_sides)
+{
+	INT k = (INT)_script.size() - 1;
+	while (k>=0 && _script[k]+1 >= _sides[k])
+		k--;
+	if (k<0)
+		return false;
+	_script[k]++;
+	_script.resize(k+1);
+	return true;
+}
+
+// DESC: chance node.  Enumerate the roll sequences of _move (see ApplyOutcome() and NextOutcome()).
+// Star2: first probe one move of each outcome.  Where player 0 moves next, its value is a lower bound on the
+// outcome, otherwise an upper bound.  If the outcomes at their probed bounds cannot reach the window, stop there.
+// Star1: then search the outcomes in full, and stop as soon as the outcomes so far, with the rest at their probed
+// bounds, cannot reach the window.
+// RETURNS: as Search()
+float BMC_Endgame::SearchMove(BMC_Game &_state, BMC_Move &_move, INT _depth, float _alpha, float _beta)
+{
+	float lo, hi;
+	GetBounds(_state, lo, hi);
+
+	std::vector<U8>	script, sides;
+	std::vector<BMC_Game> children;	// the outcomes still to search
+	std::vector<BMC_EndgameOutcome> outcomes;
+	BMC_Game	sim(true);
+	double		lo_sum = 0, hi_sum = 0;
+	double		remaining = 1;
+
+	do
+	{
+		bool over = ApplyOutcome(_state, _move, sim, script, sides);
+
+		BMC_EndgameOutcome outcome;
+		outcome.weight = 1;
+		for (size_t k=0; k<script.size(); k++)
+			outcome.weight /= sides[k];
+		remaining -= outcome.weight;
+
+		if (over)
+			outcome.lo = outcome.hi = GetResult(sim);
+		else
+		{
+			GetBounds(sim, outcome.lo, outcome.hi);
+			if (outcome.lo < outcome.hi)
+				ProbeOutcome(sim, outcome, _depth, (float)((_alpha - hi_sum - remaining * hi) / outcome.weight),
+					(float)((_beta - lo_sum - remaining * lo) / outcome.weight));
+			if (m_aborted)
+				return lo;
+		}
+
+		outcome.child = -1;
+		if (outcome.lo < outcome.hi)
+		{
+			outcome.child = (INT)children.size();
+			children.push_back(sim);
+		}
+		outcomes.push_back(outcome);
+		lo_sum += outcome.weight * outcome.lo;
+		hi_sum += outcome.weight * outcome.hi;
+
+		if (hi_sum + remaining * hi <= _alpha)
+			return (float)(hi_sum + remaining * hi);
+		if (lo_sum + remaining * lo >= _beta)
+			return (float)(lo_sum + remaining * lo);
+	}
+	while (NextOutcome(script, sides));
+
+	// the bounds of the outcomes not searched yet
+	double		rest_lo = lo_sum, rest_hi = hi_sum;
+	double		sum = 0;
+
+	for (size_t o=0; o<outcomes.size(); o++)
+	{
+		BMC_EndgameOutcome &outcome = outcomes[o];
+		rest_lo -= outcome.weight * outcome.lo;
+		rest_hi -= outcome.weight * outcome.hi;
+
+		float value = outcome.lo;
+		if (outcome.lo < outcome.hi)
+		{
+			// the window this outcome must reach to matter
+			float child_alpha = (float)((_alpha - sum - rest_hi) / outcome.weight);
+			float child_beta = (float)((_beta - sum - rest_lo) / outcome.weight);
+
+			value = Search(children[outcome.child], _depth+1, std::max(child_alpha, outcome.lo), std::min(child_beta, outcome.hi));
+			if (m_aborted)
+				return lo;
+
+			// a bound outside the window is still a bound when clamped to the probed ones
+			value = std::min(std::max(value, outcome.lo), outcome.hi);
+		}
+
+		sum += outcome.weight * value;
+
+		if (sum + rest_hi <= _alpha)
+			return (float)(sum + rest_hi);
+		if (sum + rest_lo >= _beta)
+			return (float)(sum + rest_lo);
+	}
+
+	return (float)sum;
+}
+
+// DESC: Star2 probe of the outcome _state.  A state already in the cache has its exact value.  Otherwise search its
+// first move with a null window at the value the outcome needs to cut the chance node: _beta where player 0 moves
+// (one move reaching it is a lower bound on a max node), _alpha otherwise.
+// POST: _outcome.lo or _outcome.hi is tightened if the probe reached its target
+void BMC_Endgame::ProbeOutcome(BMC_Game &_state, BMC_EndgameOutcome &_outcome, INT _depth, float _alpha, float _beta)
+{
+	auto cached = sm_cache.find(_state.GetStateHash());
+	if (cached!=sm_cache.end())
+	{
+		_outcome.lo = _outcome.hi = cached->second;
+		return;
+	}
+
+	BMC_MoveList movelist;
+	_state.GenerateValidAttacks(movelist);
+	if (movelist.Size()==0)
+		return;
+
+	// a result past the target is a bound on the move, and so on the outcome
+	if (_state.GetPhasePlayerID()==0)
+	{
+		float target = std::min(_beta, _outcome.hi);
+		if (target <= _outcome.lo)
+			return;
+		float value = SearchMove(_state, *movelist.Get(0), _depth+1, std::nextafter(target, _outcome.lo), target);
+		if (value >= target)
+			_outcome.lo = value;
+	}
+	else
+	{
+		float target = std::max(_alpha, _outcome.lo);
+		if (target >= _outcome.hi)
+			return;
+		float value = SearchMove(_state, *movelist.Get(0), _depth+1, target, std::nextafter(target, _outcome.hi));
+		if (value <= target)
+			_outcome.hi = value;
+	}
+}
+
+// DESC: bounds on the value from the scores.  Every die in play ends with its owner or captured, which is worth
+// GetScore(true) to the owner or GetScore(false) to the other player, so the final score difference of player 0
+// is within the sum of each die's best and worst case.
+void BMC_Endgame::GetBounds(BMC_Game &_state, float &_lo, float &_hi)
+{
+	float diff_min = _state.GetPlayer(0)->GetScore() - _state.GetPlayer(1)->GetScore();
+	float diff_max = diff_min;
+
+	for (INT p=0; p<BMD_MAX_PLAYERS; p++)
+	{
+		float sign = (p==0) ? 1.0f : -1.0f;
+		BMC_Player *player = _state.GetPlayer(p);
+		for (INT d=0; d<player->GetAvailableDice(); d++)
+		{
+			BMC_Die *die = player->GetDie(d);
+			// relative to now: kept is +0, captured is -own -captured
+			float own = die->GetScore(true);
+			float lost = -sign * (own + die->GetScore(false));
+			diff_min += std::min(0.0f, lost);
+			diff_max += std::max(0.0f, lost);
+		}
+	}
+
+	_lo = (diff_min > 0) ? 1 : (diff_min == 0 ? 0.5f : 0);
+	_hi = (diff_max < 0) ? 0 : (diff_max == 0 ? 0.5f : 1);
+}
+
+// RETURNS: 1/0.5/0 wrt player 0 for a finished fight
+float BMC_Endgame::GetResult(BMC_Game &_state)
+{
+	float s0 = _state.GetPlayer(0)->GetScore();
+	float s1 = _state.GetPlayer(1)->GetScore();
+	if (s0 > s1)
+		return 1;
+	if (s0 < s1)
+		return 0;
+	return 0.5f;
+}
@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_Endgame.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: exact expectimax solver for small fights
+//
+// REVISION HISTORY:
+// dbl101626 - added for BMAI3 endgames
+// dbl101626 - Star2 probing at chance nodes
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "BMC_Game.h"
+
+
+// a roll outcome of a chance node, with bounds on its value for player 0
+struct BMC_EndgameOutcome
+{
+	double			weight;
+	float			lo, hi;
+	INT				child;				// index of its state among the outcomes to search, or -1
+};
+
+// Exact expectimax over the rest of the fight.  Each attack is a chance node whose outcomes are enumerated by
+// scripting the die rolls (see BMC_RNG::SetScript()), so any attack and nature rule is handled as long as the
+// only randomness is die values.  Values are P(win) for player 0 (ties are 0.5).
+// - Star2 pruning at chance nodes: one move of each outcome is probed to bound it, then Star1 searches the
+//   outcomes with alpha-beta windows from those bounds
+// - the bounds come from the score each die can still add or take away (BMC_Die::GetScore())
+// - exact values are cached per thread by state hash, since reroll outcomes often transpose
+// Positions with dice that change size or roll anything other than values are not solved.
+class BMC_Endgame
+{
+public:
+	BMC_Endgame();
+
+	// methods
+	bool			CanSolve(BMC_Game *_game);
+	bool			Solve(BMC_Game *_game, BMC_Move &_move, float &_probability);
+
+	// mutators
+	void			SetMaxDice(INT _d) { m_max_dice = _d; }
+
+	// accessors
+	INT				GetMaxDice() { return m_max_dice; }
+	INT				GetNodes() { return m_nodes; }
+
+private:
+	float			Search(BMC_Game &_state, INT _depth, float _alpha, float _beta);
+	float			SearchMove(BMC_Game &_state, BMC_Move &_move, INT _depth, float _alpha, float _beta);
+	void			ProbeOutcome(BMC_Game &_state, BMC_EndgameOutcome &_outcome, INT _depth, float _alpha, float _beta);
+	static bool		ApplyOutcome(BMC_Game &_state, BMC_Move &_move, BMC_Game &_sim, std::vector<U8> &_script, std::vector<U8> &_sides);
+	static bool		NextOutcome(std::vector<U8> &_script, std::vector<U8> &_sides);
+	void			GetBounds(BMC_Game &_state, float &_lo, float &_hi);
+	static float	GetResult(BMC_Game &_state);
+
+	INT				m_max_dice;			// solve fights with at most this many dice in play, 0 for off
+	INT				m_nodes;
+	bool			m_aborted;
+
+	// exact values by state hash
+	static thread_local std::unordered_map<U64, float>	sm_cache;
+};
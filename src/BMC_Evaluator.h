@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_Evaluator.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: interface for static evaluation of a round in progress
+//
+// REVISION HISTORY:
+// dbl101626 - added for BMAI3 leaf evaluation
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "bmai_lib.h"
+
+
+class BMC_Game;
+
+// Estimates the chance to win the current round without playing it out.  BMAI3 can use one in place of (or mixed
+// with) the rollout at max ply.  Evaluate() is called from the simulation threads, so it must not change state.
+class BMC_Evaluator
+{
+public:
+	virtual ~BMC_Evaluator() {}
+
+	// RETURNS: P(win)+P(tie)/2 of the round for _pov, with the fight about to start or in progress
+	virtual float	Evaluate(BMC_Game *_game, INT _pov) = 0;
+};
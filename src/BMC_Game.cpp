@@ -12,15 +12,26 @@
 // dbl021125 - adjust to new Die::CanDoAttack()/Die::CanBeAttacked() signatures
 // dbl032526 - allow single-die skill; enforce that Stealth overrides added attacks and only interacts via multi-die skill as attacker or target
 // dbl040626 - schedule Chance and Trip rerolls only for dice that should actually reroll
+// dbl101626 - all rolls use the game's own m_rng
+// dbl101626 - split ApplyFightAction() out of PlayFight() for tree search, added GetStateHash()
+// dbl101626 - GetStateHash() hashes the players and dice, PlayFight_EvaluateMove() probes the transposition table
+// dbl101626 - simulated fights end at the first tablebase state, with its exact value
+// dbl101626 - split PlayToFight() out of PlayRound()
+// dbl101626 - PlayGame() restores each player's dice between rounds, and sets the phase player for reserve
+// dbl101626 - added GetPositionHash()
+// dbl101626 - PlayRound(), PlayFight(), ApplyFightAction() and PlayFight_EvaluateMove() take _forked
+// dbl101626 - moves no longer hold the game; ApplyAttackPlayer() passes the target player to the dice
+// dbl101626 - PlayRound() draws a tie from the tablebase P(tie)
+// dbl101626 - removed the memcpy copy constructor and operator=, the game is trivially copyable
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BMC_Game.h"
 
-#include <cstring>
 #include "BMC_AI.h"
 #include "BMC_BMAI3.h"
 #include "BMC_DieIndexStack.h"
 #include "BMC_Logger.h"
+#include "BMC_TableBase.h"
 
 
 BMC_Game::BMC_Game(bool _simulation)
@@ -37,24 +48,11 @@ BMC_Game::BMC_Game(bool _simulation)
 	m_target_wins = BMD_DEFAULT_WINS;
 	m_simulation = _simulation;
 	m_last_action = BME_ACTION_MAX;
+	m_fight_win = -1;
+	m_fight_tie = 0;
 	m_surrender_allowed = true;
 }
 
-BMC_Game::BMC_Game(const BMC_Game & _game)
-{
-	bool save_simulation = m_simulation;
-	*this = _game;
-	m_simulation = save_simulation;
-}
-
-const BMC_Game & BMC_Game::operator=(const BMC_Game & _game)
-{
-	bool save_simulation = m_simulation;
-	std::memcpy(this, &_game, sizeof(BMC_Game));
-	m_simulation = save_simulation;
-	return *this;
-}
-
 void BMC_Game::Setup(BMC_Man *_man1, BMC_Man *_man2)
 {
 	if (_man1)
@@ -132,7 +130,7 @@ void BMC_Game::FinishPreround()
 
 	// roll die
 	for (i=0; i<BMD_MAX_PLAYERS; i++)
-		m_player[i].RollDice();
+		m_player[i].RollDice(m_rng);
 
 	// determine initiative
 	INT initiative = CheckInitiative();
@@ -492,7 +490,6 @@ void BMC_Game::PlayPreround()
 			else
 				move.m_action = BME_ACTION_PASS;
 
-			move.m_game = this;	// ensure m_game is correct
 			if (!ValidSetSwing(move))
 			{
 				BMF_Error("Player %d using illegal set swing move\n", i);
@@ -647,22 +644,39 @@ float BMC_Game::ConvertWLTToWinProbability()
 		return 0.5;
 }
 
-BME_WLT BMC_Game::PlayRound(BMC_Move *_start_action)
+// DESC: play the preround (if not done yet) and the initiative, so the next action is the first of the fight
+void BMC_Game::PlayToFight()
 {
-	if (_start_action == NULL)
+	if (m_phase==BME_PHASE_PREROUND)
 	{
-		if (m_phase==BME_PHASE_PREROUND)
-		{
-			PlayPreround();
-			FinishPreround();
-		}
+		PlayPreround();
+		FinishPreround();
+	}
 
-		PlayInitiative();
+	PlayInitiative();
 
-		FinishInitiative();
-	}
+	FinishInitiative();
+}
 
-	PlayFight(_start_action);
+// PARAM: _start_action is the first fight action, if not NULL.  _forked as in PlayFight()
+BME_WLT BMC_Game::PlayRound(BMC_Move *_start_action, bool _forked)
+{
+	if (_start_action == NULL)
+		PlayToFight();
+
+	PlayFight(_start_action, _forked);
+
+	// TABLEBASE: the fight has no final score, so draw the result from its chances
+	if (m_fight_win>=0)
+	{
+		float r = m_rng.GetFRand();
+		if (r < m_fight_win)
+			return FinishRound(BME_WLT_WIN);
+		else if (r < m_fight_win + m_fight_tie)
+			return FinishRound(BME_WLT_TIE);
+		else
+			return FinishRound(BME_WLT_LOSS);
+	}
 
 	// finish
 	// ASSUME: two players
@@ -678,6 +692,12 @@ void BMC_Game::PlayGame(BMC_Man *_man1, BMC_Man *_man2)
 {
 	Setup(_man1, _man2);
 
+	// every round starts with the dice the players started the game with
+	BMC_Player	start[BMD_MAX_PLAYERS];
+	INT			i;
+	for (i=0; i<BMD_MAX_PLAYERS; i++)
+		start[i] = m_player[i];
+
 	while (m_phase != BME_PHASE_GAMEOVER)
 	{
 		BME_WLT wlt;
@@ -687,6 +707,9 @@ void BMC_Game::PlayGame(BMC_Man *_man1, BMC_Man *_man2)
 		// if not gameover, do RESERVE for loser
 		if (m_phase != BME_PHASE_GAMEOVER)
 		{
+			for (i=0; i<BMD_MAX_PLAYERS; i++)
+				m_player[i].OnRoundStart(start[i]);
+
 			BMC_Move	move;
 			INT			loser = -1;
 			if (wlt == BME_WLT_WIN)
@@ -698,8 +721,13 @@ void BMC_Game::PlayGame(BMC_Man *_man1, BMC_Man *_man2)
 			if (loser>=0 && m_player[loser].HasDieWithProperty(BME_PROPERTY_RESERVE,true))
 			{
 				m_phase = BME_PHASE_RESERVE;
+				m_phase_player = loser;
+				m_target_player = !loser;
 				m_ai[loser]->GetReserveAction(this, move);
 				ApplyUseReserve(move);
+
+				// the reserve die stays in play for the rest of the game
+				start[loser] = m_player[loser];
 			}
 		}
 	}
@@ -718,8 +746,6 @@ void BMC_Game::GenerateValidChance(BMC_MoveList & _movelist)
 
 	_movelist.Clear();
 
-	move.m_game = this;
-
 	// now iterate over each possible chance action
 	INT num_chance_dice = 0;
 	INT chance_die_index[BMD_MAX_DICE];
@@ -770,8 +796,6 @@ void BMC_Game::GenerateValidFocus(BMC_MoveList & _movelist)
 
 	_movelist.Clear();
 
-	move.m_game = this;
-
 	// always leave PASS
 	move.m_action = BME_ACTION_PASS;
 	_movelist.Add(move);
@@ -849,7 +873,6 @@ void BMC_Game::GenerateValidSetSwing(BMC_MoveList & _movelist)
 	//INT				combinations = 1;
 	INT i, p;
 
-	move.m_game = this;
 	move.m_action = BME_ACTION_SET_SWING_AND_OPTION;
 
 	// walk dice and determine possible things to set
@@ -960,7 +983,6 @@ void BMC_Game::GenerateValidAttacks(BMC_MoveList & _movelist)
 	_movelist.Clear();
 
 	move.m_action = BME_ACTION_ATTACK;
-	move.m_game = this;
 	move.m_attacker_player = m_phase_player;
 	move.m_target_player = m_target_player;
 
@@ -1285,7 +1307,7 @@ void BMC_Game::ApplyUseChance(BMC_Move &_move)
 		if (!die->HasProperty(BME_PROPERTY_KONSTANT))
 			die->SetState(BME_STATE_NOTSET);
 		if (die->GetState()==BME_STATE_NOTSET)
-			die->Roll();
+			die->Roll(m_rng);
 	}
 
 	// reoptimize dice
@@ -1425,9 +1447,7 @@ void BMC_Game::ApplyAttackPlayer(BMC_Move &_move)
 	INT	i;
 	BMC_Die *att_die;
 	BMC_Player *attacker = &(m_player[m_phase_player]);
-
-	// update game pointer in move to ensure it is correct
-	_move.m_game = this;
+	BMC_Player *target = &(m_player[m_target_player]);
 
 	if (_move.m_action == BME_ACTION_PASS)
 		_move.m_attack = BME_ATTACK_INVALID;
@@ -1439,7 +1459,7 @@ void BMC_Game::ApplyAttackPlayer(BMC_Move &_move)
 	case BME_ATTACK_TYPE_1_N:
 		{
 			att_die = attacker->GetDie(_move.m_attacker);
-			att_die->OnApplyAttackPlayer(_move,attacker);
+			att_die->OnApplyAttackPlayer(_move,attacker,target);
 			break;
 		}
 	case BME_ATTACK_TYPE_N_1:
@@ -1449,7 +1469,7 @@ void BMC_Game::ApplyAttackPlayer(BMC_Move &_move)
 				if (!_move.m_attackers.IsSet(i))
 					continue;
 				att_die = attacker->GetDie(i);
-				att_die->OnApplyAttackPlayer(_move,attacker);
+				att_die->OnApplyAttackPlayer(_move,attacker,target);
 			}
 			break;
 		}
@@ -1461,7 +1481,6 @@ void BMC_Game::ApplyAttackPlayer(BMC_Move &_move)
 		BM_ASSERT(c_attack_type[_move.m_attack]==BME_ATTACK_TYPE_1_1);
 
 		BMC_Die *tgt_die;
-		BMC_Player *target = &(m_player[m_target_player]);
 
 		tgt_die = target->GetDie(_move.m_target);
 		if (!tgt_die->HasProperty(BME_PROPERTY_KONSTANT))
@@ -1479,7 +1498,7 @@ void BMC_Game::ApplyAttackPlayer(BMC_Move &_move)
         {
             att_die = attacker->GetDie(i);
             if (att_die->HasProperty(BME_PROPERTY_ORNERY))
-                att_die->OnApplyAttackPlayer(_move,attacker,false);	// false means not _actually_attacking
+                att_die->OnApplyAttackPlayer(_move,attacker,target,false);	// false means not _actually_attacking
         }
     }
 }
@@ -1502,7 +1521,7 @@ void BMC_Game::ApplyAttackNatureRoll(BMC_Move &_move)
 	case BME_ATTACK_TYPE_1_N:
 		{
 			att_die = attacker->GetDie(_move.m_attacker);
-			att_die->OnApplyAttackNatureRollAttacker(_move,attacker);
+			att_die->OnApplyAttackNatureRollAttacker(_move,attacker,m_rng);
 			break;
 		}
 	case BME_ATTACK_TYPE_N_1:
@@ -1512,7 +1531,7 @@ void BMC_Game::ApplyAttackNatureRoll(BMC_Move &_move)
 				if (!_move.m_attackers.IsSet(i))
 					continue;
 				att_die = attacker->GetDie(i);
-				att_die->OnApplyAttackNatureRollAttacker(_move,attacker);
+				att_die->OnApplyAttackNatureRollAttacker(_move,attacker,m_rng);
 			}
 			break;
 		}
@@ -1530,7 +1549,7 @@ void BMC_Game::ApplyAttackNatureRoll(BMC_Move &_move)
 			tgt_die->SetState(BME_STATE_NOTSET);
 			tgt_die->OnBeforeRollInGame(target);
 		}
-		tgt_die->OnApplyAttackNatureRollTripped();
+		tgt_die->OnApplyAttackNatureRollTripped(m_rng);
 	}
 }
 
@@ -1539,9 +1558,6 @@ void BMC_Game::ApplyAttackNatureRoll(BMC_Move &_move)
 // PRE: all dice that needed to be rerolled have been rerolled
 void BMC_Game::ApplyAttackNaturePost(BMC_Move &_move, bool &_extra_turn)
 {
-	// update game pointer in move to ensure it is correct
-	_move.m_game = this;
-
 	// for TIME_AND_SPACE
 	_extra_turn = false;
 
@@ -1778,8 +1794,9 @@ prem_score:
 
 // DESC: apply this move, apply the nature rules, then return the winning probability of the phase_player
 // PARAM: _action is the move for "phase_player"
+// PARAM: _forked if ApplyAttackPlayer() was already applied for _move (a BMC_BMAI3 fork point)
 // RETURNS: the winning probability of the _pov_player
-float BMC_Game::PlayFight_EvaluateMove(INT _pov_player, BMC_Move &_move)
+float BMC_Game::PlayFight_EvaluateMove(INT _pov_player, BMC_Move &_move, bool _forked)
 {
 	BM_ASSERT(m_phase == BME_PHASE_FIGHT);
 	BM_ASSERT(!FightOver());
@@ -1799,7 +1816,8 @@ float BMC_Game::PlayFight_EvaluateMove(INT _pov_player, BMC_Move &_move)
 	{
 		//BM_ASSERT(_move.m_action == BME_ACTION_ATTACK);
 
-		ApplyAttackPlayer(_move);
+		if (!_forked)
+			ApplyAttackPlayer(_move);
 		ApplyAttackNatureRoll(_move);
 		ApplyAttackNaturePost(_move, extra_turn);
 	}
@@ -1816,12 +1834,13 @@ float BMC_Game::PlayFight_EvaluateMove(INT _pov_player, BMC_Move &_move)
 	// if not, then finally, get action and return the probability win
 	FinishTurn(extra_turn);
 
-	BMC_Move move2;
+	float tablebase_value;
+	if (g_tablebase.Probe(this, tablebase_value))
+		return (m_phase_player != _pov_player) ? 1 - tablebase_value : tablebase_value;
+
 	BM_ASSERT(m_ai[m_phase_player]->IsBMAI3());
 	BMC_BMAI3 *bmai3 = (BMC_BMAI3 *)(m_ai[m_phase_player]);
-	bmai3->GetAttackAction(this, move2);
-
-	float new_phase_player_prob_win = bmai3->GetLastProbabilityWin();
+	float new_phase_player_prob_win = bmai3->EvaluateAttackAction(this);
 	BM_ASSERT(new_phase_player_prob_win<=1);
 
 	if (m_phase_player != _pov_player)
@@ -1830,57 +1849,108 @@ float BMC_Game::PlayFight_EvaluateMove(INT _pov_player, BMC_Move &_move)
 		return new_phase_player_prob_win;
 }
 
+// PARAM: _forked if ApplyAttackPlayer() was already applied for _start_action
 // POST: m_phase is PREROUND or GAMEOVER appropriately
-void BMC_Game::PlayFight(BMC_Move *_start_action)
+void BMC_Game::PlayFight(BMC_Move *_start_action, bool _forked)
 {
 	BMC_Move move;
 	m_last_action = BME_ACTION_MAX;
+	m_fight_win = -1;
 
 	while (m_phase != BME_PHASE_PREROUND)
 	{
-		bool extra_turn = false;
-
 		if (FightOver())
 			return;
 
+		// TABLEBASE: simulations stop at the first state with a known value
+		if (m_simulation && !_start_action && g_tablebase.Probe(this, m_fight_win, m_fight_tie))
+		{
+			if (m_phase_player!=0)
+				m_fight_win = 1 - m_fight_win - m_fight_tie;
+			return;
+		}
+
 		// get action from phase player
+		bool forked = false;
 		if (_start_action)
 		{
 			move = *_start_action;
+			forked = _forked;
 			_start_action = NULL;
 		}
 		else
 			m_ai[m_phase_player]->GetAttackAction(this, move);
 
 		g_logger.Log(BME_DEBUG_ROUND, "action p%d ", m_phase_player );
-		move.Debug(BME_DEBUG_ROUND);
+		move.Debug(this, BME_DEBUG_ROUND);
 
-		// is it a pass or surrender?
-		if (move.m_action == BME_ACTION_SURRENDER)
-		{
-			m_player[m_phase_player].OnSurrendered();
+		if (!ApplyFightAction(move, forked))
 			return;
-		}
-		else if (move.m_action == BME_ACTION_PASS && m_last_action==BME_ACTION_PASS)
-		{
-			// both passed - end game
-			//BMF_Log(BME_DEBUG_ROUND, "both players passed - ending fight\n");
-			return;
-		}
-		else // if (move.m_action == BME_ACTION_ATTACK)
-		{
-			ApplyAttackPlayer(move);
-			ApplyAttackNatureRoll(move);
-			ApplyAttackNaturePost(move, extra_turn);
-		}
-
-		m_last_action = move.m_action;
+	}
+}
 
-		// FOCUS: undizzy the dice
-		RecoverDizzyDice(m_phase_player);
+// DESC: apply one fight action of the phase player, including the nature rules, and pass the turn
+// PARAM: _forked if ApplyAttackPlayer() was already applied for _move
+// RETURNS: false if the action ended the fight (surrender, or both players passed)
+bool BMC_Game::ApplyFightAction(BMC_Move &_move, bool _forked)
+{
+	bool extra_turn = false;
 
-		FinishTurn(extra_turn);
+	// is it a pass or surrender?
+	if (_move.m_action == BME_ACTION_SURRENDER)
+	{
+		m_player[m_phase_player].OnSurrendered();
+		return false;
+	}
+	else if (_move.m_action == BME_ACTION_PASS && m_last_action==BME_ACTION_PASS)
+	{
+		// both passed - end game
+		//BMF_Log(BME_DEBUG_ROUND, "both players passed - ending fight\n");
+		return false;
+	}
+	else // if (_move.m_action == BME_ACTION_ATTACK)
+	{
+		if (!_forked)
+			ApplyAttackPlayer(_move);
+		ApplyAttackNatureRoll(_move);
+		ApplyAttackNaturePost(_move, extra_turn);
 	}
+
+	m_last_action = _move.m_action;
+
+	// FOCUS: undizzy the dice
+	RecoverDizzyDice(m_phase_player);
+
+	FinishTurn(extra_turn);
+	return true;
+}
+
+// DESC: hash of everything that matters to the rest of the round (dice, scores, phase, turn).  Each player and
+// die contributes an independent key, XORed together.  The AIs and the RNG are ignored, so two sims that rolled
+// the same values hash the same.
+// NOTE: it is computed on demand rather than kept up to date by the Apply* steps.  It is only needed once per
+// inner-ply search (to probe the transposition table), while the Apply* steps run for every move of every
+// rollout.  Measured on a ply 2 search (release build): about 75 ns per hash and 40 probes in a 0.2 s search, so
+// hashing is about 0.001% of the search time.
+U64 BMC_Game::GetStateHash()
+{
+	U64 h = BMC_RNG::MakeKey(m_phase, m_phase_player | (m_target_player << 8), m_last_action);
+
+	for (INT p=0; p<BMD_MAX_PLAYERS; p++)
+		h ^= m_player[p].GetStateHash();
+
+	return h;
+}
+
+// DESC: GetStateHash() as if there was no last action, which is how a position arrives from the parser
+U64 BMC_Game::GetPositionHash()
+{
+	U64 h = BMC_RNG::MakeKey(m_phase, m_phase_player | (m_target_player << 8), BME_ACTION_MAX);
+
+	for (INT p=0; p<BMD_MAX_PLAYERS; p++)
+		h ^= m_player[p].GetStateHash();
+
+	return h;
 }
 
 void BMC_Game::RecoverDizzyDice(INT _player)
@@ -1904,3 +1974,4 @@ void BMC_Game::SimulateAttack(BMC_Move &_move, bool &_extra_turn)
 
 	ApplyAttackNaturePost(_move, _extra_turn);
 }
+
@@ -10,30 +10,42 @@
 // REVISION HISTORY:
 // drp030321 - partial split out to individual headers
 // dbl100524 - further split out of individual headers
+// dbl101626 - each game owns its BMC_RNG stream
+// dbl101626 - ApplyFightAction() and GetStateHash() for tree search
+// dbl101626 - m_fight_value for fights ended by the tablebase
+// dbl101626 - SetPhasePlayer() for simultaneous swing decisions
+// dbl101626 - GetTargetWins() for the opening book
+// dbl101626 - PlayToFight() for leaf evaluation
+// dbl101626 - GetPositionHash() and GetLastAction() for MCTS tree reuse
+// dbl101626 - fight entry points can start after an ApplyAttackPlayer() that was already applied
+// dbl101626 - size checks for the memcpy in operator=
+// dbl101626 - m_fight_win and m_fight_tie replace m_fight_value, so tablebase rounds can tie
+// dbl101626 - default copy, so the game is trivially copyable; copies take m_simulation along, see SetSimulation()
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
 #include <cstddef>
+#include <type_traits>
 #include "BMC_Player.h"
+#include "BMC_RNG.h"
 
 
 class BMC_AI;
 
-class BMC_Game		// 420b
+class BMC_Game		// 664b
 {
 	friend class BMC_Parser;
 
 public:
 	BMC_Game(bool _simulation);
-	BMC_Game(const BMC_Game & _game);
-	const BMC_Game & operator=(const BMC_Game &_game);
 
 	// game simulation - level 0
 	void		PlayGame(BMC_Man *_man1 = NULL, BMC_Man *_man2 = NULL);
 
 	// game simulation - level 1 (for simulations)
-	BME_WLT		PlayRound(BMC_Move *_start_action = NULL);
+	BME_WLT		PlayRound(BMC_Move *_start_action = NULL, bool _forked = false);
+	void		PlayToFight();
 
 	// game methods
 	bool		ValidAttack(BMC_MoveAttack &_move);
@@ -62,6 +74,7 @@ public:
 	void		ApplyAttackNatureRoll(BMC_Move &_move);
 	void		ApplyAttackNaturePost(BMC_Move &_move, bool &_extra_turn);
 	void		SimulateAttack(BMC_MoveAttack &_move, bool & _extra_turn);
+	bool		ApplyFightAction(BMC_Move &_move, bool _forked = false);
 	void		RecoverDizzyDice(INT _player);
 
 	// accessors
@@ -73,15 +86,23 @@ public:
 	BME_PHASE	GetPhase() { return m_phase; }
 	INT			GetStanding(INT _wlt) { return m_standing[_wlt]; }
 	INT			GetInitiativeWinner() { return m_initiative_winner; }
+	INT			GetTargetWins() { return m_target_wins; }
 	bool		IsSimulation() { return m_simulation; }
+	void		SetSimulation(bool _simulation) { m_simulation = _simulation; }
 	BMC_AI *	GetAI(INT _p) { return m_ai[_p]; }
+	BMC_RNG &	GetRNG() { return m_rng; }
+	U64			GetStateHash();
+	U64			GetPositionHash();
+	BME_ACTION	GetLastAction() { return m_last_action; }
+	float		GetFightValue() { return m_fight_win<0 ? -1 : m_fight_win + m_fight_tie / 2; }
 
 	// mutators
 	void		SetAI(INT _p, BMC_AI *_ai) { m_ai[_p] = _ai; }
+	void		SetPhasePlayer(INT _p) { m_phase_player = _p; m_target_player = !_p; }
 
 	// methods wrt. "percent chance to win"
 	float		ConvertWLTToWinProbability();
-	float		PlayFight_EvaluateMove(INT _pov_player, BMC_Move &_move);
+	float		PlayFight_EvaluateMove(INT _pov_player, BMC_Move &_move, bool _forked = false);
 	float		PlayRound_EvaluateMove(INT _pov_player);
 
 	bool		IsSurrenderAllowed() {return m_surrender_allowed;};
@@ -96,7 +117,7 @@ protected:
 	void		PlayInitiative();
 	void		PlayInitiativeChance();
 	void		PlayInitiativeFocus();
-	void		PlayFight(BMC_Move *_start_action = NULL);
+	void		PlayFight(BMC_Move *_start_action = NULL, bool _forked = false);
 	void		FinishPreround();
 	void		FinishInitiative();
 	void		FinishInitiativeChance(bool _swap_phase_player);
@@ -114,6 +135,11 @@ private:
 	U8			m_phase_player;
 	U8			m_target_player;
 	BME_ACTION	m_last_action;
+	float		m_fight_win;		// P(win) for player 0 if the tablebase ended the fight, otherwise -1
+	float		m_fight_tie;		// P(tie) if the tablebase ended the fight
+
+	// random stream for all rolls in this game (copied along with the game)
+	BMC_RNG		m_rng;
 
 	// AI players
 	BMC_AI *	m_ai[BMD_MAX_PLAYERS];
@@ -126,3 +152,9 @@ private:
 
 	bool		m_surrender_allowed;
 };
+
+// the game is copied millions of times per decision, so it must stay a flat copy.  A copy keeps the source's
+// m_simulation, so an AI copying the real game into a sim calls SetSimulation(true).
+static_assert(std::is_trivially_copyable<BMC_RNG>::value, "BMC_RNG must be trivially copyable");
+static_assert(std::is_trivially_copyable<BMC_Game>::value, "BMC_Game must be trivially copyable");
+static_assert(sizeof(BMC_Game) <= 664, "BMC_Game has grown, check the copy cost");
@@ -0,0 +1,548 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_MCTS.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: Monte Carlo Tree Search AI.  Each iteration walks the tree from the root with UCB1, opening
+// new edges and sampling new reroll outcomes as the visit counts grow (progressive widening), adds one
+// node and plays the rest of the round out with QAI.  The move with the most visits is selected.
+//
+// REVISION HISTORY:
+// dbl101626 - added UCT search with chance nodes, progressive widening and QAI rollouts
+// dbl101626 - optional tree reuse between decisions, and pondering on the opponent's time
+// dbl101626 - QAI picks the move if no iterations ran
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_MCTS.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include "BMC_Logger.h"
+#include "BMC_Stats.h"
+
+
+BMC_MCTS::BMC_MCTS(BMC_AI *_qai) : m_ponder_stop(false), m_pondering(false)
+{
+	m_qai = _qai;
+
+	// SETTINGS
+	m_iterations = 5000;
+	m_exploration = 0.7f;
+	m_widening = 2.0f;
+	m_chance_widening = 1.0f;
+	m_reuse = false;
+	m_ponder_iterations = 0;
+
+	m_last_probability_win = 0;
+	m_reused_visits = 0;
+	m_decision = 0;
+}
+
+BMC_MCTS::BMC_Node::BMC_Node(const BMC_Game &_state) :
+	state(true), visits(0), widened(0), terminal(false), terminal_value(0)
+{
+	state = _state;
+	state.SetSimulation(true);
+	hash = state.GetPositionHash();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// fight
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// PRE: this is the phasing player
+void BMC_MCTS::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
+{
+	StopPonder();
+
+	m_decision = _game->GetRNG().GetRand64();
+	m_rng.SetStream(m_decision);
+
+	m_reused_visits = 0;
+	if (!m_reuse || !Reroot(_game))
+	{
+		m_nodes.clear();
+		AddNode(*_game, false);
+	}
+
+	// each iteration adds at most one node, so the pool never reallocates during the search
+	INT i;
+	INT iterations = m_iterations - m_reused_visits;
+	m_nodes.reserve(m_nodes.size() + std::max(iterations, 0));
+	for (i=0; i<iterations; i++)
+		RunIteration(i);
+
+	// no iterations (and nothing reused) means no edge was opened, so let QAI pick
+	BMC_Node &	root = m_nodes[0];
+	if (root.widened<1)
+	{
+		m_qai->GetAttackAction(_game, _move);
+		m_last_probability_win = 0.5f;
+		if (!m_reuse)
+			m_nodes.clear();
+		return;
+	}
+
+	// select the most visited move
+	INT			pov = _game->GetPhasePlayerID();
+	INT			best = 0;
+	for (i=1; i<root.widened; i++)
+	{
+		if (root.edges[i].visits > root.edges[best].visits)
+			best = i;
+	}
+
+	for (i=0; i<root.widened; i++)
+	{
+		BMC_Edge &edge = root.edges[i];
+		g_logger.Log(BME_DEBUG_SIMULATION, "mcts p%d m%d visits %d outcomes %d score %.3f - ", pov, i,
+			edge.visits, (INT)edge.outcome_node.size(), edge.GetMean(pov));
+		edge.move.Debug(&root.state, BME_DEBUG_SIMULATION);
+	}
+
+	_move = root.edges[best].move;
+	m_last_probability_win = root.edges[best].GetMean(pov);
+
+	g_logger.Log(BME_DEBUG_SIMULATION, "mcts p%d best move (%d nodes, %d reused visits, %.1f%% win) ", pov,
+		(INT)m_nodes.size(), m_reused_visits, m_last_probability_win * 100);
+	_move.Debug(_game, BME_DEBUG_SIMULATION);
+
+	// SURRENDER: if best move is 0% win, then surrender
+	if (m_last_probability_win==0 && _game->IsSurrenderAllowed())
+		_move.m_action = BME_ACTION_SURRENDER;
+
+	if (!m_reuse)
+		m_nodes.clear();
+	else if (m_ponder_iterations>0 && _move.m_action!=BME_ACTION_SURRENDER)
+		StartPonder(best);
+}
+
+// DESC: add a decision node for _state.  Its edges are ordered by the one-sample ScoreAttack() estimate,
+// which is the order progressive widening opens them in.
+// RETURNS: index of the new node
+INT BMC_MCTS::AddNode(BMC_Game &_state, bool _terminal)
+{
+	m_nodes.emplace_back(_state);
+	INT			index = (INT)m_nodes.size() - 1;
+	BMC_Node &	node = m_nodes[index];
+
+	node.terminal = _terminal;
+	if (_terminal)
+	{
+		node.terminal_value = GetResult(node.state);
+		return index;
+	}
+
+	BMC_MoveList	movelist;
+	node.state.GenerateValidAttacks(movelist);
+
+	INT i, moves = movelist.Size();
+	std::vector<F32> prior(moves);
+	std::vector<INT> order(moves);
+	for (i=0; i<moves; i++)
+	{
+		prior[i] = ScoreAttack(&node.state, *movelist.Get(i));
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&prior](INT _a, INT _b) { return prior[_a] > prior[_b]; });
+
+	node.edges.resize(moves);
+	for (i=0; i<moves; i++)
+		node.edges[i].move = *movelist.Get(order[i]);
+
+	return index;
+}
+
+// DESC: one selection/expansion/rollout/backup pass from the root
+// PARAM: _root_edge is the edge to take from the root, -1 to select it as usual
+// RETURNS: the result wrt player 0
+F32 BMC_MCTS::RunIteration(INT _iteration, INT _root_edge)
+{
+	struct Step { INT node, edge, outcome; };
+	std::vector<Step>	path;
+	BMC_Game			sim(true);
+	INT					n = 0;
+	F32					result;
+
+	for (;;)
+	{
+		if (m_nodes[n].terminal)
+		{
+			result = m_nodes[n].terminal_value;
+			break;
+		}
+
+		// open the next edge if the node has enough visits, otherwise UCB1
+		BMC_Node &	node = m_nodes[n];
+		INT			e;
+		if (n==0 && _root_edge>=0)
+			e = _root_edge;
+		else if (node.widened < (INT)node.edges.size() && node.widened < GetWidening(node.visits, m_widening))
+			e = node.widened++;
+		else
+			e = SelectEdge(node);
+
+		BMC_Edge &	edge = node.edges[e];
+		INT			outcomes = (INT)edge.outcome_node.size();
+		INT			o;
+
+		// sample another outcome if the chance node has enough visits, otherwise revisit a known one
+		if (outcomes < (INT)std::ceil(m_chance_widening * std::sqrt((F32)edge.visits + 1)))
+		{
+			sim = node.state;
+			sim.GetRNG().SetStream(BMC_RNG::MakeKey(m_decision, _iteration, path.size()));
+
+			BMC_Move	move = edge.move;
+			bool		over = !sim.ApplyFightAction(move) || sim.FightOver() || sim.GetPhase()!=BME_PHASE_FIGHT;
+			U64			hash = sim.GetStateHash();
+
+			for (o=0; o<outcomes; o++)
+			{
+				if (edge.outcome_hash[o]==hash)
+					break;
+			}
+
+			// a new outcome: add the leaf and roll out from it
+			if (o==outcomes)
+			{
+				INT child = AddNode(sim, over);
+				BMC_Edge &new_edge = m_nodes[n].edges[e];
+				new_edge.outcome_hash.push_back(hash);
+				new_edge.outcome_node.push_back(child);
+				new_edge.outcome_visits.push_back(0);
+				path.push_back({n, e, o});
+
+				result = over ? m_nodes[child].terminal_value : Rollout(sim);
+				break;
+			}
+		}
+		else
+			o = SampleOutcome(edge);
+
+		path.push_back({n, e, o});
+		n = edge.outcome_node[o];
+	}
+
+	// backup
+	for (Step &step : path)
+	{
+		BMC_Node &node = m_nodes[step.node];
+		BMC_Edge &edge = node.edges[step.edge];
+		node.visits++;
+		edge.visits++;
+		edge.value += result;
+		edge.outcome_visits[step.outcome]++;
+	}
+
+	return result;
+}
+
+// PRE: all open edges have been visited
+INT BMC_MCTS::SelectEdge(BMC_Node &_node)
+{
+	INT		pov = _node.state.GetPhasePlayerID();
+	F32		log_visits = std::log((F32)_node.visits);
+	INT		best = -1;
+	F32		best_ucb = 0;
+
+	for (INT e=0; e<_node.widened; e++)
+	{
+		BMC_Edge &edge = _node.edges[e];
+		BM_ASSERT(edge.visits>0);
+		F32 ucb = edge.GetMean(pov) + m_exploration * std::sqrt(log_visits / edge.visits);
+		if (best<0 || ucb > best_ucb)
+		{
+			best = e;
+			best_ucb = ucb;
+		}
+	}
+
+	return best;
+}
+
+// DESC: pick a known outcome in proportion to how often it was reached, which follows the roll probabilities
+INT BMC_MCTS::SampleOutcome(BMC_Edge &_edge)
+{
+	INT total = std::accumulate(_edge.outcome_visits.begin(), _edge.outcome_visits.end(), 0);
+	BM_ASSERT(total>0);
+
+	INT r = m_rng.GetRand(total);
+	INT o;
+	for (o=0; o<(INT)_edge.outcome_visits.size()-1; o++)
+	{
+		r -= _edge.outcome_visits[o];
+		if (r<0)
+			break;
+	}
+	return o;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// reuse and pondering
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// DESC: if _game is a decision node of the kept tree, make its subtree the whole tree.  The parser does not know
+// the last action, so nodes reached by a pass (where a second pass ends the fight) are not matched.
+// RETURNS: true if the tree was rerooted, with m_reused_visits set
+bool BMC_MCTS::Reroot(BMC_Game *_game)
+{
+	U64 hash = _game->GetPositionHash();
+	INT found = -1;
+	INT n;
+
+	// the same position can be reached on more than one path, keep the most searched
+	for (n=0; n<(INT)m_nodes.size(); n++)
+	{
+		BMC_Node &node = m_nodes[n];
+		if (node.terminal || node.hash!=hash || node.state.GetLastAction()==BME_ACTION_PASS)
+			continue;
+		if (found<0 || node.visits > m_nodes[found].visits)
+			found = n;
+	}
+
+	if (found<0)
+		return false;
+
+	// copy the subtree out breadth first.  Outcome nodes have one parent, so each node is moved once.  The
+	// reserve keeps the edge references valid while children are appended.
+	std::vector<BMC_Node> tree;
+	tree.reserve(m_nodes.size() + m_iterations + 1);
+	tree.push_back(std::move(m_nodes[found]));
+	for (n=0; n<(INT)tree.size(); n++)
+	{
+		for (BMC_Edge &edge : tree[n].edges)
+		{
+			for (INT &child : edge.outcome_node)
+			{
+				tree.push_back(std::move(m_nodes[child]));
+				child = (INT)tree.size() - 1;
+			}
+		}
+	}
+	m_nodes.swap(tree);
+
+	// the root takes the real game, for its RNG and AIs
+	m_nodes[0].state = *_game;
+	m_nodes[0].state.SetSimulation(true);
+	m_reused_visits = m_nodes[0].visits;
+	return true;
+}
+
+// DESC: grow the subtree of root edge _edge on a background thread, which stops at StopPonder() or after
+// m_ponder_iterations iterations
+void BMC_MCTS::StartPonder(INT _edge)
+{
+	StopPonder();
+
+	m_nodes.reserve(m_nodes.size() + m_ponder_iterations);
+	m_ponder_stop = false;
+	m_pondering = true;
+	m_ponder_thread = std::thread(&BMC_MCTS::Ponder, this, _edge, m_iterations);
+}
+
+// DESC: pondering thread.  Iterations are numbered after the search's, so they draw new RNG streams.
+void BMC_MCTS::Ponder(INT _edge, INT _first_iteration)
+{
+	for (INT i=0; i<m_ponder_iterations && !m_ponder_stop; i++)
+		RunIteration(_first_iteration + i, _edge);
+
+	m_pondering = false;
+}
+
+// DESC: stop pondering.  The tree is left as it is, for the next decision to reuse.
+void BMC_MCTS::StopPonder()
+{
+	if (!m_ponder_thread.joinable())
+		return;
+
+	m_ponder_stop = true;
+	m_ponder_thread.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// preround and initiative
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void BMC_MCTS::GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
+{
+	BMC_MoveList	movelist;
+	_game->GenerateValidSetSwing(movelist);
+	BM_ASSERT(movelist.Size()>0);
+
+	SearchRoot(_game, movelist, _move);
+}
+
+// PRE: we are m_phase_player
+void BMC_MCTS::GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
+{
+	BM_ASSERT(_game->GetPhase() == BME_PHASE_INITIATIVE_CHANCE);
+
+	BMC_MoveList	movelist;
+	_game->GenerateValidChance(movelist);
+	BM_ASSERT(movelist.Size()>0);
+
+	SearchRoot(_game, movelist, _move);
+}
+
+// PRE: we are m_phase_player (but don't have initiative)
+void BMC_MCTS::GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
+{
+	BM_ASSERT(_game->GetPhase() == BME_PHASE_INITIATIVE_FOCUS);
+
+	BMC_MoveList	movelist;
+	_game->GenerateValidFocus(movelist);
+	BM_ASSERT(movelist.Size()>0);
+
+	SearchRoot(_game, movelist, _move);
+}
+
+// DESC: UCB1 over the root moves with progressive widening, one rollout per pull.  The moves are shuffled
+// first, so widening samples a huge setswing list evenly.
+void BMC_MCTS::SearchRoot(BMC_Game *_game, BMC_MoveList &_movelist, BMC_Move &_move)
+{
+	StopPonder();
+
+	m_decision = _game->GetRNG().GetRand64();
+	m_rng.SetStream(m_decision);
+
+	INT i, m;
+	INT moves = _movelist.Size();
+	std::vector<INT> order(moves);
+	std::iota(order.begin(), order.end(), 0);
+	for (i=moves-1; i>0; i--)
+		std::swap(order[i], order[m_rng.GetRand(i+1)]);
+
+	std::vector<INT> visits(moves, 0);
+	std::vector<F32> value(moves, 0);	// wrt the phase player
+	INT widened = 0;
+
+	for (i=0; i<m_iterations; i++)
+	{
+		if (widened < moves && widened < GetWidening(i, m_widening))
+			m = order[widened++];
+		else
+		{
+			F32 log_visits = std::log((F32)i);
+			F32 best_ucb = 0;
+			m = -1;
+			for (INT k=0; k<widened; k++)
+			{
+				INT c = order[k];
+				F32 ucb = value[c] / visits[c] + m_exploration * std::sqrt(log_visits / visits[c]);
+				if (m<0 || ucb > best_ucb)
+				{
+					m = c;
+					best_ucb = ucb;
+				}
+			}
+		}
+
+		value[m] += SimulateRootMove(_game, *_movelist.Get(m), i);
+		visits[m]++;
+	}
+
+	// no iterations means no move was tried, so let QAI pick
+	if (widened<1)
+	{
+		switch (_game->GetPhase())
+		{
+		case BME_PHASE_PREROUND:
+			m_qai->GetSetSwingAction(_game, _move);
+			break;
+		case BME_PHASE_INITIATIVE_CHANCE:
+			m_qai->GetUseChanceAction(_game, _move);
+			break;
+		case BME_PHASE_INITIATIVE_FOCUS:
+			m_qai->GetUseFocusAction(_game, _move);
+			break;
+		default:
+			BM_ASSERT(0);
+			break;
+		}
+		m_last_probability_win = 0.5f;
+		return;
+	}
+
+	INT best = order[0];
+	for (i=1; i<widened; i++)
+	{
+		if (visits[order[i]] > visits[best])
+			best = order[i];
+	}
+
+	_move = *_movelist.Get(best);
+	m_last_probability_win = value[best] / visits[best];
+
+	g_logger.Log(BME_DEBUG_SIMULATION, "mcts p%d best move (%d of %d moves tried, %.1f%% win) ", _game->GetPhasePlayerID(),
+		widened, moves, m_last_probability_win * 100);
+	_move.Debug(_game, BME_DEBUG_SIMULATION);
+}
+
+// RETURNS: the result of one rollout after _move, wrt the phase player of _game
+F32 BMC_MCTS::SimulateRootMove(BMC_Game *_game, BMC_Move &_move, INT _iteration)
+{
+	BMC_Game	sim(true);
+	BMC_Move	move = _move;
+
+	sim = *_game;
+	sim.SetSimulation(true);
+	sim.GetRNG().SetStream(BMC_RNG::MakeKey(m_decision, _iteration));
+
+	switch (_game->GetPhase())
+	{
+	case BME_PHASE_PREROUND:
+		sim.ApplySetSwing(move);
+		break;
+	case BME_PHASE_INITIATIVE_CHANCE:
+		sim.ApplyUseChance(move);
+		break;
+	case BME_PHASE_INITIATIVE_FOCUS:
+		sim.ApplyUseFocus(move);
+		break;
+	default:
+		BM_ASSERT(0);
+		break;
+	}
+
+	F32 result = Rollout(sim);
+	return (_game->GetPhasePlayerID()==0) ? result : 1 - result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// helpers
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// RETURNS: how many children may be open after _visits visits
+INT BMC_MCTS::GetWidening(INT _visits, F32 _c)
+{
+	return 1 + (INT)(_c * std::sqrt((F32)_visits));
+}
+
+// DESC: play the rest of the round with QAI
+// RETURNS: 1/0.5/0 wrt player 0
+F32 BMC_MCTS::Rollout(BMC_Game &_sim)
+{
+	_sim.SetAI(0, m_qai);
+	_sim.SetAI(1, m_qai);
+	g_stats.OnFullSimulation();
+
+	BME_WLT rv = _sim.PlayRound(NULL);
+	if (rv==BME_WLT_TIE)
+		return 0.5f;
+	return (rv==BME_WLT_WIN) ? 1.0f : 0.0f;
+}
+
+// RETURNS: 1/0.5/0 wrt player 0 for a finished fight
+F32 BMC_MCTS::GetResult(BMC_Game &_game)
+{
+	F32 s0 = _game.GetPlayer(0)->GetScore();
+	F32 s1 = _game.GetPlayer(1)->GetScore();
+	if (s0 > s1)
+		return 1.0f;
+	else if (s1 > s0)
+		return 0.0f;
+	return 0.5f;
+}
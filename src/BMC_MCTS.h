@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_MCTS.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: Monte Carlo Tree Search AI
+//
+// REVISION HISTORY:
+// dbl101626 - added UCT search with chance nodes, progressive widening and QAI rollouts
+// dbl101626 - optional tree reuse between decisions, and pondering on the opponent's time
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "BMC_AI.h"
+
+
+// UCT AI.  Unlike BMAI3, which restarts a full search at every inner ply, this grows one tree per decision:
+// - a decision node for each fight state, with an edge per valid attack ordered by ScoreAttack()
+// - below each edge, a chance node whose children are the distinct reroll outcomes (by GetStateHash())
+// - UCB1 selection, progressive widening of both edges and outcomes, and QAI rollouts from new leaves
+// Non-fight decisions (swing, chance, focus) only have a root, so they run a widened UCB bandit over rollouts.
+//
+// With reuse on, the tree is kept after a fight decision.  If the next position is a node of the old tree (by
+// GetPositionHash()) its subtree becomes the new root, and its visits count towards the iterations of the new
+// decision.  Pondering keeps growing the subtree of the chosen move on a background thread until the next call
+// (or StopPonder()), so a predicted reply may need no new iterations at all.
+class BMC_MCTS : public BMC_AI
+{
+public:
+	BMC_MCTS(BMC_AI *_qai);
+	~BMC_MCTS() { StopPonder(); }
+
+	virtual void	GetAttackAction(BMC_Game *_game, BMC_Move &_move);
+	virtual void	GetSetSwingAction(BMC_Game *_game, BMC_Move &_move);
+	virtual void	GetUseChanceAction(BMC_Game *_game, BMC_Move &_move);
+	virtual void	GetUseFocusAction(BMC_Game *_game, BMC_Move &_move);
+	void			StopPonder();
+
+	// mutators
+	void		SetQAI(BMC_AI *_ai) { m_qai = _ai; }
+	void		SetIterations(INT _i) { m_iterations = _i; }
+	void		SetExploration(F32 _c) { m_exploration = _c; }
+	void		SetReuse(bool _reuse) { StopPonder(); m_reuse = _reuse; if (!_reuse) m_nodes.clear(); }
+	void		SetPonder(INT _iterations) { StopPonder(); m_ponder_iterations = _iterations; }
+
+	// accessors
+	INT			GetIterations() { return m_iterations; }
+	F32			GetExploration() { return m_exploration; }
+	F32			GetLastProbabilityWin() { return m_last_probability_win; }
+	bool		GetReuse() { return m_reuse; }
+	INT			GetPonder() { return m_ponder_iterations; }
+	INT			GetReusedVisits() { return m_reused_visits; }
+	bool		IsPondering() { return m_pondering; }
+
+	// class testing
+	virtual bool	IsBMAI3() { return false; }
+
+protected:
+	// an action out of a decision node, and the chance node for its outcomes
+	class BMC_Edge {
+	public:
+		BMC_Edge() : visits(0), value(0) {}
+		F32				GetMean(INT _pov) { return (_pov==0) ? value / visits : 1 - value / visits; }
+
+		BMC_Move		move;
+		INT				visits;
+		F32				value;					// sum of results wrt player 0
+		std::vector<U64> outcome_hash;
+		std::vector<INT> outcome_node;
+		std::vector<INT> outcome_visits;
+	};
+
+	class BMC_Node {
+	public:
+		BMC_Node(const BMC_Game &_state);
+
+		BMC_Game		state;
+		U64				hash;					// GetPositionHash() of state
+		INT				visits;
+		INT				widened;				// number of edges open for selection
+		bool			terminal;
+		F32				terminal_value;			// result wrt player 0, if terminal
+		std::vector<BMC_Edge> edges;			// ordered by prior
+	};
+
+	// tree search (fight)
+	INT				AddNode(BMC_Game &_state, bool _terminal);
+	F32				RunIteration(INT _iteration, INT _root_edge = -1);
+	INT				SelectEdge(BMC_Node &_node);
+	INT				SampleOutcome(BMC_Edge &_edge);
+
+	// reuse and pondering
+	bool			Reroot(BMC_Game *_game);
+	void			StartPonder(INT _edge);
+	void			Ponder(INT _edge, INT _first_iteration);
+
+	// bandit (other phases)
+	void			SearchRoot(BMC_Game *_game, BMC_MoveList &_movelist, BMC_Move &_move);
+	F32				SimulateRootMove(BMC_Game *_game, BMC_Move &_move, INT _iteration);
+
+	// helpers
+	INT				GetWidening(INT _visits, F32 _c);
+	F32				Rollout(BMC_Game &_sim);
+	static F32		GetResult(BMC_Game &_game);
+
+	BMC_AI *		m_qai;
+	INT				m_iterations;
+	F32				m_exploration;			// UCB1 exploration constant
+	F32				m_widening;				// edges open = 1 + c*sqrt(visits)
+	F32				m_chance_widening;		// outcomes kept = c*sqrt(visits+1), rounded up
+	F32				m_last_probability_win;
+	bool			m_reuse;				// keep the tree between fight decisions
+	INT				m_ponder_iterations;	// iterations to run after a decision on the opponent's time, 0 for off
+	INT				m_reused_visits;		// root visits kept from the last tree by the last decision
+
+	// per-search
+	std::vector<BMC_Node>	m_nodes;
+	BMC_RNG			m_rng;					// for sampling outcomes
+	U64				m_decision;				// RNG key of this search
+
+	// pondering
+	std::thread		m_ponder_thread;
+	std::atomic<bool>	m_ponder_stop;
+	std::atomic<bool>	m_pondering;
+};
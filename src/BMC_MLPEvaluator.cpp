@@ -0,0 +1,177 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_MLPEvaluator.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: small neural network (or linear) evaluator over hand-picked game features
+//
+// REVISION HISTORY:
+// dbl101626 - added
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_MLPEvaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "BMC_Game.h"
+#include "BMC_Logger.h"
+
+
+// properties that change the value of a die the most, in feature order
+static const U64 c_eval_properties[BMC_MLPEvaluator::PROPERTY_FEATURES] = {
+	BME_PROPERTY_SHADOW,
+	BME_PROPERTY_POISON,
+	BME_PROPERTY_SPEED,
+	BME_PROPERTY_TRIP,
+	BME_PROPERTY_BERSERK,
+	BME_PROPERTY_NULL,
+	BME_PROPERTY_STINGER,
+	BME_PROPERTY_VALUE,
+};
+
+// rough ranges, to keep the inputs near [0,1]
+static const float c_eval_score_scale = 1.0f / 50;
+static const float c_eval_sides_scale = 1.0f / 20;
+
+// global
+BMC_MLPEvaluator	g_evaluator;
+
+BMC_MLPEvaluator::BMC_MLPEvaluator()
+{
+	m_layers = 0;
+}
+
+// RETURNS: false if the file could not be read or does not match FEATURES
+bool BMC_MLPEvaluator::Load(const char *_filename)
+{
+	Unload();
+
+	FILE *fp = fopen(_filename, "r");
+	if (!fp)
+		return false;
+
+	char magic[32];
+	INT version, layers, l, i, j;
+	bool ok = fscanf(fp, "%31s %d %d", magic, &version, &layers)==3
+		&& std::strcmp(magic, "bmai_eval")==0 && version==1 && layers>=1;
+
+	std::vector<INT> width(ok ? layers+1 : 0);
+	for (l=0; ok && l<=layers; l++)
+		ok = fscanf(fp, "%d", &width[l])==1 && width[l]>0 && (l==0 || width[l]<=BMD_EVAL_MAX_WIDTH);
+	ok = ok && width[0]==FEATURES && width[layers]==1;
+
+	// each layer is transposed as it is read
+	for (l=0; ok && l<layers; l++)
+	{
+		INT in = width[l];
+		INT out = width[l+1];
+		INT start = (INT)m_weights.size();
+		INT bias = (INT)m_bias.size();
+		m_weights.resize(start + in * out);
+		m_bias.resize(bias + out);
+		for (j=0; ok && j<out; j++)
+		{
+			for (i=0; ok && i<in; i++)
+				ok = fscanf(fp, "%f", &m_weights[start + i * out + j])==1;
+			ok = ok && fscanf(fp, "%f", &m_bias[bias + j])==1;
+		}
+	}
+	fclose(fp);
+
+	if (!ok)
+	{
+		Unload();
+		return false;
+	}
+
+	m_width = width;
+	m_layers = layers;
+	return true;
+}
+
+void BMC_MLPEvaluator::Unload()
+{
+	m_layers = 0;
+	m_width.clear();
+	m_weights.clear();
+	m_bias.clear();
+}
+
+float BMC_MLPEvaluator::Evaluate(BMC_Game *_game, INT _pov)
+{
+	BM_ASSERT(IsLoaded());
+
+	float features[FEATURES];
+	float a[BMD_EVAL_MAX_WIDTH], b[BMD_EVAL_MAX_WIDTH];
+	INT i, j, l;
+
+	GetFeatures(_game, _pov, features);
+
+	// each layer adds the weight column of every non-zero input, after the ReLU of the layer before
+	const float *w = m_weights.data();
+	const float *bias = m_bias.data();
+	const float *in = features;
+	float *out = a;
+	INT n = FEATURES;
+	for (l=0; l<m_layers; l++)
+	{
+		INT width = m_width[l+1];
+		std::memcpy(out, bias, width * sizeof(float));
+		for (i=0; i<n; i++)
+		{
+			float x = (l>0) ? std::max(in[i], 0.0f) : in[i];
+			if (x==0)
+				continue;
+			const float *column = w + i * width;
+			for (j=0; j<width; j++)
+				out[j] += column[j] * x;
+		}
+
+		w += n * width;
+		bias += width;
+		in = out;
+		n = width;
+		out = (out==a) ? b : a;
+	}
+
+	return 1.0f / (1.0f + std::exp(-in[0]));
+}
+
+// DESC: the inputs of the network, from _pov's point of view (so one network serves both players)
+// PARAM: _features must hold FEATURES values
+void BMC_MLPEvaluator::GetFeatures(BMC_Game *_game, INT _pov, float *_features)
+{
+	bool fight = _game->GetPhase()==BME_PHASE_FIGHT;
+	_features[0] = (fight && _game->GetPhasePlayerID()==_pov) ? 1.0f : 0.0f;
+	_features[1] = (fight && _game->GetPhasePlayerID()!=_pov) ? 1.0f : 0.0f;
+	_features[2] = fight ? 0.0f : 1.0f;
+
+	GetPlayerFeatures(_game->GetPlayer(_pov), _features + 3);
+	GetPlayerFeatures(_game->GetPlayer(!_pov), _features + 3 + PLAYER_FEATURES);
+}
+
+// DESC: score and dice in play, largest first (the order BMC_Player::OptimizeDice() keeps them in)
+void BMC_MLPEvaluator::GetPlayerFeatures(BMC_Player *_player, float *_features)
+{
+	INT dice = _player->GetAvailableDice();
+	BM_ASSERT(dice<=BMD_MAX_DICE);
+
+	std::memset(_features, 0, PLAYER_FEATURES * sizeof(float));
+	_features[0] = _player->GetScore() * c_eval_score_scale;
+	_features[1] = (float)dice / BMD_MAX_DICE;
+
+	float *f = _features + 2;
+	for (INT d=0; d<dice; d++, f+=DIE_FEATURES)
+	{
+		BMC_Die *die = _player->GetDie(d);
+		f[0] = 1;
+		f[1] = die->GetSidesMax() * c_eval_sides_scale;
+		f[2] = die->GetValueTotal() * c_eval_sides_scale;
+		for (INT p=0; p<PROPERTY_FEATURES; p++)
+			f[3 + p] = die->HasProperty(c_eval_properties[p]) ? 1.0f : 0.0f;
+	}
+}
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_MLPEvaluator.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: small neural network (or linear) evaluator over hand-picked game features
+//
+// REVISION HISTORY:
+// dbl101626 - added
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include "BMC_Evaluator.h"
+
+
+class BMC_Player;
+
+// A fully connected network with ReLU hidden layers and a sigmoid output, or a logistic regression if it has no
+// hidden layers.  The inputs are GetFeatures(), from the point of view of the player being evaluated.  Weights are
+// kept by input, so a layer only adds the columns of its non-zero inputs: most die slots are empty, and about half
+// of the hidden units are cut by the ReLU.
+//
+// Weights are a text file:
+//	bmai_eval 1
+//	<layers> <inputs> <width 1> ... <outputs = 1>
+//	then for each layer, one line per output: its input weights followed by its bias
+class BMC_MLPEvaluator : public BMC_Evaluator
+{
+public:
+	enum {
+		PROPERTY_FEATURES = 8,
+		DIE_FEATURES = 3 + PROPERTY_FEATURES,					// in play, sides, value, properties
+		PLAYER_FEATURES = 2 + BMD_MAX_DICE * DIE_FEATURES,		// score, dice in play, die slots
+		FEATURES = 3 + 2 * PLAYER_FEATURES,						// phase, then _pov's player and the opponent
+	};
+
+	BMC_MLPEvaluator();
+
+	// methods
+	bool			Load(const char *_filename);
+	void			Unload();
+	virtual float	Evaluate(BMC_Game *_game, INT _pov);
+	static void		GetFeatures(BMC_Game *_game, INT _pov, float *_features);
+
+	// accessors
+	bool			IsLoaded() { return m_layers>0; }
+	INT				GetLayers() { return m_layers; }
+
+private:
+	static void		GetPlayerFeatures(BMC_Player *_player, float *_features);
+
+	INT				m_layers;
+	std::vector<INT>	m_width;			// m_layers+1 widths, inputs first
+	std::vector<float>	m_weights;		// all layers, each one column-major (by input)
+	std::vector<float>	m_bias;			// all layers
+};
+
+// global
+extern BMC_MLPEvaluator	g_evaluator;
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_MappedFile.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: read-only memory-mapped file
+//
+// REVISION HISTORY:
+// dbl101626 - split out of BMC_TableBase for the opening book
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_MappedFile.h"
+
+#include <cstdio>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+BMC_MappedFile::BMC_MappedFile()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_map = NULL;
+}
+
+// RETURNS: false if the file could not be opened, or is empty
+bool BMC_MappedFile::Open(const char *_filename)
+{
+	Close();
+
+#ifdef _WIN32
+	FILE *fp = fopen(_filename, "rb");
+	if (!fp)
+		return false;
+	fseek(fp, 0, SEEK_END);
+	U64 size = (U64)ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	m_buffer.resize(size);
+	bool ok = size>0 && fread(m_buffer.data(), 1, size, fp)==size;
+	fclose(fp);
+	if (!ok)
+	{
+		m_buffer.clear();
+		return false;
+	}
+	m_data = m_buffer.data();
+	m_size = size;
+#else
+	int fd = open(_filename, O_RDONLY);
+	if (fd<0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st)!=0 || st.st_size<=0)
+	{
+		close(fd);
+		return false;
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map==MAP_FAILED)
+		return false;
+	m_map = map;
+	m_data = (const U8 *)map;
+	m_size = st.st_size;
+#endif
+
+	return true;
+}
+
+void BMC_MappedFile::Close()
+{
+#ifndef _WIN32
+	if (m_map)
+		munmap(m_map, m_size);
+#endif
+	m_buffer.clear();
+	m_map = NULL;
+	m_data = NULL;
+	m_size = 0;
+}
@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_MappedFile.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: read-only memory-mapped file
+//
+// REVISION HISTORY:
+// dbl101626 - split out of BMC_TableBase for the opening book
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "bmai_lib.h"
+
+
+// Maps a whole file read-only, so large tables are paged in on demand and shared by all threads.  Where mmap is
+// not available the file is read into memory instead.
+class BMC_MappedFile
+{
+public:
+	BMC_MappedFile();
+	~BMC_MappedFile() { Close(); }
+
+	// methods
+	bool			Open(const char *_filename);
+	void			Close();
+
+	// accessors
+	bool			IsOpen() { return m_data != NULL; }
+	const U8 *		GetData() { return m_data; }
+	U64				GetSize() { return m_size; }
+
+private:
+	// not copyable
+	BMC_MappedFile(const BMC_MappedFile &);
+	BMC_MappedFile & operator=(const BMC_MappedFile &);
+
+	const U8 *		m_data;
+	U64				m_size;
+	void *			m_map;
+	std::vector<U8>	m_buffer;
+};
@@ -7,6 +7,7 @@
 //
 // REVISION HISTORY:
 // dbl100524 - broke this logic out into its own class file
+// dbl101626 - the game is passed in, moves no longer hold it
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BMC_Move.h"
@@ -45,13 +46,13 @@ const char *c_action_name[BME_ACTION_MAX] =
 	"surrender",
 };
 
-void BMC_Move::Debug(BME_DEBUG _cat, const char *_postfix)
+void BMC_Move::Debug(BMC_Game *_game, BME_DEBUG _cat, const char *_postfix)
 {
 	if (!g_logger.IsLogging(_cat))
 		return;
 
 	INT i;
-	BMC_Player *phaser = m_game->GetPhasePlayer();
+	BMC_Player *phaser = _game->GetPhasePlayer();
 
 	printf("%s ", c_action_name[m_action]);
 
@@ -119,8 +120,8 @@ void BMC_Move::Debug(BME_DEBUG _cat, const char *_postfix)
 
 	case BME_ACTION_ATTACK:
 		{
-			BMC_Player *attacker = GetAttacker();
-			BMC_Player *target = GetTarget();
+			BMC_Player *attacker = GetAttacker(_game);
+			BMC_Player *target = GetTarget(_game);
 			INT printed;
 
 			printf("%s - ", c_attack_name[m_attack]);
@@ -178,14 +179,14 @@ void BMC_Move::Debug(BME_DEBUG _cat, const char *_postfix)
 	return;
 }
 
-BMC_Player *BMC_Move::GetAttacker()
+BMC_Player *BMC_Move::GetAttacker(BMC_Game *_game)
 {
-	return m_game->GetPlayer(m_attacker_player);
+	return _game->GetPlayer(m_attacker_player);
 }
 
-BMC_Player *BMC_Move::GetTarget()
+BMC_Player *BMC_Move::GetTarget(BMC_Game *_game)
 {
-	return m_game->GetPlayer(m_target_player);
+	return _game->GetPlayer(m_target_player);
 }
 
 BMC_MoveList::BMC_MoveList()
@@ -9,10 +9,12 @@
 // dbl100524 - further split out of individual headers
 // dbl021125 - extern c_action_name, makes unit tests more readable
 // dbl032526 - allow single-die skill; enforce that Stealth overrides added attacks and only interacts via multi-die skill
+// dbl101626 - dropped m_game, so a move is 16 bytes; Debug(), GetAttacker() and GetTarget() take the game
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
+#include <type_traits>
 #include <vector>
 #include "BMC_BitArray.h"
 
@@ -26,20 +28,19 @@ public:
 	BMC_Move() {} //: m_pool_index(-1)	{}
 
 	// methods
-	void	Debug(BME_DEBUG _cat = BME_DEBUG_ALWAYS, const char *_postfix = "\n");
+	void	Debug(BMC_Game *_game, BME_DEBUG _cat = BME_DEBUG_ALWAYS, const char *_postfix = "\n");
 	bool	operator<  (const BMC_Move &_m) const  { return this < &_m; }
 	bool	operator==	(const BMC_Move &_m) const { return this == &_m; }
 
 	// accessors
 	bool	MultipleAttackers() { return c_attack_type[m_attack]==BME_ATTACK_TYPE_N_1; }
 	bool	MultipleTargets()	{ return c_attack_type[m_attack]==BME_ATTACK_TYPE_1_N; }
-	BMC_Player *	GetAttacker();
-	BMC_Player *	GetTarget();
+	BMC_Player *	GetAttacker(BMC_Game *_game);
+	BMC_Player *	GetTarget(BMC_Game *_game);
 
 	// data
 	BME_ACTION					m_action;
 	//INT							m_pool_index;
-	BMC_Game					*m_game;
 	union
 	{
 		// BME_ACTION_ATTACK
@@ -81,6 +82,11 @@ public:
 	};
 };
 
+// moves are generated, copied and culled in bulk (a setswing decision can have hundreds of thousands), so they
+// do not hold the game they are for: it is passed to whatever needs the dice
+static_assert(std::is_trivially_copyable<BMC_Move>::value, "BMC_Move must be trivially copyable");
+static_assert(sizeof(BMC_Move) <= 16, "BMC_Move has grown, check the move list cost");
+
 extern const char *c_action_name[];
 
 #define	BMC_MoveAttack	BMC_Move
@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_OpeningBook.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: precomputed preround swing and option decisions by matchup
+//
+// REVISION HISTORY:
+// dbl101626 - added
+// dbl101626 - GetPlayerKey() hashes both sizes of OPTION dice
+// dbl101626 - book version 2, so books keyed the old way are rejected
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_OpeningBook.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "BMC_Game.h"
+#include "BMC_Logger.h"
+#include "BMC_RNG.h"
+
+
+static const char	c_book_magic[4] = { 'B', 'M', 'O', 'B' };
+static const UINT	c_book_version = 2;		// 2: OPTION dice keyed by both sizes
+
+// global
+BMC_OpeningBook	g_book;
+
+// RETURNS: false if the file could not be opened or is not a book
+bool BMC_OpeningBook::Load(const char *_filename)
+{
+	if (!m_file.Open(_filename))
+		return false;
+
+	Header header;
+	bool ok = m_file.GetSize() >= sizeof(header);
+	if (ok)
+	{
+		std::memcpy(&header, m_file.GetData(), sizeof(header));
+		ok = std::memcmp(header.magic, c_book_magic, sizeof(header.magic))==0
+			&& header.version==c_book_version
+			&& m_file.GetSize() == sizeof(header) + header.entries * sizeof(Entry);
+	}
+	if (!ok)
+	{
+		m_file.Close();
+		return false;
+	}
+	return true;
+}
+
+INT BMC_OpeningBook::GetEntries()
+{
+	if (!IsLoaded())
+		return 0;
+	return (INT)((m_file.GetSize() - sizeof(Header)) / sizeof(Entry));
+}
+
+// DESC: the phase player's decision for this matchup, if it is in the book and still legal
+bool BMC_OpeningBook::Probe(BMC_Game *_game, BMC_Move &_move, float &_probability)
+{
+	if (!IsLoaded())
+		return false;
+
+	U64 key = GetKey(_game);
+	const Entry *first = (const Entry *)(m_file.GetData() + sizeof(Header));
+	const Entry *last = first + GetEntries();
+	const Entry *entry = std::lower_bound(first, last, key, [](const Entry &_e, U64 _k) { return _e.key < _k; });
+	if (entry==last || entry->key!=key)
+		return false;
+
+	BMC_Move move;
+	move.m_action = BME_ACTION_SET_SWING_AND_OPTION;
+	std::memcpy(move.m_swing_value, entry->swing_value, sizeof(move.m_swing_value));
+	move.m_option_die.Clear();
+	for (INT d=0; d<BMD_MAX_DICE; d++)
+		move.m_option_die.Set(d, (entry->option_die >> d) & 1);
+	move.m_extreme_settings = 0;
+
+	// hash collisions and hand-edited books
+	if (!_game->ValidSetSwing(move))
+		return false;
+
+	_move = move;
+	_probability = entry->probability;
+	return true;
+}
+
+// DESC: add or replace the phase player's decision for this matchup.  The file is rewritten sorted, and created if it
+// does not exist.
+// RETURNS: false if the file could not be written
+bool BMC_OpeningBook::Add(const char *_filename, BMC_Game *_game, BMC_Move &_move, float _probability)
+{
+	BM_ASSERT(_move.m_action == BME_ACTION_SET_SWING_AND_OPTION);
+
+	Entry entry;
+	std::memset(&entry, 0, sizeof(entry));
+	entry.key = GetKey(_game);
+	std::memcpy(entry.swing_value, _move.m_swing_value, sizeof(entry.swing_value));
+	for (INT d=0; d<BMD_MAX_DICE; d++)
+	{
+		if (_move.m_option_die.IsSet(d))
+			entry.option_die |= 1 << d;
+	}
+	entry.probability = _probability;
+
+	// read the existing entries
+	std::vector<Entry> entries;
+	Header header;
+	FILE *fp = fopen(_filename, "rb");
+	if (fp)
+	{
+		if (fread(&header, sizeof(header), 1, fp)==1
+			&& std::memcmp(header.magic, c_book_magic, sizeof(header.magic))==0
+			&& header.version==c_book_version)
+		{
+			entries.resize(header.entries);
+			if (header.entries>0 && fread(entries.data(), sizeof(Entry), entries.size(), fp)!=entries.size())
+				entries.clear();
+		}
+		fclose(fp);
+	}
+
+	std::vector<Entry>::iterator it = std::lower_bound(entries.begin(), entries.end(), entry.key,
+		[](const Entry &_e, U64 _k) { return _e.key < _k; });
+	if (it!=entries.end() && it->key==entry.key)
+		*it = entry;
+	else
+		entries.insert(it, entry);
+
+	// write to a temporary file and swap it in, so a loaded book is never seen half written
+	std::string tmp = std::string(_filename) + ".tmp";
+	fp = fopen(tmp.c_str(), "wb");
+	if (!fp)
+		return false;
+	std::memcpy(header.magic, c_book_magic, sizeof(header.magic));
+	header.version = c_book_version;
+	header.entries = entries.size();
+	bool ok = fwrite(&header, sizeof(header), 1, fp)==1
+		&& fwrite(entries.data(), sizeof(Entry), entries.size(), fp)==entries.size();
+	ok = (fclose(fp)==0) && ok;
+	if (ok)
+	{
+		std::remove(_filename);
+		ok = std::rename(tmp.c_str(), _filename)==0;
+	}
+	if (!ok)
+		std::remove(tmp.c_str());
+	return ok;
+}
+
+// DESC: the matchup and standings from the phase player's point of view
+U64 BMC_OpeningBook::GetKey(BMC_Game *_game)
+{
+	INT pov = _game->GetPhasePlayerID();
+	BMC_Player *mover = _game->GetPlayer(pov);
+	BMC_Player *opponent = _game->GetPlayer(!pov);
+
+	// an opponent's swing is only known once locked from a previous round
+	U64 players = BMC_RNG::MakeKey(
+		GetPlayerKey(mover, mover->GetSwingDiceSet()==BMC_Player::SWING_SET_LOCKED),
+		GetPlayerKey(opponent, opponent->GetSwingDiceSet()==BMC_Player::SWING_SET_LOCKED));
+
+	INT wins = _game->GetStanding(pov==0 ? BME_WLT_WIN : BME_WLT_LOSS);
+	INT losses = _game->GetStanding(pov==0 ? BME_WLT_LOSS : BME_WLT_WIN);
+	U64 standings = (wins << 16) | (losses << 8) | _game->GetStanding(BME_WLT_TIE);
+
+	return BMC_RNG::MakeKey(players, standings, _game->GetTargetWins());
+}
+
+// DESC: sum of the die keys, so the order of the dice does not matter
+U64 BMC_OpeningBook::GetPlayerKey(BMC_Player *_player, bool _known)
+{
+	U64 key = 0;
+	for (INT d=0; d<BMD_MAX_DICE; d++)
+	{
+		BMC_Die *die = _player->GetDie(d);
+		if (!die->Valid() || die->GetState()==BME_STATE_NOTUSED)
+			continue;
+
+		// OPTION dice have both sizes in play, but Dice() is only 2 for TWIN
+		U64 sides = 0;
+		INT dice = die->HasProperty(BME_PROPERTY_OPTION) ? 2 : die->Dice();
+		for (INT t=0; t<dice; t++)
+		{
+			BME_SWING swing = die->GetSwingType(t);
+			sides = BMC_RNG::MakeKey(sides, swing!=BME_SWING_NOT ? 256 + swing : die->GetSides(t),
+				_known ? die->GetSides(t) : 0);
+		}
+
+		U64 slot = die->HasProperty(BME_PROPERTY_OPTION) ? d + 1 : 0;
+		key += BMC_RNG::MakeKey(die->GetProperties(), sides, (slot << 1) | (die->IsInReserve() ? 1 : 0));
+	}
+	return key;
+}
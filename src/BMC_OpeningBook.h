@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_OpeningBook.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: precomputed preround swing and option decisions by matchup
+//
+// REVISION HISTORY:
+// dbl101626 - added
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "bmai_lib.h"
+#include "BMC_MappedFile.h"
+
+
+class BMC_Game;
+class BMC_Player;
+class BMC_Move;
+
+// Swing and option decisions computed offline (see the "bookgen" command), so a matchup that has been seen before
+// is answered without searching.  The key is a hash of both players' dice definitions and the standings, from the
+// point of view of the player deciding, so it does not depend on the order dice were listed in or on which seat
+// the player is in.  Option dice are also keyed by slot since the decision refers to slots.
+//
+// The file is a header followed by entries sorted by key, memory-mapped read-only by Load() and binary searched.
+class BMC_OpeningBook
+{
+public:
+	// methods
+	bool			Load(const char *_filename);
+	void			Unload() { m_file.Close(); }
+	bool			Probe(BMC_Game *_game, BMC_Move &_move, float &_probability);
+	static bool		Add(const char *_filename, BMC_Game *_game, BMC_Move &_move, float _probability);
+	static U64		GetKey(BMC_Game *_game);
+
+	// accessors
+	bool			IsLoaded() { return m_file.IsOpen(); }
+	INT				GetEntries();
+
+	struct Entry {
+		U64			key;
+		U8			swing_value[BME_SWING_MAX];
+		UINT		option_die;			// bit per die slot
+		float		probability;
+	};
+
+private:
+	struct Header {
+		char		magic[4];
+		UINT		version;
+		U64			entries;
+	};
+
+	static U64		GetPlayerKey(BMC_Player *_player, bool _known);
+
+	BMC_MappedFile	m_file;
+};
+
+// global
+extern BMC_OpeningBook	g_book;
@@ -9,6 +9,28 @@
 //
 // REVISION HISTORY:
 // dbl100524 - broke this logic out into its own class file
+// dbl101626 - added 'threads' command
+// dbl101626 - 'seed' seeds the game's RNG, each played game forks its own stream
+// dbl101626 - added MCTS as ai type 3, 'mcts_iterations' and 'mcts_explore' commands
+// dbl101626 - added 'racing' command
+// dbl101626 - added 'ttable' command
+// dbl101626 - added 'time' command
+// dbl101626 - added 'autoply' command
+// dbl101626 - added 'crn' command
+// dbl101626 - added 'qmc' command
+// dbl101626 - added 'cv' command
+// dbl101626 - added 'endgame' command
+// dbl101626 - added 'tablebase' command
+// dbl101626 - added 'equilibrium' command
+// dbl101626 - added 'book' and 'bookgen' commands
+// dbl101626 - added 'evaluator' command
+// dbl101626 - added the rollout policy AI (type 4), 'policy' and 'rollout' commands
+// dbl101626 - added 'selfplay' command
+// dbl101626 - added 'mcts_reuse' and 'mcts_ponder' commands, any input stops MCTS pondering
+// dbl101626 - added 'history' command
+// dbl101626 - added 'precull' command
+// dbl101626 - moves are sent for m_game, since they no longer hold a game pointer
+// dbl101626 - added 'benchthreads' command
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -18,6 +40,8 @@
 
 #include "BMC_Parser.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <cstdarg>
@@ -29,9 +53,17 @@
 #include "BMC_AI_MaximizeOrRandom.h"
 #include "BMC_BMAI3.h"
 #include "BMC_Logger.h"
+#include "BMC_MCTS.h"
+#include "BMC_MLPEvaluator.h"
+#include "BMC_OpeningBook.h"
+#include "BMC_PolicyAI.h"
 #include "BMC_QAI.h"
 #include "BMC_RNG.h"
+#include "BMC_SelfPlay.h"
 #include "BMC_Stats.h"
+#include "BMC_TableBase.h"
+#include "BMC_ThreadPool.h"
+#include "BMC_TransTable.h"
 
 
 // PHASE names
@@ -52,8 +84,10 @@ BMC_BMAI3	g_ai(&g_qai);
 BMC_QAI		g_qai2;
 BMC_BMAI	g_bmai(&g_qai);
 BMC_BMAI3	g_bmai3(&g_qai);
+BMC_MCTS	g_mcts(&g_qai);
+BMC_PolicyAI	g_policy;
 
-BMC_AI * c_ai_type[BMD_AI_TYPES] = { &g_bmai, &g_qai2, &g_bmai3 };
+BMC_AI * c_ai_type[BMD_AI_TYPES] = { &g_bmai, &g_qai2, &g_bmai3, &g_mcts, &g_policy };
 
 INT BMC_Parser::ParseDieNumber(INT & _pos)
 {
@@ -84,7 +118,7 @@ void BMC_Parser::ParseDieSides(INT & _pos, INT _die)
 	if (DieIsSwing(m_line[_pos]))
 	{
 		BME_SWING	swing_type = (BME_SWING)(BME_SWING_FIRST + (m_line[_pos] - BMD_FIRST_SWING_CHAR));
-		m_die->m_swing_type[_die] =  swing_type;
+		m_die->SetSwingType(_die, swing_type);
 		m_die->m_sides[_die] = 0;
 		m_player->m_swing_set = BMC_Player::SWING_SET_NOT;
 		_pos++;
@@ -101,7 +135,7 @@ void BMC_Parser::ParseDieSides(INT & _pos, INT _die)
 	}
 	else
 	{
-		m_die->m_swing_type[_die] = BME_SWING_NOT;
+		m_die->SetSwingType(_die, BME_SWING_NOT);
 		m_die->m_sides[_die] = ParseDieNumber(_pos);
 		m_die->m_sides_max += m_die->m_sides[_die];
 	}
@@ -124,11 +158,11 @@ void BMC_Parser::ParseDie(INT _p, INT _die)
 
 	// prefix properties
 	INT pos = 0;
-	m_die->m_properties = BME_PROPERTY_VALID;
+	m_die->SetProperties(BME_PROPERTY_VALID);
 	while (!DieIsValue(m_line[pos]) && !DieIsTwin(m_line[pos]))
 	{
 		U8 ch = m_line[pos++];
-		#define	DEFINE_PROPERTY(_s, _v)	case _s: m_die->m_properties |= _v; break;
+		#define	DEFINE_PROPERTY(_s, _v)	case _s: m_die->AddProperty(_v); break;
 
 		// WARNING: don't use SWING dice here (PQRSTUVWXYZ)
 		switch (ch)
@@ -173,7 +207,7 @@ void BMC_Parser::ParseDie(INT _p, INT _die)
 	if (DieIsTwin(m_line[pos]))
 	{
 		pos++;
-		m_die->m_properties |= BME_PROPERTY_TWIN;
+		m_die->AddProperty(BME_PROPERTY_TWIN);
 		ParseDieSides(pos, 0);
 		if (m_line[pos++]!=',')
 			BMF_Error("Error parsing twin die");
@@ -189,7 +223,7 @@ void BMC_Parser::ParseDie(INT _p, INT _die)
 		if (DieIsOption(m_line[pos]))
 		{
 			pos++;
-			m_die->m_properties |= BME_PROPERTY_OPTION;
+			m_die->AddProperty(BME_PROPERTY_OPTION);
 			m_player->m_swing_set = BMC_Player::SWING_SET_NOT;
 			ParseDieSides(pos, 1);
 			// the previous call added to m_sides_max, so correct m_sides_max back to the # on the first die (by default)
@@ -212,7 +246,7 @@ void BMC_Parser::ParseDie(INT _p, INT _die)
 	while (pos < (INT)std::strlen(m_line) && m_line[pos] != ':')
 	{
 		U8 ch = m_line[pos++];
-		#define	DEFINE_POST_PROPERTY(_s, _v)	case _s: m_die->m_properties |= _v; break;
+		#define	DEFINE_POST_PROPERTY(_s, _v)	case _s: m_die->AddProperty(_v); break;
 
 		switch (ch)
 		{
@@ -389,7 +423,7 @@ void BMC_Parser::Send( const char *_fmt, ... )
 
 void BMC_Parser::SendStats()
 {
-	printf("stats %d/%d-%d/%d/%.2f ", g_ai.GetMaxPly(), g_ai.GetMinSims(), g_ai.GetMaxSims(), g_ai.GetMaxBranch(), s_ply_decay);
+	printf("stats %d/%d-%d/%d/%.2f ", g_ai.GetMaxPly(), g_ai.GetMinSims(), g_ai.GetMaxSims(), g_ai.GetMaxBranch(), g_ai.GetPlyDecay());
 	g_stats.DisplayStats();
 }
 
@@ -407,7 +441,7 @@ void BMC_Parser::SendSetSwing(BMC_Move &_move)
 	INT i;
 
 	// check swing dice
-	BMC_Player *p = _move.m_game->GetPlayer(_move.m_game->m_phase_player);
+	BMC_Player *p = m_game.GetPhasePlayer();
 
 	for (i=0; i<BME_SWING_MAX; i++)
 	{
@@ -436,7 +470,7 @@ void BMC_Parser::SendUseReserve(BMC_Move &_move)
 
 	BM_ASSERT(_move.m_action==BME_ACTION_USE_RESERVE);
 
-	BMC_Player *p = _move.m_game->GetPlayer(_move.m_game->m_phase_player);
+	BMC_Player *p = m_game.GetPhasePlayer();
 
 	Send("reserve %d\n", p->GetDie(_move.m_use_reserve)->GetOriginalIndex());
 }
@@ -451,7 +485,7 @@ void BMC_Parser::SendUseChance(BMC_Move &_move)
 
 	BM_ASSERT(_move.m_action==BME_ACTION_USE_CHANCE);
 
-	BMC_Player *p = _move.m_game->GetPlayer(_move.m_game->m_phase_player);
+	BMC_Player *p = m_game.GetPhasePlayer();
 
 	INT i;
 	for (i=0; i<BMD_MAX_DICE; i++)
@@ -471,7 +505,7 @@ void BMC_Parser::SendUseFocus(BMC_Move &_move)
 
 	BM_ASSERT(_move.m_action==BME_ACTION_USE_FOCUS);
 
-	BMC_Player *p = _move.m_game->GetPlayer(_move.m_game->m_phase_player);
+	BMC_Player *p = m_game.GetPhasePlayer();
 
 	INT i;
 	for (i=0; i<BMD_MAX_DICE; i++)
@@ -506,11 +540,9 @@ void BMC_Parser::SendAttack(BMC_Move &_move)
 	// send attack type
 	Send("%s\n", c_attack_name[_move.m_attack]);
 
-	/// ensure m_game is correct
-	_move.m_game = &m_game;
-
-	BMC_Player *attacker = _move.m_game->GetPhasePlayer();
-	BMC_Player *target = _move.m_game->GetTargetPlayer();
+	// moves do not hold their game, so the dice come from the game being played
+	BMC_Player *attacker = m_game.GetPhasePlayer();
+	BMC_Player *target = m_game.GetTargetPlayer();
 	BMC_Die		*att_die, *tgt_die;
 	INT i;
 
@@ -660,6 +692,44 @@ void BMC_Parser::GetAction()
 	//Send("endaction\n");
 }
 
+// DESC: time the BMAI v2 decision for the current game with 1 thread and with _threads, and report the speedup.
+// Both searches start from a copy of the same game (and RNG state), so they run the same number of sims.
+void BMC_Parser::BenchThreads(INT _threads)
+{
+	if (m_game.m_phase != BME_PHASE_PREROUND && m_game.m_phase != BME_PHASE_FIGHT)
+		BMF_Error("benchthreads needs a preround or fight game\n");
+
+	INT old_threads = g_pool.GetThreads();
+	INT threads[2] = { 1, _threads };
+	double seconds[2];
+	INT sims[2];
+
+	for (INT i=0; i<2; i++)
+	{
+		BMC_Game game(false);
+		game = m_game;
+		game.m_phase_player = 0;
+		game.m_target_player = 1;
+		g_pool.SetThreads(threads[i]);
+		threads[i] = g_pool.GetThreads();
+		g_stats.ClearCounters();
+
+		BMC_Move move;
+		auto start = std::chrono::steady_clock::now();
+		if (game.m_phase == BME_PHASE_PREROUND)
+			g_ai.GetSetSwingAction(&game, move);
+		else
+			g_ai.GetAttackAction(&game, move);
+		seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		sims[i] = g_stats.GetSims();
+
+		printf("threads %d: %.3f s, %d sims, %.0f sims/sec\n", threads[i], seconds[i], sims[i], seconds[i] > 0 ? sims[i] / seconds[i] : 0);
+	}
+	g_pool.SetThreads(old_threads);
+
+	printf("speedup %.2f with %d threads\n", seconds[1] > 0 ? seconds[0] / seconds[1] : 0, threads[1]);
+}
+
 void BMC_Parser::PlayGame(INT _games)
 {
 	if (m_game.GetPhase()!=BME_PHASE_PREROUND)
@@ -671,6 +741,7 @@ void BMC_Parser::PlayGame(INT _games)
 	while (_games-->0)
 	{
 		g_sim = m_game;
+		g_sim.GetRNG().SetStream(m_game.GetRNG().GetRand64());
 		g_sim.PlayGame();
 		if (g_sim.GetStanding(0) > g_sim.GetStanding(1))
 			wins[0]++;
@@ -693,6 +764,7 @@ void BMC_Parser::CompareAI(INT _games)
 	while (_games-->0)
 	{
 		g_sim = m_game;
+		g_sim.GetRNG().SetStream(m_game.GetRNG().GetRand64());
 		g_sim.PlayGame();
 		if (g_sim.GetStanding(0) > g_sim.GetStanding(1))
 			wins[0]++;
@@ -757,6 +829,7 @@ void BMC_Parser::PlayFairGames(INT _games, INT _mode, F32 _p)
 	for (g=0; g<_games; g++)
 	{
 		g_sim = m_game;
+		g_sim.GetRNG().SetStream(m_game.GetRNG().GetRand64());
 		g_sim.PlayGame();
 		if (g_sim.GetStanding(0) > g_sim.GetStanding(1))
 			wins[g_sim.GetInitiativeWinner()][0]++;
@@ -791,7 +864,7 @@ SETUP
 game %1				begin parsing game setup, setting %1 as the target number of wins [%1 is an optional field, default 3]
 
 SETTINGS
-seed %1				seed the RNG, use 0 to randomize it  [default is deterministic each run]
+seed %1				seed the RNG, use 0 to randomize it.  A seed gives the same BMAI v2 decisions for any 'threads'  [default is deterministic each run]
 max_sims %1			number of rollout simulations BMAI will use [default 500]
 min_sims %1			when applying 'maxbranch' rules, min_sims BMAI will use [default 10]
 turbo_accuracy %1	how many turbo options to consider, where 1 means consider all valid turbo options and 0 means consider only the extremes [range 0..1, default 1]
@@ -799,12 +872,36 @@ ply %1				deepest ply for BMAI to run at (uses simulations after that ply)
 maxbranch %1		maximum number of total simulations to run at a ply (valid moves * simulations) [default 5000]
 debug %1 %2			adjust logging settings (e.g. "debug SIMULATION 0")
 debugply %1
-ai %1 %2			set player %1 (0-1) to AI type %2 (0 = BMAI, 1 = QAI, 2 = BMAI v2)
+ai %1 %2			set player %1 (0-1) to AI type %2 (0 = BMAI, 1 = QAI, 2 = BMAI v2, 3 = MCTS, 4 = rollout policy)
 surrender %1        set if AI is allowed to surrender. If off then AI will continue to play loosing positions. [default is on]
+threads %1			number of threads BMAI v2 uses to run simulations, 0 means one per core.  Decisions do not depend on it [default 1]
+time %1				milliseconds BMAI v2 may spend per action, 0 for no limit.  It returns its best move so far at the deadline [default 0]
+autoply %1 %2		BMAI v2 picks ply (up to %1) and ply decay per action to fit the 'time' limit, or %2 rollouts if there is none.  0 turns it off [default 0]
+ttable %1			size in entries of the transposition table BMAI v2 shares between the inner-ply searches of one decision (and all threads), 0 disables it.  Inner searches it covers use a stream drawn from the state, so turning it on changes the decisions of a seed [default 0]
+tablebase %1		memory-map the fight tablebase file %1 (see bmai_tbgen).  Simulated fights end exactly when they reach one of its states
+crn %1				on/off, BMAI v2 scores every move with the same RNG stream for sim N (common random numbers) [default off]
+qmc %1				on/off, BMAI v2 draws the first die rolls of each sim from a randomized Halton sequence, so a move's sims cover the rerolls evenly [default off]
+cv %1				on/off, BMAI v2 adjusts move scores with a control variate on the luck of the move's rerolls [default off]
+precull %1 %2 %3	BMAI v2 keeps only the %1 attacks with the best static score, those within %3 points of them, and %2 others at random before simulating, 0 disables it [default 0]
+history %1			on/off, BMAI v2 simulates moves in history table order and stops a move's batch once the next cull is certain to remove it, serial search only (threads 1) [default off]
+equilibrium %1		on/off, when both players set swing at once BMAI v2 scores every pair of choices and plays a mixed equilibrium [default off]
+rollout %1			qai/policy, the AI that plays out BMAI v2 simulations: QAI simulates each attack, the rollout policy scores them from a weight table [default qai]
+policy %1			load rollout policy weights from file %1 (see BMC_PolicyAI)
+evaluator %1 %2		load leaf evaluator weights %1 (see BMC_MLPEvaluator).  BMAI v2 scores max ply with weight %2 on its estimate and the rest on the rollout, 0 turns it off [default off]
+book %1				memory-map the opening book file %1.  BMAI v2 answers preround swing and option decisions it contains without searching
+endgame %1			BMAI v2 solves fights with at most %1 dice in play exactly instead of simulating, 0 disables it [default 0]
+racing %1			BMAI v2 culls moves with empirical-Bernstein confidence bounds at error rate %1, 0 uses the fixed thresholds [default 0]
+mcts_iterations %1	number of tree search iterations (one rollout each) MCTS runs per decision [default 5000]
+mcts_explore %1		UCB1 exploration constant for MCTS [default 0.7]
+mcts_reuse %1		on/off, MCTS keeps its tree between fight decisions and resumes from the subtree of the next position.  MCTS (ai 3) only: BMAI v2 keeps no search state between decisions [default off]
+mcts_ponder %1		with mcts_reuse, MCTS runs up to %1 iterations on the chosen move while waiting for the next input, 0 disables it [default 0]
 
 ACTIONS
 playgame %1			play %1 games and output results
+selfplay %1 %2		play %1 games between two copies of BMAI v2 on the thread pool and write every decision to binary file %2 (see BMC_SelfPlay)
+bookgen %1			search the preround decision of the current game as player 0 and add it to the opening book file %1
 compare %1			play %1 games and output results of current AI vs OLD AI
+benchthreads %1		time the BMAI v2 decision for the current game with 1 thread and with %1 threads (0 = one per core) and report the speedup
 playfair %1 %2 %3	play %1 games, using 'mode' %2, and 'p' %3
 getaction			ask BMAI for what action it would select in the given situation
 quit				terminate (same as EOF)
@@ -826,6 +923,9 @@ void BMC_Parser::Parse()
 	char sparam[BMD_MAX_STRING+1];
 	while (ReadNextInputToLine(false))	// non-fatal Read()
 	{
+		// MCTS ponders on the opponent's time, which ends when the next input arrives
+		g_mcts.StopPonder();
+
 		// game [wins]
 		if (!std::strncmp(m_line, "game", 4))
 		{
@@ -839,6 +939,17 @@ void BMC_Parser::Parse()
 		{
 			CompareAI(param);
 		}
+		// selfplay [games] [file]
+		else if (sscanf(m_line, "selfplay %d %256s", &param, sparam)==2)
+		{
+			if (m_game.GetPhase()!=BME_PHASE_PREROUND)
+				BMF_Error("Cannot selfplay unless it is preround");
+			BMC_SelfPlay selfplay;
+			INT records = selfplay.Run(&m_game, &g_ai, param, sparam);
+			if (records<0)
+				BMF_Error("Could not write %s\n", sparam);
+			printf("Wrote %d records from %d games to %s\n", records, param, sparam);
+		}
 		// playfair [games] [mode] [p]
 		else if (sscanf(m_line, "playfair %d %d %f", &param, &param2, &fparam)==3)
 		{
@@ -931,9 +1042,167 @@ void BMC_Parser::Parse()
 		}
 		else if (sscanf(m_line, "seed %d", &param)==1)
 		{
-			g_rng.SRand(param);
+			m_game.GetRNG().SRand(param);
 			printf("Seeding with %d\n", param);
 		}
+		else if (sscanf(m_line, "mcts_iterations %d", &param)==1)
+		{
+			if (param<1)
+				BMF_Error("invalid setting for mcts_iterations: %d", param);
+			g_mcts.SetIterations(param);
+			printf("Setting MCTS iterations to %d\n", param);
+		}
+		else if (sscanf(m_line, "mcts_explore %f", &fparam)==1)
+		{
+			g_mcts.SetExploration(fparam);
+			printf("Setting MCTS exploration to %f\n", fparam);
+		}
+		else if (sscanf(m_line, "mcts_reuse %32s", sparam)==1)
+		{
+			g_mcts.SetReuse(std::string(sparam)=="on");
+			printf("Setting MCTS tree reuse %s\n", g_mcts.GetReuse() ? "on" : "off");
+		}
+		else if (sscanf(m_line, "mcts_ponder %d", &param)==1)
+		{
+			if (param<0)
+				BMF_Error("invalid setting for mcts_ponder: %d", param);
+			g_mcts.SetPonder(param);
+			printf("Setting MCTS ponder iterations to %d\n", param);
+		}
+		else if (sscanf(m_line, "time %d", &param)==1)
+		{
+			g_ai.SetTimeLimit(param);
+			printf("Setting time limit to %d ms\n", g_ai.GetTimeLimit());
+		}
+		else if (sscanf(m_line, "autoply %d %d", &param, &param2)==2)
+		{
+			g_ai.SetAutoPly(param, param2);
+			printf("Setting autoply to max ply %d, %d rollouts\n", g_ai.GetAutoPly(), g_ai.GetAutoSims());
+		}
+		else if (sscanf(m_line, "autoply %d", &param)==1)
+		{
+			g_ai.SetAutoPly(param, g_ai.GetAutoSims());
+			printf("Setting autoply to max ply %d, %d rollouts\n", g_ai.GetAutoPly(), g_ai.GetAutoSims());
+		}
+		else if (sscanf(m_line, "ttable %d", &param)==1)
+		{
+			g_ttable.SetSize(param);
+			printf("Setting transposition table size to %d\n", g_ttable.GetSize());
+		}
+		else if (sscanf(m_line, "tablebase %256s", sparam)==1)
+		{
+			if (!g_tablebase.Load(sparam))
+				BMF_Error("Could not load tablebase %s\n", sparam);
+			printf("Loaded tablebase %s, %llu values\n", sparam, (unsigned long long)g_tablebase.GetEntries());
+		}
+		else if (sscanf(m_line, "rollout %32s", sparam)==1)
+		{
+			if (std::string(sparam)=="policy")
+				g_ai.SetQAI(&g_policy);
+			else if (std::string(sparam)=="qai")
+				g_ai.SetQAI(&g_qai);
+			else
+				BMF_Error("invalid rollout AI: %s\n", sparam);
+			printf("Setting rollout AI to %s\n", sparam);
+		}
+		else if (sscanf(m_line, "policy %256s", sparam)==1)
+		{
+			if (!g_policy.Load(sparam))
+				BMF_Error("Could not load rollout policy %s\n", sparam);
+			printf("Loaded rollout policy %s\n", sparam);
+		}
+		else if (sscanf(m_line, "evaluator %256s %f", sparam, &fparam)==2)
+		{
+			if (fparam<=0)
+				g_ai.SetEvaluator(NULL, 0);
+			else if (!g_evaluator.Load(sparam))
+				BMF_Error("Could not load evaluator %s\n", sparam);
+			else
+				g_ai.SetEvaluator(&g_evaluator, std::min(fparam, 1.0f));
+			printf("Setting leaf evaluator %s, mix %.2f\n", g_ai.GetEvaluator() ? sparam : "off", g_ai.GetEvaluatorMix());
+		}
+		else if (sscanf(m_line, "bookgen %256s", sparam)==1)
+		{
+			if (m_game.m_phase != BME_PHASE_PREROUND)
+				BMF_Error("bookgen needs a preround game\n");
+
+			// search without the book, so existing entries are recomputed
+			BMC_OpeningBook *book = g_ai.GetOpeningBook();
+			BMC_Move move;
+			m_game.SetPhasePlayer(0);
+			g_ai.SetOpeningBook(NULL);
+			g_ai.GetSetSwingAction(&m_game, move);
+			g_ai.SetOpeningBook(book);
+
+			if (!BMC_OpeningBook::Add(sparam, &m_game, move, g_ai.GetLastProbabilityWin()))
+				BMF_Error("Could not write opening book %s\n", sparam);
+			printf("Added to opening book %s (%.1f%% win)\n", sparam, g_ai.GetLastProbabilityWin() * 100);
+		}
+		else if (sscanf(m_line, "book %256s", sparam)==1)
+		{
+			if (!g_book.Load(sparam))
+				BMF_Error("Could not load opening book %s\n", sparam);
+			g_ai.SetOpeningBook(&g_book);
+			printf("Loaded opening book %s, %d entries\n", sparam, g_book.GetEntries());
+		}
+		else if (sscanf(m_line, "crn %32s", sparam)==1)
+		{
+			g_ai.SetCommonRandom(std::string(sparam)=="on");
+			printf("Setting common random numbers %s\n", g_ai.GetCommonRandom() ? "on" : "off");
+		}
+		else if (sscanf(m_line, "precull %d %d %f", &param, &param2, &fparam)==3)
+		{
+			if (param<0 || param2<0 || fparam<0)
+				BMF_Error("invalid setting for precull: %d %d %f", param, param2, fparam);
+			g_ai.SetPreCull(param, param2, fparam);
+			printf("Setting precull to %d attacks, %d sampled, margin %f\n", param, param2, fparam);
+		}
+		else if (sscanf(m_line, "precull %d", &param)==1)
+		{
+			if (param<0)
+				BMF_Error("invalid setting for precull: %d", param);
+			g_ai.SetPreCull(param, 0, 0);
+			printf("Setting precull to %d attacks\n", param);
+		}
+		else if (sscanf(m_line, "history %32s", sparam)==1)
+		{
+			g_ai.SetHistory(std::string(sparam)=="on");
+			printf("Setting history heuristic %s%s\n", g_ai.GetHistory() ? "on" : "off", g_ai.GetHistory() && g_pool.GetThreads()>1 ? " (serial search only, not used with threads > 1)" : "");
+		}
+		else if (sscanf(m_line, "qmc %32s", sparam)==1)
+		{
+			g_ai.SetQuasiRandom(std::string(sparam)=="on");
+			printf("Setting quasi-random rolls %s\n", g_ai.GetQuasiRandom() ? "on" : "off");
+		}
+		else if (sscanf(m_line, "cv %32s", sparam)==1)
+		{
+			g_ai.SetControlVariate(std::string(sparam)=="on");
+			printf("Setting control variate %s\n", g_ai.GetControlVariate() ? "on" : "off");
+		}
+		else if (sscanf(m_line, "equilibrium %32s", sparam)==1)
+		{
+			g_ai.SetSwingEquilibrium(std::string(sparam)=="on");
+			printf("Setting swing equilibrium %s\n", g_ai.GetSwingEquilibrium() ? "on" : "off");
+		}
+		else if (sscanf(m_line, "endgame %d", &param)==1)
+		{
+			g_ai.SetEndgameDice(param);
+			printf("Setting endgame solver to %d dice\n", g_ai.GetEndgameDice());
+		}
+		else if (sscanf(m_line, "racing %f", &fparam)==1)
+		{
+			g_ai.SetRacing(fparam);
+			printf("Setting racing error rate to %f\n", g_ai.GetRacing());
+		}
+		else if (sscanf(m_line, "benchthreads %d", &param)==1)
+		{
+			BenchThreads(param);
+		}
+		else if (sscanf(m_line, "threads %d", &param)==1)
+		{
+			g_pool.SetThreads(param);
+			printf("Setting threads to %d\n", g_pool.GetThreads());
+		}
         else if (sscanf(m_line, "surrender %32s", &sparam)==1)
         {
             m_game.SetSurrenderAllowed(std::string(sparam)=="on");
@@ -11,6 +11,7 @@
 // drp030321 - partial split out to individual headers
 // dbl100524 - further split out of individual headers
 // dbl040626 - expose parser-owned game for parser-driven tests
+// dbl101626 - g_mcts
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
@@ -22,6 +23,7 @@
 #include "BMC_BMAI.h"
 #include "BMC_BMAI3.h"
 #include "BMC_Die.h"
+#include "BMC_MCTS.h"
 #include "BMC_QAI.h"
 
 
@@ -39,6 +41,7 @@ protected:
 	void			PlayGame(INT _games);
 	void			CompareAI(INT _games);
 	void			PlayFairGames(INT _games, INT _mode, F32 _p);
+	void			BenchThreads(INT _threads);
 	void			ParseDie(INT _p, INT _dice);
 	void			ParseGame();
 	void			ParsePlayer(INT _p, INT _dice);
@@ -87,3 +90,4 @@ extern BMC_BMAI3	g_ai;
 extern BMC_QAI		g_qai2;
 extern BMC_BMAI		g_bmai;
 extern BMC_BMAI3	g_bmai3;
+extern BMC_MCTS		g_mcts;
@@ -10,6 +10,10 @@
 // REVISION HISTORY:
 // dbl100524 - broke this logic out into its own class file
 // dbl040626 - add property-change bookkeeping for warrior Konstant transitions
+// dbl101626 - RollDice() takes the game's BMC_RNG
+// dbl101626 - added GetStateHash()
+// dbl101626 - added OnRoundStart(), SetButtonMan() numbers the dice
+// dbl101626 - removed the unused m_man
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 // includes
@@ -17,7 +21,9 @@
 
 #include <cstdio>
 #include <climits>
+#include <cstring>
 #include "BMC_Logger.h"
+#include "BMC_RNG.h"
 
 
 BMC_Player::BMC_Player() 
@@ -29,8 +35,6 @@ void BMC_Player::Reset()
 {
 	INT i;
 
-	m_man = NULL;
-
 	// set up swing dice
 	for (i=0; i<BME_SWING_MAX; i++)
 	{
@@ -54,12 +58,11 @@ void BMC_Player::SetButtonMan(BMC_Man *_man)
 
 	Reset();
 
-	m_man = _man;
-
 	// set up dice, and update m_swing_dice
 	for (i=0; i<BMD_MAX_DICE; i++)
 	{
-		m_die[i].SetDie(m_man->GetDieData(i));
+		m_die[i].SetDie(_man->GetDieData(i));
+		m_die[i].SetOriginalIndex(i);
 		for (j=0; j<m_die[i].Dice(); j++)
 			m_swing_dice[m_die[i].GetSwingType(j)]++;
 	}
@@ -116,9 +119,8 @@ void BMC_Player::SetOptionDie(INT _i, INT _d)
 }
 
 // POST: recomputes m_score
-void BMC_Player::RollDice()
+void BMC_Player::RollDice(BMC_RNG &_rng)
 {
-	//BM_ASSERT(m_man != NULL);
 
 	m_score = 0;
 
@@ -127,7 +129,7 @@ void BMC_Player::RollDice()
 	{
 		if (!m_die[i].IsUsed())
 			continue;
-		m_die[i].Roll();
+		m_die[i].Roll(_rng);
 		BM_ASSERT(m_die[i].GetValueTotal()>0);
 
 		m_score += m_die[i].GetScore(true);
@@ -139,6 +141,23 @@ void BMC_Player::RollDice()
 	Debug(BME_DEBUG_ROUND);
 }
 
+// DESC: hash of the player: the score key XORed with the key of every die in play.  Dice in reserve
+// or not used only matter to later rounds, so they are left out.
+U64 BMC_Player::GetStateHash()
+{
+	UINT score_bits;
+	std::memcpy(&score_bits, &m_score, sizeof(score_bits));
+	U64 h = BMC_RNG::MakeKey(m_id, score_bits);
+
+	for (INT d=0; d<BMD_MAX_DICE; d++)
+	{
+		if (m_die[d].IsUsed())
+			h ^= m_die[d].GetStateHash(m_id, d);
+	}
+
+	return h;
+}
+
 void BMC_Player::Debug(BME_DEBUG _cat)
 {
 	if (!g_logger.IsLogging(_cat))
@@ -315,6 +334,52 @@ void BMC_Player::OnRoundLost()
 	m_swing_set = SWING_SET_NOT;
 }
 
+// DESC: the next round starts with the dice of _start (the start of the game).  A player whose swing is still set
+// (they did not lose the round) keeps their swing sizes, and the option they chose for each option die.
+// POST: dice are NOTSET, as in the preround
+void BMC_Player::OnRoundStart(BMC_Player &_start)
+{
+	INT i, j, s;
+	bool keep = (m_swing_set != SWING_SET_NOT);
+	BMC_Die	dice[BMD_MAX_DICE];
+
+	for (i=0; i<BMD_MAX_DICE; i++)
+	{
+		dice[i] = _start.m_die[i];
+		if (!keep || !dice[i].IsUsed() || !dice[i].HasProperty(BME_PROPERTY_OPTION))
+			continue;
+
+		// dice are reordered during the round, so find the same die
+		for (j=0; j<BMD_MAX_DICE; j++)
+		{
+			if (m_die[j].GetOriginalIndex()==dice[i].GetOriginalIndex() && m_die[j].HasProperty(BME_PROPERTY_OPTION)
+				&& m_die[j].GetSides(0)==dice[i].GetSides(1) && m_die[j].GetSides(0)!=dice[i].GetSides(0))
+			{
+				dice[i].SetOption(1);
+			}
+		}
+	}
+
+	m_score = 0;
+	for (i=0; i<BMD_MAX_DICE; i++)
+	{
+		m_die[i] = dice[i];
+		if (keep)
+		{
+			for (s=0; s<BME_SWING_MAX; s++)
+			{
+				if (m_swing_value[s]>0)
+					m_die[i].OnSwingSet(s, m_swing_value[s]);
+			}
+		}
+		if (m_die[i].IsUsed())
+			m_score += m_die[i].GetScore(true);
+	}
+
+	OptimizeDice();
+}
+
+
 // RETURNS: die index +1 (i.e. >0) if there is one present
 INT BMC_Player::HasDieWithProperty(INT _p, bool _check_all_dice)
 {
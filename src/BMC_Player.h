@@ -11,16 +11,20 @@
 // drp030321 - partial split out to individual headers
 // dbl100524 - further split out of individual headers
 // dbl040626 - add property-change bookkeeping hooks for warrior Konstant transitions
+// dbl101626 - GetStateHash() for state hashing
+// dbl101626 - OnRoundStart() for games of more than one round
+// dbl101626 - packed layout: byte-sized counters, and dropped the unused m_man
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
 // TODO_HEADERS: drp030321 - clean up headers
+#include <type_traits>
 #include "BMC_Die.h"
 #include "BMC_Man.h"
 
 
-class BMC_Player	// 204b
+class BMC_Player	// 280b
 {
 	friend class BMC_Parser;
 
@@ -40,7 +44,7 @@ public:
 	void		SetButtonMan(BMC_Man *_man);
 	void		SetSwingDice(INT _swing, U8 _value, bool _from_turbo = false);
 	void		SetOptionDie(INT _i, INT _d);
-	void		RollDice();
+	void		RollDice(BMC_RNG &_rng);
 
 	// methods
 	void		Debug(BME_DEBUG _cat = BME_DEBUG_ALWAYS);
@@ -56,6 +60,7 @@ public:
 	BMC_Die *	OnDieLost(INT _d);
 	void		OnDieCaptured(BMC_Die *_die);
 	void		OnRoundLost();
+	void		OnRoundStart(BMC_Player &_start);
 	void		OnSurrendered();
 	//void		OnSwingDiceSet() { m_swing_set = true; }
 	void		OnSwingDiceReady() { m_swing_set = SWING_SET_READY; }
@@ -71,8 +76,9 @@ public:
 	INT			GetMaxValue() { return m_max_value; }
 	INT			GetMinValue() { return m_min_value; }
 	float		GetScore() { return m_score; }
+	U64			GetStateHash();
 	//bool		SwingDiceSet() { return m_swing_set; }
-	SWING_SET	GetSwingDiceSet() { return m_swing_set; }
+	SWING_SET	GetSwingDiceSet() { return (SWING_SET)m_swing_set; }
 	INT			HasDieWithProperty(INT _p, bool _check_all_dice = false);
 	INT			GetTotalSwingDice(INT _s) { return m_swing_dice[_s]; }
 	INT			GetID() { return m_id; }
@@ -83,14 +89,16 @@ protected:
 	void		OptimizeDice();
 
 private:
-	BMC_Man	*	m_man;
-	INT			m_id;
-	SWING_SET	m_swing_set;
 	BMC_Die		m_die[BMD_MAX_DICE];			// as long as Optimize was called, these are sorted largest to smallest that are READY
 	U8			m_swing_value[BME_SWING_MAX];
 	U8			m_swing_dice[BME_SWING_MAX];	// number of dice of each swing type
-	INT			m_available_dice;				// only valid after Optimize
+	U8			m_id;
+	U8			m_swing_set;					// should be SWING_SET
+	U8			m_available_dice;				// only valid after Optimize
 	INT			m_max_value;					// only valid after Optimize, useful to know for skill attacks
 	INT			m_min_value;					// only valid after Optimize, useful to know for skill attacks
 	float		m_score;
 };
+
+// players are copied with the game (BMC_Game is trivially copyable)
+static_assert(std::is_trivially_copyable<BMC_Player>::value, "BMC_Player must be trivially copyable");
@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_PolicyAI.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: fast rollout policy that scores attacks from a weight table
+//
+// REVISION HISTORY:
+// dbl101626 - added
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_PolicyAI.h"
+
+#include <cstdio>
+#include <cstring>
+#include "BMC_Logger.h"
+#include "BMC_RNG.h"
+
+
+BMC_PolicyAI::BMC_PolicyAI()
+{
+	for (INT a=0; a<BME_ATTACK_MAX; a++)
+	{
+		m_weight[a][FEATURE_CAPTURE] = (a==BME_ATTACK_TRIP) ? 0.5f : 1.0f;
+		m_weight[a][FEATURE_REROLL] = 1.0f;
+		m_weight[a][FEATURE_TARGETS] = 0;
+		m_weight[a][FEATURE_BIAS] = 0;
+	}
+}
+
+// RETURNS: false if the file could not be read, in which case the weights are unchanged
+bool BMC_PolicyAI::Load(const char *_filename)
+{
+	FILE *fp = fopen(_filename, "r");
+	if (!fp)
+		return false;
+
+	char magic[32];
+	INT version;
+	float weight[BME_ATTACK_MAX][FEATURE_MAX];
+	bool ok = fscanf(fp, "%31s %d", magic, &version)==2 && std::strcmp(magic, "bmai_policy")==0 && version==1;
+	for (INT a=0; ok && a<BME_ATTACK_MAX; a++)
+	{
+		for (INT f=0; ok && f<FEATURE_MAX; f++)
+			ok = fscanf(fp, "%f", &weight[a][f])==1;
+	}
+	fclose(fp);
+
+	if (ok)
+		std::memcpy(m_weight, weight, sizeof(m_weight));
+	return ok;
+}
+
+// DESC: pick the attack with the best weighted score plus noise.  A pass or surrender is only generated when there
+// is no attack, and is then played.
+void BMC_PolicyAI::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
+{
+	BMC_MoveList	movelist;
+	_game->GenerateValidAttacks(movelist);
+
+	BMC_Move *	best_move = NULL;
+	float		best_score = 0;
+	BMC_RNG &	rng = _game->GetRNG();
+
+	for (INT i=0; i<movelist.Size(); i++)
+	{
+		BMC_Move * attack = movelist.Get(i);
+		if (attack->m_action != BME_ACTION_ATTACK)
+		{
+			best_move = attack;
+			break;
+		}
+
+		float score = GetAttackScore(_game, *attack) + rng.GetFRand() * BMD_POLICY_FUZZINESS;
+		if (!best_move || score > best_score)
+		{
+			best_score = score;
+			best_move = attack;
+		}
+	}
+
+	g_logger.Log(BME_DEBUG_QAI, "Policy p%d best move (%.1f) ", _game->GetPhasePlayerID(), best_score);	best_move->Debug(_game, BME_DEBUG_QAI);
+
+	_move = *best_move;
+}
+
+float BMC_PolicyAI::GetAttackScore(BMC_Game *_game, BMC_Move &_move)
+{
+	float features[FEATURE_MAX];
+	GetFeatures(_game, _move, features);
+
+	float *weight = m_weight[_move.m_attack];
+	float score = 0;
+	for (INT f=0; f<FEATURE_MAX; f++)
+		score += weight[f] * features[f];
+	return score;
+}
+
+// DESC: the features of an attack, from the dice alone (nothing is simulated)
+void BMC_PolicyAI::GetFeatures(BMC_Game *_game, BMC_Move &_move, float *_features)
+{
+	BMC_Player *attacker = _game->GetPlayer(_move.m_attacker_player);
+	BMC_Player *target = _game->GetPlayer(_move.m_target_player);
+	INT d;
+
+	// attackers
+	float reroll = 0;
+	bool null = false;
+	if (_move.MultipleAttackers())
+	{
+		for (d=0; d<attacker->GetAvailableDice(); d++)
+		{
+			if (!_move.m_attackers.IsSet(d))
+				continue;
+			reroll += GetRerollGain(attacker->GetDie(d));
+			null = null || attacker->GetDie(d)->HasProperty(BME_PROPERTY_NULL);
+		}
+	}
+	else
+	{
+		reroll = GetRerollGain(attacker->GetDie(_move.m_attacker));
+		null = attacker->GetDie(_move.m_attacker)->HasProperty(BME_PROPERTY_NULL);
+	}
+
+	// targets: the target loses the die's score, and the attacker gains its captured score (nothing if NULL)
+	float capture = 0;
+	INT targets = 0;
+	for (d=0; d<target->GetAvailableDice(); d++)
+	{
+		if (_move.MultipleTargets() ? !_move.m_targets.IsSet(d) : d!=_move.m_target)
+			continue;
+		BMC_Die *die = target->GetDie(d);
+		capture += die->GetScore(true) + (null ? 0 : die->GetScore(false));
+		targets++;
+	}
+
+	_features[FEATURE_CAPTURE] = capture;
+	_features[FEATURE_REROLL] = reroll;
+	_features[FEATURE_TARGETS] = (float)targets;
+	_features[FEATURE_BIAS] = 1;
+}
+
+// DESC: expected change in value from rerolling the die, counted as QAI does (SHADOW does not care, POISON is reversed)
+float BMC_PolicyAI::GetRerollGain(BMC_Die *_die)
+{
+	if (_die->HasProperty(BME_PROPERTY_SHADOW))
+		return 0;
+	float delta = (_die->GetSidesMax() + 1) * 0.5f - (float)_die->GetValueTotal();
+	return _die->HasProperty(BME_PROPERTY_POISON) ? -delta : delta;
+}
@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_PolicyAI.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: fast rollout policy that scores attacks from a weight table
+//
+// REVISION HISTORY:
+// dbl101626 - added
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BMC_AI.h"
+
+
+// Rollout policy for simulations, as an alternative to QAI.  QAI copies the game and simulates each attack; this
+// scores each attack from features of the move alone, weighted by attack type:
+// - CAPTURE: score swing of the dice captured (what the attacker gains plus what the target loses)
+// - REROLL: expected gain from rerolling the attackers, as QAI counts it
+// - TARGETS: number of dice captured
+// - BIAS: constant
+// Like QAI it adds a little noise, so rollouts vary.  The default weights reproduce QAI's score, with trip
+// attacks counted as even odds.  Weights can be loaded from a text file:
+//	bmai_policy 1
+//	then one line per BME_ATTACK (in order): CAPTURE REROLL TARGETS BIAS
+class BMC_PolicyAI : public BMC_AI
+{
+public:
+	enum {
+		FEATURE_CAPTURE,
+		FEATURE_REROLL,
+		FEATURE_TARGETS,
+		FEATURE_BIAS,
+		FEATURE_MAX
+	};
+
+	BMC_PolicyAI();
+
+	// methods
+	bool				Load(const char *_filename);
+	virtual void		GetAttackAction(BMC_Game *_game, BMC_Move &_move);
+	float				GetAttackScore(BMC_Game *_game, BMC_Move &_move);
+	static void			GetFeatures(BMC_Game *_game, BMC_Move &_move, float *_features);
+
+	// accessors
+	float				GetWeight(INT _attack, INT _feature) { return m_weight[_attack][_feature]; }
+
+private:
+	static float		GetRerollGain(BMC_Die *_die);
+
+	float				m_weight[BME_ATTACK_MAX][FEATURE_MAX];
+};
@@ -12,6 +12,7 @@
 //				- corrected display of "win%" in swing action logging (was using g_sims instead of local sims)
 //				- decreased QAI fuzziness from 20 to 5 (this needs work)
 // dbl100524 - broke this logic out into its own class file
+// dbl101626 - use the game's RNG and fork a stream for each attack sim
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BMC_QAI.h"
@@ -55,9 +56,11 @@ void BMC_QAI::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 			break;
 		}
 
-		g_logger.Log(BME_DEBUG_QAI, "QAI p%d m%d: ", _game->GetPhasePlayerID(), i);	attack->Debug(BME_DEBUG_QAI, NULL);
+		g_logger.Log(BME_DEBUG_QAI, "QAI p%d m%d: ", _game->GetPhasePlayerID(), i);	attack->Debug(_game, BME_DEBUG_QAI, NULL);
 
 		sim = *_game;
+		sim.SetSimulation(true);
+		sim.GetRNG().SetStream(_game->GetRNG().GetRand64());
 		bool extra_turn = false;
 		sim.SimulateAttack(*attack, extra_turn);
 		score = sim.GetPhasePlayer()->GetScore() - sim.GetTargetPlayer()->GetScore();
@@ -94,7 +97,7 @@ void BMC_QAI::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 			}
 			break;
 		}
-		score += g_rng.GetRand(BMD_QAI_FUZZINESS);
+		score += _game->GetRNG().GetRand(BMD_QAI_FUZZINESS);
 
 
 		// TODO: bonus for getting an extra turn
@@ -108,8 +111,7 @@ void BMC_QAI::GetAttackAction(BMC_Game *_game, BMC_Move &_move)
 		}
 	}
 
-	best_move->m_game = _game;
-	g_logger.Log(BME_DEBUG_QAI, "QAI p%d best move (%.1f) ", 	_game->GetPhasePlayerID(), 	best_score);	best_move->Debug(BME_DEBUG_QAI);
+	g_logger.Log(BME_DEBUG_QAI, "QAI p%d best move (%.1f) ", 	_game->GetPhasePlayerID(), 	best_score);	best_move->Debug(_game, BME_DEBUG_QAI);
 
 	_move = *best_move;
 }
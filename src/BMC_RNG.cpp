@@ -13,20 +13,40 @@
 // a maximum "error" of 0.29%.  For the runtime library "rand()" the stddev was 4 with a maximum
 // "error" of 0.52%.
 //
+// That generator (Park-Miller) has since been replaced by a counter-based one, so keyed streams are
+// independent instead of starting points on one 2^31 cycle.  See BMC_RNG.
+//
 // REVISION HISTORY:
 // dbl100524 - broke this logic out into its own class file
+// dbl101626 - g_rng is per-thread
+// dbl101626 - keyed streams (SetStream/MakeKey), g_rng removed
+// dbl101626 - quasi-random die rolls
+// dbl101626 - roll luck tracking
+// dbl101626 - scripted rolls
+// dbl101626 - counter-based generator (a hash of key and counter) replaces Park-Miller
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BMC_RNG.h"
 
 #include <ctime>
+#include "BMC_Logger.h"
+
 
+// DESC: the SplitMix64 finalizer, a bijection on 64-bit values
+static U64 BMF_MixKey(U64 _z)
+{
+  _z += 0x9E3779B97F4A7C15ULL;
+  _z = (_z ^ (_z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  _z = (_z ^ (_z >> 27)) * 0x94D049BB133111EBULL;
+  return _z ^ (_z >> 31);
+}
 
-// global
-BMC_RNG		g_rng;
+// first primes, the Halton bases of the coordinates
+static const UINT c_halton_base[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53 };
 
 BMC_RNG::BMC_RNG() :
-        m_seed(78904497)
+        m_key(78904497), m_counter(0), m_qmc_dim(0), m_qmc_dims(0), m_luck_rolls(0), m_qmc_key(0), m_qmc_index(0), m_luck(0),
+        m_script_rolls(0), m_script(NULL), m_script_sides(NULL)
 {
 }
 
@@ -36,25 +56,74 @@ void BMC_RNG::SRand(UINT _seed)
   if (_seed==0)
     _seed = (UINT)time(NULL);
 
-  // bad arbitrary way of tweaking bad seed values
-  if (!_seed)
-    m_seed=-1;
-  else if((_seed>>16)==0)
-    m_seed = _seed | (_seed<<16);
-  else
-    m_seed = _seed;
+  m_key = _seed;
+  m_counter = 0;
+}
+
+// DESC: start stream _key from its first value
+// POST: quasi-random rolls and luck tracking are off
+void BMC_RNG::SetStream(U64 _key)
+{
+  m_key = _key;
+  m_counter = 0;
+  m_qmc_dim = m_qmc_dims = 0;
+  m_luck_rolls = 0;
+  m_script = NULL;
+}
+
+void BMC_RNG::SetQuasiRandom(U64 _key, U64 _index, INT _dims)
+{
+  BM_ASSERT(_dims <= (INT)(sizeof(c_halton_base)/sizeof(c_halton_base[0])));
+  m_qmc_key = _key;
+  m_qmc_index = _index;
+  m_qmc_dim = 0;
+  m_qmc_dims = (U8)_dims;
+}
+
+// DESC: the next coordinate: the radical inverse of the index in this coordinate's base, plus its offset, mod 1
+UINT BMC_RNG::GetQuasiRoll(UINT _sides)
+{
+  UINT base = c_halton_base[m_qmc_dim];
+  double inv_base = 1.0 / base;
+  double f = inv_base;
+  double u = 0;
+  for (U64 i = m_qmc_index; i > 0; i /= base)
+  {
+    u += f * (i % base);
+    f *= inv_base;
+  }
+
+  u += (MakeKey(m_qmc_key, m_qmc_dim) >> 11) * (1.0 / 9007199254740992.0);	// [0,1) with 53 bits
+  if (u >= 1)
+    u -= 1;
+  m_qmc_dim++;
+
+  UINT roll = (UINT)(u * _sides);
+  return (roll < _sides) ? roll : _sides - 1;
 }
 
-UINT BMC_RNG::GetRand()
+// DESC: derive a stream key from a parent key and up to two indices
+U64 BMC_RNG::MakeKey(U64 _a, U64 _b, U64 _c)
 {
-  // drp060323 - removed "register" keyword, which is no longer supported in C++ versions after 14. Optimizer should be making it irrelevant.
-  long LO, HI;
+  return BMF_MixKey(BMF_MixKey(BMF_MixKey(_a) ^ _b) ^ _c);
+}
+
+// DESC: value m_counter of stream m_key.  The counter is hashed on its own first, so consecutive counters (and
+// nearby keys) do not give related inputs to the outer hash.
+U64 BMC_RNG::GetRand64()
+{
+  return BMF_MixKey(m_key ^ BMF_MixKey(m_counter++));
+}
+
+UINT BMC_RNG::GetScriptedRoll(UINT _sides)
+{
+  BM_ASSERT(_sides > 0 && _sides < 256);
+
+  if (m_script_rolls >= (INT)m_script->size())
+    m_script->push_back(0);
+  if (m_script_rolls >= (INT)m_script_sides->size())
+    m_script_sides->resize(m_script_rolls + 1);
 
-  LO = ( (m_seed) & 0177777 ) * 16807;
-  HI = ( (m_seed) >> 16 ) * 16807 + ( LO >> 16 );
-  LO = ( LO & 0177777 ) + ( HI >> 15 );
-  HI = ( HI & 0077777 ) + ( LO >> 16 );
-  LO = ( LO & 0177777 ) + ( HI >> 15 );
-  HI = (( HI & 077777 ) << 16 ) + LO;
-  return( (m_seed) = HI );
+  (*m_script_sides)[m_script_rolls] = (U8)_sides;
+  return (*m_script)[m_script_rolls++];
 }
@@ -5,17 +5,30 @@
 // SPDX-FileCopyrightText: Copyright © 2024 Denis Papp <denis@accessdenied.net>
 // SPDX-FileComment: https://github.com/pappde/bmai
 //
-// DESC: track performance stats
+// DESC: random number streams
 //
 // REVISION HISTORY:
 // dbl100524 - further split out of individual headers
+// dbl101626 - g_rng is per-thread so parallel workers have independent streams
+// dbl101626 - keyed streams, each BMC_Game owns its generator and g_rng is removed
+// dbl101626 - optional quasi-random die rolls (randomized Halton sequence)
+// dbl101626 - roll luck tracking for control variates
+// dbl101626 - scripted die rolls for enumerating outcomes
+// dbl101626 - counter-based generator, so keyed streams never overlap
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
+#include <vector>
 #include "bmai_lib.h"
 
 
+// DESC: the generator is counter-based: value n of the stream with key k is a hash of (k, n).  SetStream()
+// selects the stream for a 64-bit key, so any number of reproducible streams can be derived with MakeKey()
+// without generating or skipping values.  For a fixed key the hash of the counter is a bijection, so a stream
+// does not repeat, and streams with different keys are independent rather than offsets on one shared cycle.
+// This is what lets simulations be keyed by (seed, decision, move, sim) and give the same results no matter
+// which thread runs them.
 class BMC_RNG
 {
 public:
@@ -23,12 +36,56 @@ public:
 
   UINT	GetRand(UINT _i)	{ return GetRand() % _i; }
   F32	GetFRand()		{ return (float)GetRand() / (float)0x80000000; }
-  UINT	GetRand();
+  UINT	GetRand()		{ return (UINT)(GetRand64() >> 33); }
+  U64	GetRand64();
   void	SRand(UINT _seed);
 
+  // streams
+  void	SetStream(U64 _key);
+  static U64 MakeKey(U64 _a, U64 _b, U64 _c = 0);
+
+  // die rolls.  After SetQuasiRandom(), the next _dims rolls are the coordinates of point _index of a Halton
+  // sequence, shifted by a random offset per coordinate picked by _key (Cranley-Patterson rotation).  Points
+  // 0..n-1 cover the outcome space more evenly than n independent rolls, and each roll is still uniform.
+  UINT	GetDieRoll(UINT _sides);
+  void	SetQuasiRandom(U64 _key, U64 _index, INT _dims);
+
+  // roll luck: the sum of (roll+0.5)/sides-0.5 over the next _rolls die rolls.  Its mean is exactly 0 for any
+  // dice, which is what makes it usable as a control variate.
+  void	TrackLuck(INT _rolls)	{ m_luck_rolls = (U8)_rolls; m_luck = 0; }
+  F32	GetLuck()				{ return m_luck; }
+
+  // scripted rolls, for enumerating the outcomes of a move: roll k is (*_script)[k], and the script is extended
+  // with 0s when more rolls are made.  The sides of each roll are recorded in (*_sides)[k].  NULL turns it off.
+  void	SetScript(std::vector<U8> *_script, std::vector<U8> *_sides) { m_script = _script; m_script_sides = _sides; m_script_rolls = 0; }
+  INT	GetScriptRolls()		{ return m_script_rolls; }
+
 private:
-  UINT	m_seed;
+  UINT	GetQuasiRoll(UINT _sides);
+  UINT	GetScriptedRoll(UINT _sides);
+
+  U64	m_key;					// stream
+  UINT	m_counter;				// position in the stream (a stream is 2^32 values long)
+  U8	m_qmc_dim, m_qmc_dims;		// next coordinate, and number of coordinates (0 when off)
+  U8	m_luck_rolls;				// rolls left to track
+  U64	m_qmc_key;
+  U64	m_qmc_index;
+  F32	m_luck;
+  INT	m_script_rolls;
+  std::vector<U8> *	m_script;
+  std::vector<U8> *	m_script_sides;
 };
 
-// global
-extern BMC_RNG		g_rng;
\ No newline at end of file
+inline UINT BMC_RNG::GetDieRoll(UINT _sides)
+{
+  if (m_script)
+    return GetScriptedRoll(_sides);
+
+  UINT roll = (m_qmc_dim < m_qmc_dims) ? GetQuasiRoll(_sides) : GetRand(_sides);
+  if (m_luck_rolls > 0)
+  {
+    m_luck += (roll + 0.5f) / _sides - 0.5f;
+    m_luck_rolls--;
+  }
+  return roll;
+}
@@ -0,0 +1,274 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_SelfPlay.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: self-play games that write every decision as training data
+//
+// REVISION HISTORY:
+// dbl101626 - added
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_SelfPlay.h"
+
+#include <cstring>
+#include "BMC_BMAI3.h"
+#include "BMC_RNG.h"
+#include "BMC_ThreadPool.h"
+
+
+static const char	c_selfplay_magic[4] = { 'B', 'M', 'S', 'P' };
+static const UINT	c_selfplay_version = 1;
+
+static_assert(sizeof(BMC_SelfPlay::Record)==400, "self-play records are fixed width");
+
+// Plays for one worker's BMAI3 and records each of its decisions, with the number of legal moves it had
+class BMC_RecordingAI : public BMC_AI
+{
+public:
+	BMC_RecordingAI(BMC_BMAI3 *_ai, std::vector<BMC_SelfPlay::Record> &_records, UINT _game)
+		: m_ai(_ai), m_records(_records), m_game(_game) {}
+
+	virtual void	GetSetSwingAction(BMC_Game *_game, BMC_Move &_move)
+	{
+		BMC_MoveList movelist;
+		_game->GenerateValidSetSwing(movelist);
+		m_ai->GetSetSwingAction(_game, _move);
+		Add(_game, _move, movelist.Size());
+	}
+
+	virtual void	GetAttackAction(BMC_Game *_game, BMC_Move &_move)
+	{
+		BMC_MoveList movelist;
+		_game->GenerateValidAttacks(movelist);
+		m_ai->GetAttackAction(_game, _move);
+		Add(_game, _move, movelist.Size());
+	}
+
+	virtual void	GetReserveAction(BMC_Game *_game, BMC_Move &_move)
+	{
+		// any reserve die, or none
+		INT moves = 1;
+		for (INT d=0; d<BMD_MAX_DICE; d++)
+		{
+			if (_game->GetPhasePlayer()->GetDie(d)->IsInReserve())
+				moves++;
+		}
+		m_ai->GetReserveAction(_game, _move);
+		Add(_game, _move, moves);
+	}
+
+	virtual void	GetUseChanceAction(BMC_Game *_game, BMC_Move &_move)
+	{
+		BMC_MoveList movelist;
+		_game->GenerateValidChance(movelist);
+		m_ai->GetUseChanceAction(_game, _move);
+		Add(_game, _move, movelist.Size());
+	}
+
+	virtual void	GetUseFocusAction(BMC_Game *_game, BMC_Move &_move)
+	{
+		BMC_MoveList movelist;
+		_game->GenerateValidFocus(movelist);
+		m_ai->GetUseFocusAction(_game, _move);
+		Add(_game, _move, movelist.Size());
+	}
+
+private:
+	void	Add(BMC_Game *_game, BMC_Move &_move, INT _moves)
+	{
+		m_records.resize(m_records.size() + 1);
+		BMC_SelfPlay::Record &record = m_records.back();
+		BMC_SelfPlay::GetRecord(_game, _move, _moves, m_ai->GetLastProbabilityWin(), record);
+		record.game = m_game;
+	}
+
+	BMC_BMAI3 *		m_ai;
+	std::vector<BMC_SelfPlay::Record> &	m_records;
+	UINT			m_game;
+};
+
+BMC_SelfPlay::BMC_SelfPlay()
+{
+	m_fp = NULL;
+	m_written = 0;
+	m_failed = false;
+}
+
+// DESC: play _games games from _game (which must be preround) and write their decisions to _filename.  Game N
+// uses RNG stream N of a key drawn from _game, so a run does not depend on the number of threads.
+// RETURNS: the number of records written, or -1 if the file could not be written
+INT BMC_SelfPlay::Run(BMC_Game *_game, BMC_BMAI3 *_ai, INT _games, const char *_filename)
+{
+	m_fp = fopen(_filename, "wb");
+	if (!m_fp)
+		return -1;
+
+	Header header;
+	std::memcpy(header.magic, c_selfplay_magic, sizeof(header.magic));
+	header.version = c_selfplay_version;
+	header.record_size = sizeof(Record);
+	header.reserved = 0;
+	m_failed = fwrite(&header, sizeof(header), 1, m_fp)!=1;
+	m_written = 0;
+
+	// every worker plays with its own copy of the AI
+	INT threads = g_pool.GetThreads();
+	std::vector<BMC_BMAI3>	ais(threads, *_ai);
+	std::vector<std::vector<Record>> output(threads);
+	U64 seed = _game->GetRNG().GetRand64();
+
+	g_pool.Run(_games, [&](INT _job, INT _worker)
+	{
+		std::vector<Record> records;
+		BMC_RecordingAI recorder(&ais[_worker], records, _job);
+		BMC_Game game(false);
+
+		game = *_game;
+		game.SetSimulation(false);
+		game.GetRNG().SetStream(BMC_RNG::MakeKey(seed, _job));
+		game.SetAI(0, &recorder);
+		game.SetAI(1, &recorder);
+		game.PlayGame();
+		FinishGame(&game, records);
+
+		std::vector<Record> &out = output[_worker];
+		out.insert(out.end(), records.begin(), records.end());
+		if (out.size() >= BMD_SELFPLAY_FLUSH)
+			Write(out);
+	});
+
+	for (INT t=0; t<threads; t++)
+		Write(output[t]);
+
+	m_failed = (fclose(m_fp)!=0) || m_failed;
+	m_fp = NULL;
+	return m_failed ? -1 : m_written;
+}
+
+// DESC: append _records to the file and clear them
+bool BMC_SelfPlay::Write(std::vector<Record> &_records)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!_records.empty() && fwrite(_records.data(), sizeof(Record), _records.size(), m_fp)!=_records.size())
+		m_failed = true;
+	else
+		m_written += (INT)_records.size();
+	_records.clear();
+	return !m_failed;
+}
+
+// DESC: fill in the results of the game and of each record's round.  A round ends when one of the standings goes
+// up, so each round's result is the standing that is higher at the first record of the next round (or at the end).
+void BMC_SelfPlay::FinishGame(BMC_Game *_game, std::vector<Record> &_records)
+{
+	U8 next[BME_WLT_MAX];
+	INT w;
+	for (w=0; w<BME_WLT_MAX; w++)
+		next[w] = (U8)_game->GetStanding(w);
+	bool won = _game->GetStanding(BME_WLT_WIN) > _game->GetStanding(BME_WLT_LOSS);
+
+	for (INT i=(INT)_records.size()-1; i>=0; i--)
+	{
+		Record &record = _records[i];
+		if (i+1<(INT)_records.size() && record.round!=_records[i+1].round)
+			std::memcpy(next, _records[i+1].standing, sizeof(next));
+
+		INT result = BME_WLT_MAX;
+		for (w=0; w<BME_WLT_MAX; w++)
+		{
+			if (next[w] > record.standing[w])
+				result = w;
+		}
+
+		// the standings are wrt player 0
+		if (record.player==1 && result==BME_WLT_WIN)
+			result = BME_WLT_LOSS;
+		else if (record.player==1 && result==BME_WLT_LOSS)
+			result = BME_WLT_WIN;
+
+		record.round_result = (U8)result;
+		record.game_result = (won ^ (record.player==1)) ? 1 : 0;
+	}
+}
+
+void BMC_SelfPlay::GetRecord(BMC_Game *_game, BMC_Move &_move, INT _moves, float _probability, Record &_record)
+{
+	INT p, d, t;
+
+	std::memset(&_record, 0, sizeof(_record));
+	_record.moves = (U16)_moves;
+	_record.phase = (U8)_game->GetPhase();
+	_record.player = (U8)_game->GetPhasePlayerID();
+	for (t=0; t<BME_WLT_MAX; t++)
+	{
+		_record.standing[t] = (U8)_game->GetStanding(t);
+		_record.round += _record.standing[t];
+	}
+	_record.target_wins = (U8)_game->GetTargetWins();
+	_record.probability = _probability;
+
+	for (p=0; p<BMD_MAX_PLAYERS; p++)
+	{
+		BMC_Player *player = _game->GetPlayer(p);
+		Player &out = _record.players[p];
+		out.score = player->GetScore();
+		out.dice = (U8)player->GetAvailableDice();
+		out.swing_set = (U8)player->GetSwingDiceSet();
+		for (d=0; d<BMD_MAX_DICE; d++)
+		{
+			BMC_Die *die = player->GetDie(d);
+			out.die[d].properties = die->GetProperties();
+			for (t=0; t<BMD_MAX_TWINS; t++)
+			{
+				out.die[d].sides[t] = (U8)die->GetSides(t);
+				out.die[d].swing_type[t] = (U8)die->GetSwingType(t);
+			}
+			out.die[d].value = (U8)die->GetValueTotal();
+			out.die[d].state = (U8)die->GetState();
+		}
+	}
+
+	Move &move = _record.move;
+	move.action = (U8)_move.m_action;
+	switch (_move.m_action)
+	{
+	case BME_ACTION_ATTACK:
+		move.attack = (U8)_move.m_attack;
+		move.attacker = _move.m_attacker;
+		move.target = _move.m_target;
+		for (d=0; d<BMD_MAX_DICE; d++)
+		{
+			if (_move.m_attackers.IsSet(d))
+				move.attackers |= 1 << d;
+			if (_move.m_targets.IsSet(d))
+				move.targets |= 1 << d;
+		}
+		break;
+	case BME_ACTION_SET_SWING_AND_OPTION:
+		std::memcpy(move.swing_value, _move.m_swing_value, sizeof(move.swing_value));
+		for (d=0; d<BMD_MAX_DICE; d++)
+		{
+			if (_move.m_option_die.IsSet(d))
+				move.option_die |= 1 << d;
+		}
+		break;
+	case BME_ACTION_USE_CHANCE:
+		for (d=0; d<BMD_MAX_DICE; d++)
+		{
+			if (_move.m_chance_reroll.IsSet(d))
+				move.chance_reroll |= 1 << d;
+		}
+		break;
+	case BME_ACTION_USE_FOCUS:
+		std::memcpy(move.focus_value, _move.m_focus_value, sizeof(move.focus_value));
+		break;
+	case BME_ACTION_USE_RESERVE:
+		move.use_reserve = _move.m_use_reserve;
+		break;
+	default:
+		break;
+	}
+}
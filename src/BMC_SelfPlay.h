@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_SelfPlay.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: self-play games that write every decision as training data
+//
+// REVISION HISTORY:
+// dbl101626 - added
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include "bmai_lib.h"
+
+
+class BMC_BMAI3;
+class BMC_Game;
+class BMC_Move;
+
+// Plays games from a preround position with a copy of one BMAI3 in both seats, on the thread pool, and writes a
+// fixed-width Record for every decision either player makes.  Records are buffered per worker and written in
+// chunks of BMD_SELFPLAY_FLUSH.  The file is a Header followed by records, in no particular order across games.
+class BMC_SelfPlay
+{
+public:
+	struct Header {
+		char		magic[4];			// "BMSP"
+		UINT		version;
+		UINT		record_size;
+		UINT		reserved;
+	};
+
+	struct Die {
+		U64			properties;
+		U8			sides[BMD_MAX_TWINS];
+		U8			swing_type[BMD_MAX_TWINS];
+		U8			value;				// total of all dice
+		U8			state;				// BME_STATE
+		U8			pad[2];
+	};
+
+	struct Player {
+		float		score;
+		U8			dice;				// dice in play, which come first in die[]
+		U8			swing_set;			// BMC_Player::SWING_SET
+		U8			pad[2];
+		Die			die[BMD_MAX_DICE];
+	};
+
+	// only the fields of the move's action are set, the rest are 0
+	struct Move {
+		U8			action;				// BME_ACTION
+		U8			attack;				// BME_ATTACK
+		S8			attacker;
+		S8			target;
+		U16			attackers;			// bit per die
+		U16			targets;
+		U16			option_die;
+		U16			chance_reroll;
+		U8			use_reserve;
+		U8			pad[3];
+		U8			swing_value[BME_SWING_MAX];
+		U8			focus_value[BMD_MAX_DICE];
+		U8			pad2[2];
+	};
+
+	struct Record {
+		UINT		game;				// game number within the run
+		U16			moves;				// legal moves at this decision
+		U8			round;				// rounds completed before this one
+		U8			phase;				// BME_PHASE
+		U8			player;				// deciding player
+		U8			standing[BME_WLT_MAX];	// wrt player 0
+		U8			target_wins;
+		U8			round_result;		// BME_WLT of this round for the deciding player
+		U8			game_result;		// 1 if the deciding player won the game
+		U8			pad;
+		float		probability;		// BMAI3's estimate for the chosen move
+		U8			pad2[4];
+		Player		players[BMD_MAX_PLAYERS];
+		Move		move;
+	};
+
+	BMC_SelfPlay();
+
+	// methods
+	INT				Run(BMC_Game *_game, BMC_BMAI3 *_ai, INT _games, const char *_filename);
+	static void		GetRecord(BMC_Game *_game, BMC_Move &_move, INT _moves, float _probability, Record &_record);
+
+private:
+	static void		FinishGame(BMC_Game *_game, std::vector<Record> &_records);
+	bool			Write(std::vector<Record> &_records);
+
+	FILE *			m_fp;
+	std::mutex		m_mutex;
+	INT				m_written;
+	bool			m_failed;
+};
@@ -9,6 +9,11 @@
 //
 // REVISION HISTORY:
 // drp030321 - split out from mega source file
+// dbl101626 - added Merge() for per-thread stats
+// dbl101626 - transposition table hit rate
+// dbl101626 - control variate gain
+// dbl101626 - history cutoffs
+// dbl101626 - time with steady_clock
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #include "BMC_Stats.h"
@@ -20,19 +25,46 @@
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 // global
-BMC_Stats  g_stats;
+thread_local BMC_Stats  g_stats;
 
 BMC_Stats::BMC_Stats()
 {
-	m_start = m_end = 0;
+	m_start = std::chrono::steady_clock::now();
+	m_end = 0;
+	ClearCounters();
+}
+
+void BMC_Stats::ClearCounters()
+{
 	m_sims = 0;
+	m_tt_probes = m_tt_hits = 0;
+	m_cv_gain = 0;
+	m_cv_samples = 0;
+	m_cutoff_sims = 0;
 	for (int i = 0; i < BMD_MAX_PLY; i++)
 		m_total_sims[i] = m_total_moves[i] = m_total_samples[i] = 0;
 }
 
+// DESC: add the counters from another (worker) instance. Timing is left alone.
+void BMC_Stats::Merge(const BMC_Stats &_stats)
+{
+	m_sims += _stats.m_sims;
+	m_tt_probes += _stats.m_tt_probes;
+	m_tt_hits += _stats.m_tt_hits;
+	m_cv_gain += _stats.m_cv_gain;
+	m_cv_samples += _stats.m_cv_samples;
+	m_cutoff_sims += _stats.m_cutoff_sims;
+	for (int i = 0; i < BMD_MAX_PLY; i++)
+	{
+		m_total_sims[i] += _stats.m_total_sims[i];
+		m_total_moves[i] += _stats.m_total_moves[i];
+		m_total_samples[i] += _stats.m_total_samples[i];
+	}
+}
+
 void BMC_Stats::DisplayStats()
 {
-	double diff = difftime(time(NULL), m_start);
+	double diff = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
 	printf("Time: %lf s ", diff);
 	printf("Sim: %d  Sims/Sec: %f  Mvs/Sms ", m_sims, diff > 0 ? m_sims / diff : 0);
 	float leaves = 1;
@@ -46,5 +78,12 @@ void BMC_Stats::DisplayStats()
 		printf("%.1f/%.1f ", avg_moves, avg_sims);
 		leaves *= avg_moves * avg_sims;
 	}
-	printf("= %.0f\n", leaves);
+	printf("= %.0f", leaves);
+	if (m_tt_probes > 0)
+		printf("  TT: %d/%d (%.1f%%)", m_tt_hits, m_tt_probes, 100.0f * m_tt_hits / m_tt_probes);
+	if (m_cv_samples > 0)
+		printf("  CV ess x%.2f", m_cv_gain / m_cv_samples);
+	if (m_cutoff_sims > 0)
+		printf("  Cutoff: %d sims", m_cutoff_sims);
+	printf("\n");
 }
\ No newline at end of file
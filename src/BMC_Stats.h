@@ -9,10 +9,18 @@
 //
 // REVISION HISTORY:
 // drp030321 - partial split out to individual headers
+// dbl101626 - g_stats is per-thread so parallel workers can count without locking, see Merge()
+// dbl101626 - transposition table probe/hit counters
+// dbl101626 - GetAverageMoves() for autoply
+// dbl101626 - control variate effective sample size gain
+// dbl101626 - sims skipped by history cutoffs
+// dbl101626 - GetSims()
+// dbl101626 - time with steady_clock, so Sims/Sec is not rounded to whole seconds
 ///////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
+#include <chrono>
 #include <ctime>
 #include "bmai_lib.h"
 
@@ -24,22 +32,41 @@ public:
 
 	// methods
 	void			DisplayStats();
+	void			Merge(const BMC_Stats &_stats);
+	void			ClearCounters();
 
 	// events
-	void			OnAppStarted() { m_start = time(NULL); }
+	void			OnAppStarted() { m_start = std::chrono::steady_clock::now(); }
 	void			OnFullSimulation() { m_sims++; }
 
 	// bmai-specific
 	void			OnPlyAction(int _ply, int _moves, int _sims) { m_total_sims[_ply] += _sims; m_total_moves[_ply] += _moves; m_total_samples[_ply]++; }
+	void			OnTransTableProbe(bool _hit) { m_tt_probes++; if (_hit) m_tt_hits++; }
+	void			OnControlVariate(float _gain) { m_cv_gain += _gain; m_cv_samples++; }
+	void			OnHistoryCutoff(int _sims) { m_cutoff_sims += _sims; }
+
+	// accessors
+	int				GetSims() { return m_sims; }
+	int				GetTransTableProbes() { return m_tt_probes; }
+	int				GetTransTableHits() { return m_tt_hits; }
+	int				GetCutoffSims() { return m_cutoff_sims; }
+	float			GetControlVariateGain() { return m_cv_samples > 0 ? (float)(m_cv_gain / m_cv_samples) : 1; }
+	float			GetAverageMoves(int _ply) { return m_total_samples[_ply] > 0 ? (float)m_total_moves[_ply] / m_total_samples[_ply] : 0; }
 
 private:
-	time_t			m_start, m_end;
+	std::chrono::steady_clock::time_point	m_start;
+	time_t			m_end;
 	int				m_sims;
 	int				m_total_sims[BMD_MAX_PLY];
 	int				m_total_moves[BMD_MAX_PLY];
 	int				m_total_samples[BMD_MAX_PLY];
+	int				m_tt_probes;
+	int				m_tt_hits;
+	double			m_cv_gain;			// sum of effective sample size gains
+	int				m_cv_samples;
+	int				m_cutoff_sims;		// sims skipped because the move was certain to be culled
 
 };
 
-// global
-extern BMC_Stats  g_stats;
\ No newline at end of file
+// global (one per thread, worker counts are merged back into the calling thread's instance)
+extern thread_local BMC_Stats  g_stats;
@@ -0,0 +1,438 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_TableBase.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: precomputed exact values of small fights between plain dice
+//
+// REVISION HISTORY:
+// dbl101626 - added, with the bmai_tbgen generator
+// dbl101626 - mapped with BMC_MappedFile
+// dbl101626 - stores P(win) and P(tie) separately (version 2)
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_TableBase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "BMC_Game.h"
+
+
+static const char	c_tablebase_magic[4] = { 'B', 'M', 'T', 'B' };
+static const UINT	c_tablebase_version = 2;
+static const float	c_tablebase_scale = 65535.0f;
+
+// global
+BMC_TableBase	g_tablebase;
+
+BMC_TableBase::BMC_TableBase()
+{
+	m_dice = 0;
+	m_hands = 0;
+	m_offsets = NULL;
+	m_values = NULL;
+	m_states = 0;
+	m_entries = 0;
+	std::fill(m_side_base, m_side_base+256, -1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// indexing
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void BMC_TableBase::SetSides(const std::vector<INT> &_sides)
+{
+	m_die_sides.clear();
+	m_die_value.clear();
+	std::fill(m_side_base, m_side_base+256, -1);
+
+	for (INT s : _sides)
+	{
+		m_side_base[s] = (INT)m_die_sides.size();
+		for (INT v=1; v<=s; v++)
+		{
+			m_die_sides.push_back((U8)s);
+			m_die_value.push_back((U8)v);
+		}
+	}
+
+	m_dice = (INT)m_die_sides.size();
+	m_hands = m_dice + m_dice * (m_dice+1) / 2;
+
+	m_hand_sides.resize(m_hands);
+	INT dice[2];
+	for (INT h=0; h<m_hands; h++)
+	{
+		INT n = GetHandDice(h, dice);
+		m_hand_sides[h] = 0;
+		for (INT i=0; i<n; i++)
+			m_hand_sides[h] += m_die_sides[dice[i]];
+	}
+}
+
+// RETURNS: the die index, or -1 if this die is not in the table
+INT BMC_TableBase::GetDieIndex(INT _sides, INT _value)
+{
+	if (_sides<1 || _sides>255 || m_side_base[_sides]<0 || _value<1 || _value>_sides)
+		return -1;
+	return m_side_base[_sides] + _value - 1;
+}
+
+// PARAM: die indices, _b is -1 for a one-die hand
+INT BMC_TableBase::GetHandIndex(INT _a, INT _b)
+{
+	if (_b<0)
+		return _a;
+	if (_a>_b)
+		std::swap(_a, _b);
+	return m_dice + _b * (_b+1) / 2 + _a;
+}
+
+// RETURNS: number of dice in hand _h, and their indices in _dice
+INT BMC_TableBase::GetHandDice(INT _h, INT *_dice)
+{
+	if (_h<m_dice)
+	{
+		_dice[0] = _h;
+		return 1;
+	}
+
+	INT k = _h - m_dice;
+	INT b = (INT)((std::sqrt(8.0 * k + 1) - 1) / 2);
+	while (b * (b+1) / 2 > k)
+		b--;
+	while ((b+1) * (b+2) / 2 <= k)
+		b++;
+	_dice[0] = k - b * (b+1) / 2;
+	_dice[1] = b;
+	return 2;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// generation
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// DESC: P(win) and P(tie) of a fight that ended with score difference _diff
+static void GetResult(INT _diff, float &_win, float &_tie)
+{
+	_win = (_diff > 0) ? 1.0f : 0.0f;
+	_tie = (_diff == 0) ? 1.0f : 0.0f;
+}
+
+// DESC: P(win) and P(tie) of a state that has been solved.  Every die in play either stays with its owner or is
+// captured, which swings the score difference by 3*sides half points, so outside the window the result is known.
+void BMC_TableBase::GetValue(std::vector<U16> &_values, std::vector<U64> &_offsets, INT _mover, INT _other, INT _diff, float &_win, float &_tie)
+{
+	INT mover_sides = 3 * GetHandSides(_mover);
+	INT other_sides = 3 * GetHandSides(_other);
+	if (_diff > mover_sides || _diff < -other_sides)
+	{
+		GetResult(_diff, _win, _tie);
+		return;
+	}
+	U64 entry = _offsets[(U64)_mover * m_hands + _other] + _diff + other_sides;
+	_win = _values[2*entry] / c_tablebase_scale;
+	_tie = _values[2*entry + 1] / c_tablebase_scale;
+}
+
+// RETURNS: true if the mover has a power or skill attack, otherwise it must pass
+bool BMC_TableBase::HasAttack(INT _mover, INT _other)
+{
+	INT m[2], o[2];
+	INT nm = GetHandDice(_mover, m);
+	INT no = GetHandDice(_other, o);
+	for (INT j=0; j<no; j++)
+	{
+		INT target = m_die_value[o[j]];
+		for (INT i=0; i<nm; i++)
+		{
+			if (m_die_value[m[i]] >= target)
+				return true;
+		}
+		if (nm==2 && m_die_value[m[0]] + m_die_value[m[1]] == target)
+			return true;
+	}
+	return false;
+}
+
+// DESC: solve every score difference of one hand pair.  Attacks capture one die and reroll the attackers, so their
+// children have one die fewer; a pass goes to the swapped hand pair, which must have an attack to not be over.
+void BMC_TableBase::SolveState(std::vector<U16> &_values, std::vector<U64> &_offsets, INT _mover, INT _other)
+{
+	INT m[2], o[2];
+	INT nm = GetHandDice(_mover, m);
+	INT no = GetHandDice(_other, o);
+	INT min_diff = -3 * GetHandSides(_other);
+	UINT window = GetWindow(_mover, _other);
+	std::vector<float> best(window, -1), best_win(window), best_tie(window), expected_win(window), expected_tie(window);
+	INT d;
+	UINT w;
+	float win, tie;
+
+	for (INT j=0; j<no; j++)
+	{
+		if (j==1 && o[1]==o[0])
+			continue;
+
+		INT target = m_die_value[o[j]];
+		INT gain = 3 * m_die_sides[o[j]];
+		INT other_left = (no==2) ? o[!j] : -1;
+
+		// attackers: each die that can power attack, and both dice if they can skill attack
+		for (INT a=0; a<3; a++)
+		{
+			bool both = (a==2);
+			if (both ? (nm<2 || m_die_value[m[0]] + m_die_value[m[1]] != target) :
+				(a>=nm || m_die_value[m[a]] < target || (a==1 && m[1]==m[0])))
+				continue;
+
+			INT sides0 = m_die_sides[m[both ? 0 : a]];
+			INT sides1 = both ? m_die_sides[m[1]] : 1;
+			float p = 1.0f / (sides0 * sides1);
+			std::fill(expected_win.begin(), expected_win.end(), 0.0f);
+			std::fill(expected_tie.begin(), expected_tie.end(), 0.0f);
+
+			for (INT v0=1; v0<=sides0; v0++)
+			{
+				for (INT v1=1; v1<=sides1; v1++)
+				{
+					INT die0 = GetDieIndex(sides0, v0);
+					INT die1 = both ? GetDieIndex(sides1, v1) : (nm==2 ? m[!a] : -1);
+					INT mover_after = GetHandIndex(die0, die1);
+
+					for (d=min_diff, w=0; w<window; d++, w++)
+					{
+						if (other_left<0)
+						{
+							GetResult(d + gain, win, tie);
+							expected_win[w] += p * win;
+						}
+						else
+						{
+							// the other player moves next, so their losses are the mover's wins
+							GetValue(_values, _offsets, other_left, mover_after, -(d + gain), win, tie);
+							expected_win[w] += p * (1 - win - tie);
+						}
+						expected_tie[w] += p * tie;
+					}
+				}
+			}
+
+			// attacks are chosen by P(win)+P(tie)/2
+			for (w=0; w<window; w++)
+			{
+				float value = expected_win[w] + expected_tie[w] / 2;
+				if (value > best[w])
+				{
+					best[w] = value;
+					best_win[w] = expected_win[w];
+					best_tie[w] = expected_tie[w];
+				}
+			}
+		}
+	}
+
+	// pass: the other player moves, or if they can't either the fight is over
+	if (best[0] < 0)
+	{
+		bool other_attacks = HasAttack(_other, _mover);
+		for (d=min_diff, w=0; w<window; d++, w++)
+		{
+			if (other_attacks)
+			{
+				GetValue(_values, _offsets, _other, _mover, -d, win, tie);
+				best_win[w] = 1 - win - tie;
+				best_tie[w] = tie;
+			}
+			else
+				GetResult(d, best_win[w], best_tie[w]);
+		}
+	}
+
+	U64 offset = _offsets[(U64)_mover * m_hands + _other];
+	for (w=0; w<window; w++)
+	{
+		_values[2*(offset + w)] = (U16)std::lround(best_win[w] * c_tablebase_scale);
+		_values[2*(offset + w) + 1] = (U16)std::lround(best_tie[w] * c_tablebase_scale);
+	}
+}
+
+// DESC: solve all fights between hands of one or two dice with these _sides, and write them to _filename
+// RETURNS: false if the sides are not valid or the file could not be written
+bool BMC_TableBase::Generate(const std::vector<INT> &_sides, const char *_filename)
+{
+	std::vector<INT> sides = _sides;
+	std::sort(sides.begin(), sides.end());
+	sides.erase(std::unique(sides.begin(), sides.end()), sides.end());
+	if (sides.empty() || sides.size()>BMD_TABLEBASE_MAX_SIDES || sides.front()<1 || sides.back()>255)
+		return false;
+
+	SetSides(sides);
+
+	// offsets of each hand pair's window
+	U64 states = (U64)m_hands * m_hands;
+	std::vector<U64> offsets(states);
+	U64 entries = 0;
+	INT mover, other;
+	for (mover=0; mover<m_hands; mover++)
+	{
+		for (other=0; other<m_hands; other++)
+		{
+			offsets[(U64)mover * m_hands + other] = entries;
+			entries += GetWindow(mover, other);
+		}
+	}
+
+	// solve by number of dice in play, the attacks before the passes that depend on them
+	std::vector<U16> values(2 * entries);
+	INT dice[2];
+	for (INT n=2; n<=4; n++)
+	{
+		for (INT pass=0; pass<2; pass++)
+		{
+			for (mover=0; mover<m_hands; mover++)
+			{
+				for (other=0; other<m_hands; other++)
+				{
+					if (GetHandDice(mover, dice) + GetHandDice(other, dice) != n || HasAttack(mover, other) == (pass==1))
+						continue;
+					SolveState(values, offsets, mover, other);
+				}
+			}
+		}
+	}
+
+	// write
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, c_tablebase_magic, sizeof(header.magic));
+	header.version = c_tablebase_version;
+	header.num_sides = (UINT)sides.size();
+	for (UINT i=0; i<header.num_sides; i++)
+		header.sides[i] = (U8)sides[i];
+	header.states = (UINT)states;
+	header.entries = entries;
+
+	FILE *fp = fopen(_filename, "wb");
+	if (!fp)
+		return false;
+	bool ok = fwrite(&header, sizeof(header), 1, fp)==1
+		&& fwrite(offsets.data(), sizeof(U64), offsets.size(), fp)==offsets.size()
+		&& fwrite(values.data(), sizeof(U16), values.size(), fp)==values.size();
+	ok = (fclose(fp)==0) && ok;
+
+	m_states = (INT)states;
+	m_entries = entries;
+	return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// probing
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// RETURNS: false if the file is missing or not a tablebase
+bool BMC_TableBase::Load(const char *_filename)
+{
+	Unload();
+
+	if (!m_file.Open(_filename))
+		return false;
+
+	Header header;
+	const U8 *data = m_file.GetData();
+	bool ok = m_file.GetSize() >= sizeof(header);
+	if (ok)
+	{
+		std::memcpy(&header, data, sizeof(header));
+		ok = std::memcmp(header.magic, c_tablebase_magic, sizeof(header.magic))==0
+			&& header.version==c_tablebase_version
+			&& header.num_sides>0 && header.num_sides<=BMD_TABLEBASE_MAX_SIDES
+			&& m_file.GetSize() == sizeof(header) + (U64)header.states * sizeof(U64) + 2 * header.entries * sizeof(U16);
+	}
+	if (!ok)
+	{
+		m_file.Close();
+		return false;
+	}
+
+	std::vector<INT> sides(header.sides, header.sides + header.num_sides);
+	SetSides(sides);
+	m_states = (INT)header.states;
+	m_entries = header.entries;
+	m_offsets = (const U64 *)(data + sizeof(header));
+	m_values = (const U16 *)(data + sizeof(header) + (U64)header.states * sizeof(U64));
+	return true;
+}
+
+void BMC_TableBase::Unload()
+{
+	m_file.Close();
+	m_offsets = NULL;
+	m_values = NULL;
+	m_states = 0;
+	m_entries = 0;
+}
+
+// DESC: look up the phase player's value of a fight, P(win)+P(tie)/2
+// RETURNS: false if the fight is not in the table
+bool BMC_TableBase::Probe(BMC_Game *_game, float &_value)
+{
+	float win, tie;
+	if (!Probe(_game, win, tie))
+		return false;
+	_value = win + tie / 2;
+	return true;
+}
+
+// DESC: look up the phase player's P(win) and P(tie) of a fight.  Only ready dice with no properties count.
+// RETURNS: false if the fight is not in the table
+bool BMC_TableBase::Probe(BMC_Game *_game, float &_win, float &_tie)
+{
+	if (!IsLoaded() || _game->GetPhase()!=BME_PHASE_FIGHT)
+		return false;
+
+	INT hand[2];
+	INT sides[2];
+	for (INT p=0; p<2; p++)
+	{
+		BMC_Player *player = (p==0) ? _game->GetPhasePlayer() : _game->GetTargetPlayer();
+		INT n = player->GetAvailableDice();
+		if (n<1 || n>2)
+			return false;
+
+		INT dice[2] = { -1, -1 };
+		sides[p] = 0;
+		for (INT d=0; d<n; d++)
+		{
+			BMC_Die *die = player->GetDie(d);
+			if (die->GetState()!=BME_STATE_READY || die->GetProperties()!=BME_PROPERTY_VALID)
+				return false;
+			dice[d] = GetDieIndex(die->GetSidesMax(), die->GetValueTotal());
+			if (dice[d]<0)
+				return false;
+			sides[p] += 3 * die->GetSidesMax();
+		}
+		hand[p] = GetHandIndex(dice[0], dice[1]);
+	}
+
+	// score difference in half points
+	float diff_f = 2 * (_game->GetPhasePlayer()->GetScore() - _game->GetTargetPlayer()->GetScore());
+	INT diff = (INT)std::lround(diff_f);
+	if (std::fabs(diff_f - diff) > 0.01f)
+		return false;
+
+	if (diff > sides[0] || diff < -sides[1])
+		GetResult(diff, _win, _tie);
+	else
+	{
+		U64 entry = m_offsets[(U64)hand[0] * m_hands + hand[1]] + diff + sides[1];
+		_win = m_values[2*entry] / c_tablebase_scale;
+		_tie = m_values[2*entry + 1] / c_tablebase_scale;
+	}
+
+	return true;
+}
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_TableBase.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: precomputed exact values of small fights between plain dice
+//
+// REVISION HISTORY:
+// dbl101626 - added, with the bmai_tbgen generator
+// dbl101626 - mapped with BMC_MappedFile
+// dbl101626 - P(win) and P(tie) are stored separately
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "bmai_lib.h"
+#include "BMC_MappedFile.h"
+
+
+class BMC_Game;
+
+// Exact values of every fight where each player has one or two plain dice (no properties, sides from a fixed
+// list), under optimal play from both sides.  A state is the phase player's hand, the other hand, and the score
+// difference in half points.  Each state stores P(win) and P(tie) for the phase player, as 16-bit fractions, under
+// play that maximizes P(win)+P(tie)/2.
+//
+// The file holds a header, the offset of each hand pair's values, and the values.  Each hand pair only stores the
+// score differences whose result is still open; outside that window the fight is already decided.  It is written
+// by Generate() (see bmai_tbgen) and memory-mapped read-only by Load(), so it is shared by all threads.
+class BMC_TableBase
+{
+public:
+	BMC_TableBase();
+	~BMC_TableBase() { Unload(); }
+
+	// methods
+	bool			Generate(const std::vector<INT> &_sides, const char *_filename);
+	bool			Load(const char *_filename);
+	void			Unload();
+	bool			Probe(BMC_Game *_game, float &_value);
+	bool			Probe(BMC_Game *_game, float &_win, float &_tie);
+
+	// accessors
+	bool			IsLoaded() { return m_values != NULL; }
+	INT				GetStates() { return m_states; }
+	U64				GetEntries() { return m_entries; }
+
+private:
+	struct Header {
+		char		magic[4];
+		UINT		version;
+		UINT		num_sides;
+		U8			sides[BMD_TABLEBASE_MAX_SIDES];
+		UINT		states;
+		U64			entries;
+	};
+
+	// indexing
+	void			SetSides(const std::vector<INT> &_sides);
+	INT				GetDieIndex(INT _sides, INT _value);
+	INT				GetHandIndex(INT _a, INT _b);
+	INT				GetHandSides(INT _h) { return m_hand_sides[_h]; }
+	INT				GetHandDice(INT _h, INT *_dice);
+	UINT			GetWindow(INT _mover, INT _other) { return 3 * (GetHandSides(_mover) + GetHandSides(_other)) + 1; }
+
+	// generation
+	void			GetValue(std::vector<U16> &_values, std::vector<U64> &_offsets, INT _mover, INT _other, INT _diff, float &_win, float &_tie);
+	bool			HasAttack(INT _mover, INT _other);
+	void			SolveState(std::vector<U16> &_values, std::vector<U64> &_offsets, INT _mover, INT _other);
+
+	// die index -> sides/value
+	std::vector<U8>	m_die_sides;
+	std::vector<U8>	m_die_value;
+	std::vector<INT> m_hand_sides;		// total sides of each hand
+	INT				m_side_base[256];	// first die index of each number of sides, -1 if not in the table
+	INT				m_dice;				// die indices
+	INT				m_hands;			// 1 or 2 die indices, a<=b
+
+	// loaded file
+	BMC_MappedFile	m_file;
+	const U64 *		m_offsets;
+	const U16 *		m_values;			// P(win), P(tie) pairs
+	INT				m_states;
+	U64				m_entries;
+};
+
+// global
+extern BMC_TableBase	g_tablebase;
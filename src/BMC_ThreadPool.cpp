@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_ThreadPool.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: a small persistent worker pool used to spread simulation batches across cores
+//
+// REVISION HISTORY:
+// dbl101626 - added for root-parallel BMAI3 simulations
+// dbl101626 - new workers start from the current batch, so they do not rerun the last one
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_ThreadPool.h"
+
+#include "BMC_Logger.h"
+
+
+// global
+BMC_ThreadPool	g_pool;
+
+thread_local bool BMC_ThreadPool::sm_in_job = false;
+
+BMC_ThreadPool::BMC_ThreadPool()
+{
+	m_threads = 1;
+	m_func = NULL;
+	m_jobs = 0;
+	m_next_job = 0;
+	m_busy_workers = 0;
+	m_batch = 0;
+	m_quit = false;
+}
+
+BMC_ThreadPool::~BMC_ThreadPool()
+{
+	StopWorkers();
+}
+
+// PARAM: total number of threads including the calling thread. 0 means use all hardware threads.
+void BMC_ThreadPool::SetThreads(INT _threads)
+{
+	BM_ASSERT(!sm_in_job);
+
+	if (_threads<=0)
+		_threads = (INT)std::thread::hardware_concurrency();
+	if (_threads<1)
+		_threads = 1;
+
+	StopWorkers();
+
+	// a worker that started with an older batch number would run the last batch's jobs again
+	U32 batch;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = false;
+		batch = m_batch;
+	}
+
+	m_threads = _threads;
+	for (INT w=1; w<m_threads; w++)
+		m_workers.emplace_back(&BMC_ThreadPool::WorkerMain, this, w, batch);
+}
+
+void BMC_ThreadPool::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_start_cv.notify_all();
+
+	for (size_t i=0; i<m_workers.size(); i++)
+		m_workers[i].join();
+
+	m_workers.clear();
+	m_threads = 1;
+}
+
+void BMC_ThreadPool::Run(INT _jobs, const JobFunc &_func)
+{
+	if (_jobs<=0)
+		return;
+
+	// serial case: no workers, or called from inside a job
+	if (!IsParallel())
+	{
+		bool was_in_job = sm_in_job;
+		sm_in_job = true;
+		for (INT j=0; j<_jobs; j++)
+			_func(j, 0);
+		sm_in_job = was_in_job;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_func = &_func;
+		m_jobs = _jobs;
+		m_next_job = 0;
+		m_busy_workers = (INT)m_workers.size();
+		m_batch++;
+	}
+	m_start_cv.notify_all();
+
+	RunJobs(0);
+
+	// wait for the other workers to finish their last job
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done_cv.wait(lock, [this] { return m_busy_workers==0; });
+	m_func = NULL;
+}
+
+void BMC_ThreadPool::RunJobs(INT _worker)
+{
+	sm_in_job = true;
+	for (;;)
+	{
+		INT job = m_next_job++;
+		if (job>=m_jobs)
+			break;
+		(*m_func)(job, _worker);
+	}
+	sm_in_job = false;
+}
+
+// PARAM: _batch is the last batch run before this worker started
+void BMC_ThreadPool::WorkerMain(INT _worker, U32 _batch)
+{
+	U32 last_batch = _batch;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_start_cv.wait(lock, [&] { return m_quit || m_batch!=last_batch; });
+			if (m_quit)
+				return;
+			last_batch = m_batch;
+		}
+
+		RunJobs(_worker);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busy_workers--;
+			BM_ASSERT(m_busy_workers>=0);
+		}
+		m_done_cv.notify_one();
+	}
+}
@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_ThreadPool.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: a small persistent worker pool used to spread simulation batches across cores.  The parser's
+// 'benchthreads' command measures the speedup it gives on a position.
+//
+// REVISION HISTORY:
+// dbl101626 - added for root-parallel BMAI3 simulations
+// dbl101626 - WorkerMain() takes the current batch
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bmai_lib.h"
+
+
+class BMC_ThreadPool
+{
+public:
+	typedef std::function<void(INT _job, INT _worker)> JobFunc;
+
+	BMC_ThreadPool();
+	~BMC_ThreadPool();
+
+	// DESC: run _func for every job in [0,_jobs) and wait for all of them to finish.  The calling thread
+	// participates as worker 0.  Nested calls (from inside a job) run serially on the calling worker.
+	void			Run(INT _jobs, const JobFunc &_func);
+
+	// mutators
+	void			SetThreads(INT _threads);
+
+	// accessors
+	INT				GetThreads() { return m_threads; }
+	bool			IsParallel() { return m_threads > 1 && !sm_in_job; }
+	static bool		InJob() { return sm_in_job; }
+
+private:
+	void			WorkerMain(INT _worker, U32 _batch);
+	void			RunJobs(INT _worker);
+	void			StopWorkers();
+
+	INT				m_threads;
+	std::vector<std::thread> m_workers;
+
+	// current batch
+	std::mutex		m_mutex;
+	std::condition_variable m_start_cv;
+	std::condition_variable m_done_cv;
+	const JobFunc *	m_func;
+	INT				m_jobs;
+	std::atomic<INT> m_next_job;
+	INT				m_busy_workers;
+	U32				m_batch;
+	bool			m_quit;
+
+	static thread_local bool sm_in_job;
+};
+
+// global
+extern BMC_ThreadPool	g_pool;
@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_TransTable.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: fixed-size transposition table of inner-ply BMAI3 win probabilities
+//
+// REVISION HISTORY:
+// dbl101626 - added for BMAI3 inner-ply searches
+// dbl101626 - keys include the search generation
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BMC_TransTable.h"
+
+#include <cstring>
+
+
+// global
+BMC_TransTable	g_ttable;
+
+BMC_TransTable::BMC_TransTable()
+{
+	m_size = 0;
+	m_generation = 0;
+}
+
+// PARAM: number of entries, rounded down to a power of 2 (min 2). 0 disables the table and frees it.
+void BMC_TransTable::SetSize(INT _entries)
+{
+	m_entries.reset();
+	m_size = 0;
+
+	if (_entries<=0)
+		return;
+
+	m_size = 2;
+	while (m_size*2 <= _entries)
+		m_size *= 2;
+
+	m_entries.reset(new Entry[m_size]);
+	Clear();
+}
+
+void BMC_TransTable::Clear()
+{
+	for (INT i=0; i<m_size; i++)
+	{
+		m_entries[i].check.store(0, std::memory_order_relaxed);
+		m_entries[i].data.store(0, std::memory_order_relaxed);
+	}
+}
+
+U64 BMC_TransTable::Pack(float _probability, INT _sims)
+{
+	UINT bits;
+	std::memcpy(&bits, &_probability, sizeof(bits));
+	return bits | ((U64)_sims << 32);
+}
+
+void BMC_TransTable::Unpack(U64 _data, float &_probability, INT &_sims)
+{
+	UINT bits = (UINT)_data;
+	std::memcpy(&_probability, &bits, sizeof(bits));
+	_sims = (INT)(_data >> 32);
+}
+
+// RETURNS: true if _key was found, with the stored result in _probability and _sims
+bool BMC_TransTable::Probe(U64 _key, float &_probability, INT &_sims)
+{
+	if (!IsEnabled())
+		return false;
+
+	_key = GetGenerationKey(_key);
+	Entry *bucket = &m_entries[_key & (m_size-1) & ~1];
+	for (INT i=0; i<2; i++)
+	{
+		U64 data = bucket[i].data.load(std::memory_order_relaxed);
+		U64 check = bucket[i].check.load(std::memory_order_relaxed);
+		// empty entries have no sims
+		if ((check ^ data) == _key && (data >> 32) > 0)
+		{
+			Unpack(data, _probability, _sims);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BMC_TransTable::Store(U64 _key, float _probability, INT _sims)
+{
+	if (!IsEnabled() || _sims<=0)
+		return;
+
+	_key = GetGenerationKey(_key);
+	Entry *bucket = &m_entries[_key & (m_size-1) & ~1];
+	U64 data = Pack(_probability, _sims);
+
+	// the first entry keeps the larger search, unless it is the same state
+	float old_probability;
+	INT old_sims;
+	U64 old_data = bucket[0].data.load(std::memory_order_relaxed);
+	U64 old_check = bucket[0].check.load(std::memory_order_relaxed);
+	Unpack(old_data, old_probability, old_sims);
+
+	Entry *entry = (_sims >= old_sims || (old_check ^ old_data) == _key) ? &bucket[0] : &bucket[1];
+	entry->check.store(_key ^ data, std::memory_order_relaxed);
+	entry->data.store(data, std::memory_order_relaxed);
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// BMC_TransTable.h
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: fixed-size transposition table of inner-ply BMAI3 win probabilities
+//
+// REVISION HISTORY:
+// dbl101626 - added for BMAI3 inner-ply searches
+// dbl101626 - NewSearch() generations, so old entries are not reused
+// dbl101626 - the generation is atomic, since self-play games start searches on several threads
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "bmai_lib.h"
+
+
+// Maps a state key (see BMC_Game::GetStateHash()) to the win probability and sim count of the search from that
+// state.  Buckets hold two entries: one keeps the larger search, the other is always replaced.  The parallel
+// workers share the table without locks; each entry stores key^data next to data, so a torn write fails the key
+// check and reads as a miss.  A stored result only depends on its state (see BMC_BMAI3::EvaluateAttackAction()),
+// so which worker stores a state first, or whether a probe misses, does not change a decision.  NewSearch() starts
+// a new generation: the generation is mixed into every key, so entries from earlier searches (and earlier
+// settings) never match again, without clearing the table.
+class BMC_TransTable
+{
+public:
+	BMC_TransTable();
+
+	// methods
+	void			Clear();
+	bool			Probe(U64 _key, float &_probability, INT &_sims);
+	void			Store(U64 _key, float _probability, INT _sims);
+	void			NewSearch() { m_generation.fetch_add(1, std::memory_order_relaxed); }
+
+	// mutators
+	void			SetSize(INT _entries);
+
+	// accessors
+	bool			IsEnabled() { return m_size > 0; }
+	INT				GetSize() { return m_size; }
+
+private:
+	struct Entry {
+		std::atomic<U64>	check;		// key ^ data
+		std::atomic<U64>	data;		// probability bits | sims << 32
+	};
+
+	U64				GetGenerationKey(U64 _key) { return _key ^ (m_generation.load(std::memory_order_relaxed) * 0x9E3779B97F4A7C15ULL); }
+	static U64		Pack(float _probability, INT _sims);
+	static void		Unpack(U64 _data, float &_probability, INT &_sims);
+
+	std::unique_ptr<Entry[]>	m_entries;
+	INT				m_size;
+	std::atomic<U64>	m_generation;
+};
+
+// global
+extern BMC_TransTable	g_ttable;
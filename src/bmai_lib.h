@@ -12,6 +12,10 @@
 // dbl051823 - added P-Swing, Q-Swing support
 // drp060323 - added const modifier to vararg format params
 // dbl100824 - pulled a lot out of bmai.h depends on very little and initializes a lot for pre-compilation
+// dbl101626 - BMD_AI_TYPES includes MCTS
+// dbl101626 - BMD_AI_TYPES includes the rollout policy AI
+// dbl101626 - history table settings
+// dbl101626 - BME_ACTION and BME_ATTACK are byte-sized, for compact moves
 //
 // TODO:
 // 1) drp030321 - setup a main precompiled header that includes everything (bmai.h) vs a header for the key types/enums/classes. Split out modules
@@ -62,8 +66,21 @@ typedef std::vector<float>	BMC_FloatVector;
 #define BMD_DEFAULT_SIMS		500
 #define BMD_MIN_SIMS			10
 #define BMD_QAI_FUZZINESS		5
-#define BMD_MAX_PLY_PREROUND	2
-#define BMD_AI_TYPES			3
+#define BMD_POLICY_FUZZINESS	2.0f	// random spread added to each rollout policy move score
+#define BMD_MAX_PLY_PREROUND	2		// autoply cap for non-fight decisions
+#define BMD_AUTOPLY_MOVES		10		// autoply guess at deeper-ply moves when none have been seen yet
+#define BMD_AUTOPLY_RATE_SIMS	16		// autoply rollouts timed to measure the sim rate
+#define BMD_QMC_DIMS			8		// die rolls per simulation drawn from the quasi-random sequence
+#define BMD_ENDGAME_MAX_NODES	200000	// the endgame solver gives up (and BMAI3 samples) past this many nodes
+#define BMD_ENDGAME_MAX_DEPTH	40		// or this many actions deep
+#define BMD_ENDGAME_MAX_CACHE	1000000	// cached endgame values per thread before the cache is cleared
+#define BMD_TABLEBASE_MAX_SIDES	16		// different die sizes in one tablebase
+#define BMD_EQUILIBRIUM_ITERATIONS	10000	// fictitious play iterations for a swing equilibrium
+#define BMD_EVAL_MAX_WIDTH	256		// widest hidden layer of a leaf evaluator network
+#define BMD_SELFPLAY_FLUSH	4096	// self-play records each worker buffers before writing them out
+#define BMD_HISTORY_SIDES		32		// history table rows per attack: total sides of the attacking (or target) dice, capped
+#define BMD_HISTORY_MAX		1000000.0f	// history values are halved once one passes this
+#define BMD_AI_TYPES			5
 
 // MOOD dice - from BM page:
 #define BMD_MOOD_SIDES_RANGE_X	6
@@ -87,7 +104,7 @@ enum BME_DEBUG
 };
 
 // all the different "actions" that can be submitted 
-enum BME_ACTION
+enum BME_ACTION : U8
 {
 	xBME_ACTION_USE_AUXILIARY,
 	BME_ACTION_USE_CHANCE,
@@ -194,7 +211,7 @@ enum BME_PHASE
 	BME_PHASE_MAX
 };
 
-enum BME_ATTACK
+enum BME_ATTACK : U8
 {
 	BME_ATTACK_FIRST = 0,
 	BME_ATTACK_POWER = BME_ATTACK_FIRST,	// 1 -> 1
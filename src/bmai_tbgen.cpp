@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+// bmai_tbgen.cpp
+//
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+//
+// DESC: offline generator for the fight tablebase (see BMC_TableBase)
+//
+// REVISION HISTORY:
+// dbl101626 - added
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "BMC_TableBase.h"
+
+
+// usage: bmai_tbgen <file> [sides...]
+// default sides are the standard 4, 6, 8, 10 and 12
+int main(int argc, char *argv[])
+{
+	if (argc<2)
+	{
+		printf("usage: bmai_tbgen <file> [sides...]\n");
+		return 1;
+	}
+
+	std::vector<INT> sides;
+	for (int i=2; i<argc; i++)
+		sides.push_back(atoi(argv[i]));
+	if (sides.empty())
+		sides = { 4, 6, 8, 10, 12 };
+
+	BMC_TableBase tablebase;
+	if (!tablebase.Generate(sides, argv[1]))
+	{
+		printf("could not generate %s\n", argv[1]);
+		return 1;
+	}
+
+	printf("wrote %s: %d hand pairs, %llu values\n", argv[1], tablebase.GetStates(), (unsigned long long)tablebase.GetEntries());
+	return 0;
+}
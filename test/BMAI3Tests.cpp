@@ -3,35 +3,80 @@
 // SPDX-FileComment: https://github.com/pappde/bmai
 
 #include "_testutils.h"
+#include "../src/BMC_BMAI3.h"
+#include "../src/BMC_Endgame.h"
+#include "../src/BMC_QAI.h"
+#include "../src/BMC_Stats.h"
+#include "../src/BMC_ThreadPool.h"
+#include "../src/BMC_TransTable.h"
+#include <atomic>
+#include <chrono>
+#include <climits>
 #include <cstdio>
-#include <filesystem>
+#include <fstream>
+#include <thread>
 #include <gtest/gtest.h>
 
 
-// a path util, if useful consider breaking out into generic utility
-inline std::string resolvePath(const std::string &relPath)
-{
-    auto baseDir = std::filesystem::current_path();
-    while (baseDir.has_parent_path())
+class BMAIActionTests :public ::testing::TestWithParam<std::tuple<std::string, std::string>> {
+protected:
+    TEST_Parser parser;
+};
+
+// exposes the simulation internals of BMAI3
+class TEST_BMAI3 : public BMC_BMAI3 {
+public:
+    TEST_BMAI3(BMC_AI *_ai) : BMC_BMAI3(_ai) {}
+
+    // run sims 0.._sims-1 of every valid attack, and return the attacks and each sim's result
+    std::vector<std::vector<float>> SimulateAttacks(BMC_Game *_game, BMC_MoveList &_movelist, INT _sims)
     {
-        auto combinePath = baseDir / relPath;
-        if (exists(combinePath))
+        _game->GenerateValidAttacks(_movelist);
+        INT enter_level;
+        OnStartEvaluation(_game, enter_level);
+        BMC_ThinkState t(this, _game, _movelist);
+        BMC_Game sim(true);
+        std::vector<std::vector<float>> results(_movelist.Size());
+        for (INT i=0; i<_movelist.Size(); i++)
+            for (INT s=0; s<_sims; s++)
+                results[i].push_back(SimulateMove(sim, t, i, s, enter_level));
+        OnEndEvaluation(_game, enter_level);
+        return results;
+    }
+
+    INT GetLastSims() { return m_last_sims; }
+
+    // out of time from deadline check number _check on, instead of by the clock
+    void SetTimeoutCheck(INT _check) { timeout_check = _check; }
+    bool IsOutOfTime() override { return timeout_check>0 ? ++checks >= timeout_check : BMC_BMAI3::IsOutOfTime(); }
+    INT checks = 0, timeout_check = 0;
+
+    // lead with move 0 on a stale score, then apply the control variate to sums where move 1 is better.
+    // RETURNS: the best move left for the decision loop, and the adjusted scores
+    BMC_Move * ApplyControlVariateAfterLead(BMC_Game *_game, BMC_MoveList &_movelist, float _adjusted[2])
+    {
+        _game->GenerateValidAttacks(_movelist);
+        BMC_ThinkState t(this, _game, _movelist);
+        t.SetBestMove(_movelist.Get(0), 9);
+        for (INT i=0; i<2; i++)
         {
-            return combinePath.string();
-        }
-        if(baseDir==baseDir.parent_path()) {
-            break;
-        } else {
-            baseDir = baseDir.parent_path();
+            // 10 sims with luck -1/+1 alternating, win rate 30% for move 0 and 70% for move 1
+            for (INT s=0; s<10; s++)
+            {
+                float luck = (s & 1) ? 1.0f : -1.0f;
+                float y = (s < (i==0 ? 3 : 7)) ? 1.0f : 0.0f;
+                t.control[i].y += y;
+                t.control[i].x += luck;
+                t.control[i].x2 += luck * luck;
+                t.control[i].xy += luck * y;
+                t.score2[i] += y * y;
+            }
         }
-
+        ApplyControlVariate(t, 10);
+        _adjusted[0] = t.score[0];
+        _adjusted[1] = t.score[1];
+        return t.best_move;
     }
-    throw std::runtime_error("File not found!");
-}
-
-class BMAIActionTests :public ::testing::TestWithParam<std::tuple<std::string, std::string>> {
-protected:
-    TEST_Parser parser;
 };
 
 // I wanted to test the smaller objects and methods. 
@@ -86,3 +131,421 @@ TEST_P(BMAIActionTests, CheckSurrenderAction){
     // Then the move selected should match our expectations
     EXPECT_EQ(parser.tm_third_to_last_fmt+parser.tm_next_to_last_fmt+parser.tm_last_fmt, expected_last_actions);
 }
+
+TEST(BMAI3ParallelTests, ThreadsKeepBestAction){
+    // Given a position with a clear best move and simulations spread over 4 threads
+    std::ifstream in(resolvePath("test/Value1_in.txt"));
+    std::stringstream input;
+    input << "threads 4\n" << in.rdbuf();
+    TEST_Parser parser;
+
+    // When calculating the best move
+    parser.ParseString(input.str());
+    parser.ParseString("threads 1\n");
+
+    // Then the move selected should be the same as the serial search
+    EXPECT_EQ(parser.tm_third_to_last_fmt+parser.tm_next_to_last_fmt+parser.tm_last_fmt, "skill\n0 1\n1\n");
+}
+
+TEST(BMAI3ParallelTests, SeedGivesSameSearchForAnyThreadCount){
+    // Given a seeded position and a ply 2 search
+    // When searching once serially and once with 4 threads
+    auto result = TEST_Util::SearchTwice([](BMC_BMAI3 &, INT _search) {
+        g_pool.SetThreads(_search==0 ? 1 : 4);
+    });
+    g_pool.SetThreads(1);
+
+    // Then both searches pick the same move with the same estimate
+    EXPECT_EQ(result.probability[0], result.probability[1]);
+    EXPECT_TRUE(TEST_Util::SameAttack(result.move[0], result.move[1]));
+}
+
+TEST(BMAI3ParallelTests, ResizedPoolRunsEachJobOnce){
+    // Given a pool that has run a batch and is then resized
+    std::atomic<INT> runs(0);
+    g_pool.SetThreads(4);
+    g_pool.Run(8, [&](INT, INT) { runs++; });
+    g_pool.SetThreads(4);
+    // let the new workers reach their wait before the next batch
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // When running more batches
+    for (INT b=0; b<100; b++)
+        g_pool.Run(8, [&](INT, INT) { runs++; });
+    g_pool.SetThreads(1);
+
+    // Then every job ran exactly once
+    EXPECT_EQ(runs, 8 * 101);
+}
+
+TEST(BMAI3RacingTests, RacingStopsSoonerOnTheSameMove){
+    // Given a seeded position with two close attacks and a large sim budget
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:7 6:2", "12:9 10:5");
+    context.Game()->GetRNG().SRand(7);
+    BMC_Game game1(false), game2(false);
+    game1 = *context.Game();
+    game2 = *context.Game();
+    BMC_QAI qai;
+    TEST_BMAI3 ai(&qai);
+    ai.SetMaxSims(5000);
+    BMC_Move move1, move2;
+
+    // When searching with the fixed cull thresholds, then with racing
+    g_stats.ClearCounters();
+    ai.GetAttackAction(&game1, move1);
+    INT last1 = ai.GetLastSims(), sims1 = g_stats.GetSims();
+    ai.SetRacing(0.05f);
+    g_stats.ClearCounters();
+    ai.GetAttackAction(&game2, move2);
+    INT last2 = ai.GetLastSims(), sims2 = g_stats.GetSims();
+
+    // Then racing is down to one move sooner, after fewer sims in all, and it is the same move
+    EXPECT_LT(last2, last1);
+    EXPECT_LT(sims2, sims1);
+    EXPECT_EQ(move1.m_attack, move2.m_attack);
+    EXPECT_EQ(move1.m_attacker, move2.m_attacker);
+    EXPECT_EQ(move1.m_target, move2.m_target);
+}
+
+TEST(BMAI3TransTableTests, InnerPlyProbesTable){
+    // Given a seeded position, a ply 2 search and a transposition table
+    // When searching once without the table and once with it
+    auto result = TEST_Util::SearchTwice([](BMC_BMAI3 &, INT _search) {
+        if (_search==1)
+        {
+            g_stats.ClearCounters();
+            g_ttable.SetSize(1 << 16);
+        }
+    });
+    g_ttable.SetSize(0);
+
+    // Then inner plies reuse searched states and the same move is picked
+    EXPECT_GT(g_stats.GetTransTableHits(), 0);
+    EXPECT_TRUE(TEST_Util::SameAttack(result.move[0], result.move[1]));
+}
+
+TEST(BMAI3TransTableTests, SeedGivesSameSearchForAnyThreadCount){
+    // Given a seeded position, a ply 2 search and a transposition table
+    g_ttable.SetSize(1 << 16);
+
+    // When searching once serially and once with 4 threads sharing the table
+    auto result = TEST_Util::SearchTwice([](BMC_BMAI3 &, INT _search) {
+        g_pool.SetThreads(_search==0 ? 1 : 4);
+    });
+    g_pool.SetThreads(1);
+    g_ttable.SetSize(0);
+
+    // Then both searches pick the same move with the same estimate
+    EXPECT_EQ(result.probability[0], result.probability[1]);
+    EXPECT_TRUE(TEST_Util::SameAttack(result.move[0], result.move[1]));
+}
+
+TEST(BMAI3TransTableTests, NewSearchForgetsOldEntries){
+    // Given a table holding one searched state
+    g_ttable.SetSize(1 << 10);
+    g_ttable.Store(12345, 0.75f, 40);
+    float probability = 0;
+    INT sims = 0;
+    ASSERT_TRUE(g_ttable.Probe(12345, probability, sims));
+    EXPECT_FLOAT_EQ(probability, 0.75f);
+    EXPECT_EQ(sims, 40);
+
+    // When a new search starts
+    g_ttable.NewSearch();
+
+    // Then the state is not found until it is stored again
+    EXPECT_FALSE(g_ttable.Probe(12345, probability, sims));
+    g_ttable.Store(12345, 0.25f, 20);
+    EXPECT_TRUE(g_ttable.Probe(12345, probability, sims));
+    EXPECT_FLOAT_EQ(probability, 0.25f);
+    g_ttable.SetSize(0);
+}
+
+TEST(BMAI3TimeTests, TimeLimitReturnsBestSoFar){
+    // Given a ply 3 search that takes many seconds without a time limit
+    TEST_Util test;
+    auto context = test.ParseFightContext("8:8 7:7", "n20:15 v20:15 v20:8");
+    BMC_QAI qai;
+    BMC_BMAI3 ai(&qai);
+    ai.SetMaxPly(3);
+    ai.SetTimeLimit(100);
+    BMC_Move move;
+
+    // When searching with a 100 ms limit
+    auto start = std::chrono::steady_clock::now();
+    ai.GetAttackAction(context.Game(), move);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Then it stops close to the deadline with a valid move and estimate
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 1000);
+    EXPECT_EQ(move.m_action, BME_ACTION_ATTACK);
+    EXPECT_LE(ai.GetLastProbabilityWin(), 1);
+}
+
+TEST(BMAI3TimeTests, TimeLimitIsHardBound){
+    // Given a ply 2 search, and the number of deadline checks it makes when the deadline never passes
+    TEST_Util test;
+    auto context = test.ParseFightContext("10:4 12:7 20:11", "8:5 6:2 20:13");
+    auto same = test.ParseFightContext("10:4 12:7 20:11", "8:5 6:2 20:13");
+    BMC_QAI qai;
+    TEST_BMAI3 full(&qai), limited(&qai);
+    for (TEST_BMAI3 *ai : { &full, &limited })
+    {
+        ai->SetMaxPly(2);
+        ai->SetMaxSims(50);
+        ai->SetTimeLimit(3600 * 1000);
+    }
+    full.SetTimeoutCheck(INT_MAX);
+    BMC_Move move;
+    full.GetAttackAction(context.Game(), move);
+
+    // When the deadline passes in the middle of the last batch instead
+    limited.SetTimeoutCheck(full.checks - full.checks / 20);
+    limited.GetAttackAction(same.Game(), move);
+
+    // Then that batch is dropped rather than finished with QAI sims, and the batches before it are kept
+    EXPECT_LT(limited.GetLastSims(), full.GetLastSims());
+    EXPECT_GT(limited.GetLastSims(), 1);
+    EXPECT_EQ(move.m_action, BME_ACTION_ATTACK);
+    EXPECT_LE(limited.GetLastProbabilityWin(), 1);
+}
+
+TEST(BMAI3AutoPlyTests, BudgetPicksPly){
+    // Given a small fight and autoply up to ply 2
+    TEST_Util test;
+    auto context = test.ParseFightContext("10:4 12:7 20:11", "8:5 6:2 20:13");
+    BMC_QAI qai;
+    BMC_BMAI3 ai(&qai);
+    BMC_Move move;
+
+    // When the rollout budget is tiny
+    g_stats.ClearCounters();
+    ai.SetAutoPly(2, 10);
+    ai.GetAttackAction(context.Game(), move);
+
+    // Then it stays at ply 1
+    EXPECT_EQ(g_stats.GetAverageMoves(2), 0);
+
+    // When the budget fits a deeper search
+    g_stats.ClearCounters();
+    ai.SetAutoPly(2, 30000);
+    ai.GetAttackAction(context.Game(), move);
+
+    // Then it searches to ply 2, and restores the configured ply afterwards
+    EXPECT_GT(g_stats.GetAverageMoves(2), 0);
+    EXPECT_EQ(ai.GetMaxPly(), 1);
+}
+
+TEST(BMAI3CommonRandomTests, SameSimDrawsTheSameDice){
+    // Given two 6s that can each power attack the 3, so the two attacks play out the same on the same dice
+    TEST_Util test;
+    auto context = test.ParseFightContext("6:6 6:6 10:4", "20:3 12:8");
+    BMC_QAI qai;
+    TEST_BMAI3 ai(&qai);
+    INT crn, sims = 50;
+
+    for (crn=0; crn<2; crn++)
+    {
+        // When simulating every attack, with independent streams and then with common random numbers
+        BMC_Game game(false);
+        game = *context.Game();
+        game.GetRNG().SRand(7);
+        ai.SetCommonRandom(crn==1);
+        BMC_MoveList movelist;
+        auto results = ai.SimulateAttacks(&game, movelist, sims);
+
+        std::vector<INT> sixes;
+        for (INT i=0; i<movelist.Size(); i++)
+        {
+            BMC_Move *move = movelist.Get(i);
+            if (move->m_attack==BME_ATTACK_POWER && game.GetPhasePlayer()->GetDie(move->m_attacker)->GetSidesMax()==6)
+                sixes.push_back(i);
+        }
+        ASSERT_EQ(sixes.size(), 2u);
+
+        // Then the paired difference of the two 6s is noise without common random numbers, and gone with them
+        INT differ = 0;
+        for (INT s=0; s<sims; s++)
+            differ += results[sixes[0]][s] != results[sixes[1]][s];
+        if (crn)
+            EXPECT_EQ(differ, 0);
+        else
+            EXPECT_GT(differ, 0);
+    }
+}
+
+TEST(BMAI3QuasiRandomTests, QuasiRandomKeepsBestAction){
+    // Given a position with a clear best move and quasi-random rerolls
+    std::ifstream in(resolvePath("test/Value1_in.txt"));
+    std::stringstream input;
+    input << "qmc on\n" << in.rdbuf();
+    TEST_Parser parser;
+
+    // When calculating the best move
+    parser.ParseString(input.str());
+    parser.ParseString("qmc off\n");
+
+    // Then the move selected should be the same as with plain rolls
+    EXPECT_EQ(parser.tm_third_to_last_fmt+parser.tm_next_to_last_fmt+parser.tm_last_fmt, "skill\n0 1\n1\n");
+}
+
+TEST(BMAI3HistoryTests, CutoffsKeepSearchResult){
+    // Given a seeded position and a ply 2 search
+    // When searching without and then with the history heuristic
+    auto result = TEST_Util::SearchTwice([](BMC_BMAI3 &_ai, INT _search) {
+        if (_search==1)
+        {
+            _ai.SetHistory(true);
+            g_stats.ClearCounters();
+        }
+    });
+
+    // Then sims are skipped, but the search picks the same move with the same estimate
+    EXPECT_GT(g_stats.GetCutoffSims(), 0);
+    EXPECT_EQ(result.probability[0], result.probability[1]);
+    EXPECT_TRUE(TEST_Util::SameAttack(result.move[0], result.move[1]));
+}
+
+TEST(BMAI3PreCullTests, KeepsTheBestStaticAttack){
+    // Given a precull that keeps only the attack with the best static score
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:20 6:6", "20:7 4:3 8:2");
+    BMC_QAI qai;
+    BMC_BMAI3 ai(&qai);
+    ai.SetPreCull(1, 0, 0);
+    BMC_Move move;
+
+    // When searching
+    g_stats.ClearCounters();
+    ai.GetAttackAction(context.Game(), move);
+
+    // Then only one attack is simulated, the capture of the 20
+    EXPECT_EQ(g_stats.GetAverageMoves(1), 1);
+    EXPECT_EQ(context.Game()->GetPlayer(1)->GetDie(move.m_target)->GetSidesMax(), 20);
+}
+
+TEST(BMAI3ControlVariateTests, RerollLuckReducesVariance){
+    // Given a fight where the attackers' rerolls matter
+    TEST_Util test;
+    auto context = test.ParseFightContext("10:4 12:7 20:11", "8:5 6:2 20:13");
+    BMC_QAI qai;
+    BMC_BMAI3 ai(&qai);
+    ai.SetControlVariate(true);
+    BMC_Move move;
+
+    // When searching with the control variate
+    g_stats.ClearCounters();
+    ai.GetAttackAction(context.Game(), move);
+
+    // Then the reroll luck is correlated with the results, and the estimate is still a probability
+    EXPECT_GT(g_stats.GetControlVariateGain(), 1.0f);
+    EXPECT_GE(ai.GetLastProbabilityWin(), 0);
+    EXPECT_LE(ai.GetLastProbabilityWin(), 1);
+}
+
+TEST(BMAI3ControlVariateTests, AdjustedScoresReplaceTheLead){
+    // Given a decision where move 0 led an earlier batch
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:7 6:2", "12:9 10:5");
+    BMC_QAI qai;
+    TEST_BMAI3 ai(&qai);
+    ai.SetControlVariate(true);
+    BMC_MoveList movelist;
+    float adjusted[2];
+
+    // When the control variate adjusts the scores and move 1 is now ahead
+    BMC_Move *best = ai.ApplyControlVariateAfterLead(context.Game(), movelist, adjusted);
+
+    // Then the stale lead is cleared, so the decision loop picks the best move again from the current scores
+    EXPECT_GT(adjusted[1], adjusted[0]);
+    EXPECT_EQ(best, nullptr);
+}
+
+TEST(BMAI3EndgameTests, SolverMatchesSimulation){
+    // Given a fight with four dice in play, where the best attack is a skill attack on the 12
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:7 6:2", "12:9 10:5");
+    BMC_QAI qai;
+    BMC_BMAI3 sampled(&qai), solved(&qai);
+    sampled.SetMaxBranch(100000);
+    solved.SetEndgameDice(4);
+    BMC_Move sampled_move, solved_move;
+
+    // When one AI samples and the other solves the rest of the fight
+    sampled.GetAttackAction(context.Game(), sampled_move);
+    solved.GetAttackAction(context.Game(), solved_move);
+
+    // Then they agree on the attack, and the exact probability is within sampling error of the estimate
+    EXPECT_EQ(solved_move.m_attack, sampled_move.m_attack);
+    EXPECT_EQ(solved_move.m_target, sampled_move.m_target);
+    EXPECT_NEAR(solved.GetLastProbabilityWin(), sampled.GetLastProbabilityWin(), 0.05f);
+}
+
+TEST(BMAI3EndgameTests, Star2KeepsValuesAndCutsNodes){
+    // Given fights with their exact values and the nodes a Star1-only search needed to solve them
+    struct { const char *a, *b; float value; INT star1_nodes; } fights[] = {
+        { "20:7 6:2", "12:9 10:5", 0.779167f, 2707 },
+        { "10:7 8:2 4:4", "8:5 6:6", 0.910645f, 1744 },
+        { "6:6 6:1 4:3", "8:2 8:7 4:4", 0.694028f, 147597 },
+    };
+    for (auto &fight : fights)
+    {
+        TEST_Util test;
+        auto context = test.ParseFightContext(fight.a, fight.b);
+        BMC_Endgame endgame;
+        endgame.SetMaxDice(6);
+        BMC_Move move;
+        float value;
+
+        // When solving with Star2 probes at the chance nodes
+        ASSERT_TRUE(endgame.Solve(context.Game(), move, value));
+
+        // Then the value is unchanged, and fewer decision nodes are searched
+        EXPECT_NEAR(value, fight.value, 0.0001f) << fight.a << " vs " << fight.b;
+        EXPECT_LT(endgame.GetNodes(), fight.star1_nodes) << fight.a << " vs " << fight.b;
+    }
+}
+
+TEST(BMAI3SwingEquilibriumTests, MirrorMatchIsEven){
+    // Given both players with the same dice and an X swing die to set at the same time
+    TEST_Util test;
+    auto context = test.ParsePhaseContext("preround", "4 10 X", "4 10 X");
+    BMC_QAI qai;
+    BMC_BMAI3 ai(&qai);
+    ai.SetMaxPly(1);
+    ai.SetSwingEquilibrium(true);
+    BMC_Move move;
+
+    // When setting swing from the equilibrium of the matrix game
+    ai.GetSetSwingAction(context.Game(), move);
+
+    // Then the swing is in range, and the game value of a mirror match is close to even
+    EXPECT_EQ(move.m_action, BME_ACTION_SET_SWING_AND_OPTION);
+    EXPECT_GE(move.m_swing_value[BME_SWING_X], 4);
+    EXPECT_LE(move.m_swing_value[BME_SWING_X], 20);
+    EXPECT_NEAR(ai.GetLastProbabilityWin(), 0.5f, 0.1f);
+}
+
+TEST(BMAI3SwingEquilibriumTests, DeadlineStopsWithinASweep){
+    // Given a swing matrix game whose deadline passes after the 5th cell of the first sweep
+    TEST_Util test;
+    auto context = test.ParsePhaseContext("preround", "4 10 X", "4 10 X");
+    BMC_QAI qai;
+    TEST_BMAI3 ai(&qai);
+    ai.SetMaxPly(1);
+    ai.SetSwingEquilibrium(true);
+    ai.SetTimeoutCheck(5);
+    BMC_Move move;
+
+    // When setting swing from the equilibrium of the matrix game
+    ai.GetSetSwingAction(context.Game(), move);
+
+    // Then it stops at that cell rather than finishing the sweep, and still sets a swing with an estimate
+    EXPECT_EQ(ai.GetLastSims(), 5);
+    EXPECT_EQ(move.m_action, BME_ACTION_SET_SWING_AND_OPTION);
+    EXPECT_GE(move.m_swing_value[BME_SWING_X], 4);
+    EXPECT_LE(move.m_swing_value[BME_SWING_X], 20);
+    EXPECT_GE(ai.GetLastProbabilityWin(), 0);
+    EXPECT_LE(ai.GetLastProbabilityWin(), 1);
+}
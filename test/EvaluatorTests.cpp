@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+
+#include "_testutils.h"
+#include "../src/BMC_BMAI3.h"
+#include "../src/BMC_MLPEvaluator.h"
+#include "../src/BMC_QAI.h"
+#include <cstdio>
+#include <gtest/gtest.h>
+
+
+// a logistic regression on the difference of one player feature
+static std::string WriteWeights(INT _feature)
+{
+    std::string file = ::testing::TempDir() + "bmai_eval_test.txt";
+    FILE *fp = fopen(file.c_str(), "w");
+    fprintf(fp, "bmai_eval 1\n1 %d 1\n", BMC_MLPEvaluator::FEATURES);
+    for (INT i=0; i<BMC_MLPEvaluator::FEATURES; i++)
+    {
+        float w = 0;
+        if (i==3 + _feature)
+            w = 4;
+        else if (i==3 + BMC_MLPEvaluator::PLAYER_FEATURES + _feature)
+            w = -4;
+        fprintf(fp, "%g ", w);
+    }
+    fprintf(fp, "0\n");
+    fclose(fp);
+    return file;
+}
+
+TEST(EvaluatorTests, FavorsTheLargerDie){
+    // Given an evaluator that only weighs the sides of each player's largest die
+    std::string file = WriteWeights(3);
+    BMC_MLPEvaluator evaluator;
+    ASSERT_TRUE(evaluator.Load(file.c_str()));
+
+    // When evaluating a fight from both sides
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:7 6:2", "12:9 10:5");
+    float p0 = evaluator.Evaluate(context.Game(), 0);
+    float p1 = evaluator.Evaluate(context.Game(), 1);
+
+    // Then the player with the 20 is favored, and the estimates are complementary
+    EXPECT_GT(p0, 0.5f);
+    EXPECT_NEAR(p0 + p1, 1.0f, 0.001f);
+
+    std::remove(file.c_str());
+}
+
+TEST(EvaluatorTests, BMAI3UsesEvaluatorAtLeaves){
+    // Given BMAI v2 at ply 1 scoring leaves with an evaluator of the score difference only
+    std::string file = WriteWeights(0);
+    BMC_MLPEvaluator evaluator;
+    ASSERT_TRUE(evaluator.Load(file.c_str()));
+    BMC_QAI qai;
+    BMC_BMAI3 ai(&qai);
+    ai.SetMaxPly(1);
+    ai.SetEvaluator(&evaluator, 1);
+
+    // When it can capture either a 20 or a 4
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:20", "20:5 4:3");
+    BMC_Move move;
+    ai.GetAttackAction(context.Game(), move);
+
+    // Then it takes the 20, which gains the most score
+    EXPECT_EQ(move.m_action, BME_ACTION_ATTACK);
+    EXPECT_EQ(context.Game()->GetPlayer(1)->GetDie(move.m_target)->GetSidesMax(), 20);
+
+    std::remove(file.c_str());
+}
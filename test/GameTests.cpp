@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+
+#include "_testutils.h"
+#include "../src/BMC_QAI.h"
+#include <gtest/gtest.h>
+
+
+// records, for each round, the dice both players start with and who is asked to set swing
+class TEST_RoundAI : public BMC_QAI
+{
+public:
+    static const INT c_rounds = 16;
+
+    void GetSetSwingAction(BMC_Game *_game, BMC_Move &_move) override
+    {
+        asked[Round(_game)][_game->GetPhasePlayerID()] = true;
+        BMC_QAI::GetSetSwingAction(_game, _move);
+    }
+
+    void GetAttackAction(BMC_Game *_game, BMC_Move &_move) override
+    {
+        INT round = Round(_game);
+        if (round>=rounds)
+        {
+            rounds = round + 1;
+            for (INT p=0; p<BMD_MAX_PLAYERS; p++)
+            {
+                BMC_Player *player = _game->GetPlayer(p);
+                dice[round][p] = player->GetAvailableDice();
+                sides[round][p] = 0;
+                for (INT d=0; d<player->GetAvailableDice(); d++)
+                    sides[round][p] += player->GetDie(d)->GetSidesMax();
+                wins[round][p] = _game->GetStanding(p==0 ? BME_WLT_WIN : BME_WLT_LOSS);
+            }
+        }
+        BMC_QAI::GetAttackAction(_game, _move);
+    }
+
+    INT  rounds = 0;
+    bool asked[c_rounds][BMD_MAX_PLAYERS] = {};
+    INT  dice[c_rounds][BMD_MAX_PLAYERS] = {};
+    INT  sides[c_rounds][BMD_MAX_PLAYERS] = {};
+    INT  wins[c_rounds][BMD_MAX_PLAYERS] = {};
+
+private:
+    INT Round(BMC_Game *_game)
+    {
+        return _game->GetStanding(BME_WLT_WIN) + _game->GetStanding(BME_WLT_LOSS) + _game->GetStanding(BME_WLT_TIE);
+    }
+};
+
+TEST(GameTests, RoundsStartWithTheStartingDice){
+    // Given two swing buttons played by the same AI
+    TEST_Util test;
+    auto context = test.ParsePhaseContext("preround", "4 6 X", "6 8 Y");
+    TEST_RoundAI ai;
+    context.Game()->SetAI(0, &ai);
+    context.Game()->SetAI(1, &ai);
+
+    // When playing a full game
+    context.Game()->PlayGame();
+    ASSERT_GE(ai.rounds, 3);
+
+    // Then every round starts with all three dice, and the winner of a round keeps its swing
+    // while the loser sets it again
+    for (INT r=0; r<ai.rounds; r++)
+    {
+        EXPECT_EQ(ai.dice[r][0], 3) << "round " << r;
+        EXPECT_EQ(ai.dice[r][1], 3) << "round " << r;
+        if (r==0)
+            continue;
+        for (INT p=0; p<BMD_MAX_PLAYERS; p++)
+        {
+            bool won = ai.wins[r][p] > ai.wins[r-1][p];
+            bool lost = ai.wins[r][!p] > ai.wins[r-1][!p];
+            if (won)
+            {
+                EXPECT_FALSE(ai.asked[r][p]) << "round " << r << " player " << p;
+                EXPECT_EQ(ai.sides[r][p], ai.sides[r-1][p]) << "round " << r << " player " << p;
+            }
+            else if (lost)
+            {
+                EXPECT_TRUE(ai.asked[r][p]) << "round " << r << " player " << p;
+            }
+        }
+    }
+}
+
+TEST(ForkTests, ForkedAttackPlaysAsTheFullAttack) {
+    // Given a fight with dice that change size when they attack
+    TEST_Util test;
+    auto context = test.ParseFightContext("B20:13 z12:7 H8:6", "20:17 h10:3 t6:4");
+    BMC_Game *game = context.Game();
+
+    for (BMC_Move move : context.ValidAttacks())
+    {
+        // When the attack's deterministic step is applied to a fork first, and both games then roll the same dice
+        BMC_Game full(true), fork(true);
+        full = *game;
+        fork = *game;
+        full.SetSimulation(true);
+        fork.SetSimulation(true);
+        BMC_Move fork_move = move;
+        fork.ApplyAttackPlayer(fork_move);
+        full.GetRNG().SetStream(1);
+        fork.GetRNG().SetStream(1);
+        full.ApplyFightAction(move);
+        fork.ApplyFightAction(fork_move, true);
+
+        // Then the games are the same
+        EXPECT_EQ(fork.GetStateHash(), full.GetStateHash());
+        EXPECT_EQ(fork.GetPlayer(0)->GetScore(), full.GetPlayer(0)->GetScore());
+    }
+}
+
+TEST(DieTests, DiceShareAttackTypes) {
+    // Given a fight with shadow, queer, berserk and plain dice
+    TEST_Util test;
+    auto context = test.ParseFightContext("s12:3 q9:3 q9:4 B8:4", "20:7 20:12 6:2");
+
+    // Then each die has the attacks of its properties and value
+    for (INT p=0; p<BMD_MAX_PLAYERS; p++)
+    {
+        BMC_Player *player = context.Game()->GetPlayer(p);
+        for (INT d=0; d<player->GetAvailableDice(); d++)
+        {
+            BMC_Die *die = player->GetDie(d);
+            bool shadow = die->HasProperty(BME_PROPERTY_SHADOW)
+                || (die->HasProperty(BME_PROPERTY_QUEER) && die->GetValueTotal() % 2 == 1);
+            EXPECT_EQ(die->CanDoAttack(BME_ATTACK_SHADOW), shadow);
+            EXPECT_EQ(die->CanDoAttack(BME_ATTACK_POWER), !shadow);
+            EXPECT_EQ(die->CanDoAttack(BME_ATTACK_BERSERK), die->HasProperty(BME_PROPERTY_BERSERK));
+            EXPECT_EQ(die->CanDoAttack(BME_ATTACK_SKILL), !die->HasProperty(BME_PROPERTY_BERSERK));
+            EXPECT_TRUE(die->CanBeAttacked(BME_ATTACK_POWER));
+        }
+    }
+
+    // And the 2048 combinations of the properties and state that decide attacks share under 128 types
+    EXPECT_LT(BMC_Die::GetAttackTypeCount(), 128);
+}
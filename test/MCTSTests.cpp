@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+
+#include "_testutils.h"
+#include "../src/BMC_MCTS.h"
+#include "../src/BMC_QAI.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <regex>
+#include <gtest/gtest.h>
+
+
+// exposes the tree of MCTS
+class TEST_MCTS : public BMC_MCTS {
+public:
+    TEST_MCTS(BMC_AI *_ai) : BMC_MCTS(_ai) {}
+
+    // the most searched position after the chosen move, its most visited outcome, and the opponent's most visited
+    // attack (a pass is not matched by reuse).  Sets _state to it.
+    // RETURNS: the visits of that node, or 0 if the tree does not reach it
+    INT GetLikelyReply(BMC_Game &_state)
+    {
+        INT n = 0;
+        for (INT ply=0; ply<2; ply++)
+        {
+            BMC_Node &node = m_nodes[n];
+            INT best = -1;
+            for (INT e=0; e<node.widened; e++)
+            {
+                BMC_Edge &edge = node.edges[e];
+                if (edge.outcome_node.empty() || (ply==1 && edge.move.m_action!=BME_ACTION_ATTACK))
+                    continue;
+                if (best<0 || edge.visits > node.edges[best].visits)
+                    best = e;
+            }
+            if (best<0)
+                return 0;
+
+            BMC_Edge &edge = node.edges[best];
+            INT o = (INT)(std::max_element(edge.outcome_visits.begin(), edge.outcome_visits.end()) - edge.outcome_visits.begin());
+            n = edge.outcome_node[o];
+            if (m_nodes[n].terminal)
+                return 0;
+        }
+
+        _state = m_nodes[n].state;
+        _state.SetSimulation(false);
+        return m_nodes[n].visits;
+    }
+};
+
+class MCTSActionTests :public ::testing::TestWithParam<std::tuple<std::string, std::string>> {
+protected:
+    TEST_Parser parser;
+};
+
+// the positions BMAI3 is checked against, with the acting player switched to MCTS
+INSTANTIATE_TEST_SUITE_P(
+        MCTSTests,
+        MCTSActionTests,
+        ::testing::Values(
+            std::make_tuple("test/SurrenderOff-Attack-in.txt", "power\n0\n0\n"),
+            std::make_tuple("test/SurrenderOn-Pass-in.txt", "action\nsurrender\n"),
+
+            std::make_tuple("test/Insult_in.txt", "power\n0\n1\n"),
+            std::make_tuple("test/Value1_in.txt", "skill\n0 1\n1\n"),
+            std::make_tuple("test/Value2_in.txt", "power\n1\n0\n"),
+
+            std::make_tuple("test/bug55_a_in.txt", "skill\n2 0\n0\n"),
+            std::make_tuple("test/bug55_b_in.txt", "skill\n3 0 1\n2\n")
+        ));
+
+TEST_P(MCTSActionTests, MatchesBMAI3Action){
+    // Given a test position where player 0 uses MCTS
+    std::ifstream in(resolvePath(std::get<0>(GetParam())));
+    std::stringstream file;
+    file << in.rdbuf();
+    std::string input = std::regex_replace(file.str(), std::regex("getaction"), "ai 0 3\ngetaction");
+
+    // When calculating the best move
+    parser.ParseString(input);
+
+    // Then the move selected should be the one BMAI3 selects
+    EXPECT_EQ(parser.tm_third_to_last_fmt+parser.tm_next_to_last_fmt+parser.tm_last_fmt, std::get<1>(GetParam()));
+}
+
+TEST(MCTSTests, ReusesAndPondersTheTree){
+    // Given MCTS keeping its tree and pondering 100 iterations after each decision
+    BMC_QAI qai;
+    BMC_MCTS mcts(&qai);
+    mcts.SetIterations(200);
+    mcts.SetReuse(true);
+    mcts.SetPonder(100);
+
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:20 6:3", "20:5 4:3 8:8");
+    BMC_Move move;
+    mcts.GetAttackAction(context.Game(), move);
+    EXPECT_EQ(mcts.GetReusedVisits(), 0);
+    while (mcts.IsPondering())
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // When the same position arrives again
+    mcts.GetAttackAction(context.Game(), move);
+
+    // Then the search resumes from the whole tree, including the pondered iterations
+    EXPECT_EQ(mcts.GetReusedVisits(), 300);
+    mcts.StopPonder();
+}
+
+TEST(MCTSTests, ReusesTheSubtreeAfterTheOpponentsReply){
+    // Given MCTS keeping its tree and pondering 300 iterations on the chosen move
+    BMC_QAI qai;
+    TEST_MCTS mcts(&qai);
+    mcts.SetIterations(500);
+    mcts.SetReuse(true);
+    mcts.SetPonder(300);
+
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:20 6:3", "20:5 4:3 8:8");
+    BMC_Move move;
+    mcts.GetAttackAction(context.Game(), move);
+    while (mcts.IsPondering())
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // When the opponent's most searched reply to the chosen move arrives
+    BMC_Game reply(false);
+    INT visits = mcts.GetLikelyReply(reply);
+    ASSERT_GT(visits, 0);
+    mcts.GetAttackAction(&reply, move);
+
+    // Then the search resumes from that subtree, with the visits it had after pondering
+    EXPECT_EQ(mcts.GetReusedVisits(), visits);
+    mcts.StopPonder();
+}
+
+TEST(MCTSTests, NoIterationsFallsBackToQAI){
+    // Given MCTS with no iterations to run
+    BMC_QAI qai;
+    BMC_MCTS mcts(&qai);
+    mcts.SetIterations(0);
+
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:20 6:3", "20:5 4:3 8:8");
+    BMC_Move move, qai_move;
+
+    // When asked for an attack
+    mcts.GetAttackAction(context.Game(), move);
+    qai.GetAttackAction(context.Game(), qai_move);
+
+    // Then it plays the QAI move
+    EXPECT_TRUE(TEST_Util::SameAttack(move, qai_move));
+}
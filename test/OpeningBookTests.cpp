@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+
+#include "_testutils.h"
+#include "../src/BMC_BMAI3.h"
+#include "../src/BMC_OpeningBook.h"
+#include "../src/BMC_QAI.h"
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+
+
+TEST(OpeningBookTests, AnswersTheSameMatchup){
+    // Given a book with an X swing choice for one matchup
+    std::string file = ::testing::TempDir() + "bmai_book_test.bin";
+    std::remove(file.c_str());
+    TEST_Util test;
+    auto context = test.ParsePhaseContext("preround", "4 10 X", "6 8");
+    BMC_Move move;
+    move.m_action = BME_ACTION_SET_SWING_AND_OPTION;
+    std::memset(move.m_swing_value, 0, sizeof(move.m_swing_value));
+    move.m_swing_value[BME_SWING_X] = 13;
+    move.m_option_die.Clear();
+    ASSERT_TRUE(BMC_OpeningBook::Add(file.c_str(), context.Game(), move, 0.6f));
+    BMC_OpeningBook book;
+    ASSERT_TRUE(book.Load(file.c_str()));
+
+    // When BMAI v2 sets swing for the same dice listed in another order
+    TEST_Util test2;
+    auto context2 = test2.ParsePhaseContext("preround", "X 10 4", "8 6");
+    BMC_QAI qai;
+    BMC_BMAI3 ai(&qai);
+    ai.SetOpeningBook(&book);
+    BMC_Move answer;
+    ai.GetSetSwingAction(context2.Game(), answer);
+
+    // Then it plays the book move
+    EXPECT_EQ(answer.m_swing_value[BME_SWING_X], 13);
+    EXPECT_FLOAT_EQ(ai.GetLastProbabilityWin(), 0.6f);
+
+    // and a different matchup is not in the book
+    TEST_Util test3;
+    auto context3 = test3.ParsePhaseContext("preround", "4 10 X", "6 12");
+    float probability;
+    EXPECT_FALSE(book.Probe(context3.Game(), answer, probability));
+
+    book.Unload();
+    std::remove(file.c_str());
+}
+
+TEST(OpeningBookTests, OptionDiceDifferInTheirSecondSize){
+    // Given a book with an answer for a matchup with a 4/8 option die
+    std::string file = ::testing::TempDir() + "bmai_book_option_test.bin";
+    std::remove(file.c_str());
+    TEST_Util test;
+    auto context = test.ParsePhaseContext("preround", "4/8 10", "6 8");
+    BMC_Move move;
+    move.m_action = BME_ACTION_SET_SWING_AND_OPTION;
+    std::memset(move.m_swing_value, 0, sizeof(move.m_swing_value));
+    move.m_option_die.Clear();
+    move.m_option_die.Set(0);
+    ASSERT_TRUE(BMC_OpeningBook::Add(file.c_str(), context.Game(), move, 0.6f));
+    BMC_OpeningBook book;
+    ASSERT_TRUE(book.Load(file.c_str()));
+    BMC_Move answer;
+    float probability;
+    ASSERT_TRUE(book.Probe(context.Game(), answer, probability));
+
+    // When the option die only differs in its second size
+    TEST_Util test2;
+    auto context2 = test2.ParsePhaseContext("preround", "4/12 10", "6 8");
+
+    // Then it is not in the book
+    EXPECT_FALSE(book.Probe(context2.Game(), answer, probability));
+
+    book.Unload();
+    std::remove(file.c_str());
+}
+
+TEST(OpeningBookTests, StaleVersionIsRejected){
+    // Given a book file written before OPTION dice were keyed by both sizes (version 1)
+    std::string file = ::testing::TempDir() + "bmai_book_stale_test.bin";
+    struct { char magic[4]; UINT version; U64 entries; } header = { { 'B', 'M', 'O', 'B' }, 1, 0 };
+    FILE *fp = fopen(file.c_str(), "wb");
+    ASSERT_NE(fp, nullptr);
+    fwrite(&header, sizeof(header), 1, fp);
+    fclose(fp);
+
+    // When loading it
+    BMC_OpeningBook book;
+
+    // Then it is not used
+    EXPECT_FALSE(book.Load(file.c_str()));
+    EXPECT_FALSE(book.IsLoaded());
+
+    std::remove(file.c_str());
+}
@@ -3,6 +3,7 @@
 // SPDX-FileComment: https://github.com/pappde/bmai
 
 #include "../src/BMC_Parser.h"
+#include "../src/BMC_ThreadPool.h"
 #include <gtest/gtest.h>
 
 TEST(ParserTests, ParseString) {
@@ -38,3 +39,30 @@ getaction
     });
 
 }
+
+TEST(ParserTests, BenchThreadsReportsSpeedup) {
+    // Given a parser with a fight
+    BMC_Parser parser;
+    const char * input = R"IN(
+game
+fight
+player 0 2 0
+8:8
+7:7
+player 1 2 0
+10:6
+6:3
+benchthreads 2
+)IN";
+
+    // When benchmarking 2 threads against 1
+    testing::internal::CaptureStdout();
+    parser.ParseString(input);
+    std::string output = testing::internal::GetCapturedStdout();
+
+    // Then both searches are timed and the speedup is reported, with the thread count restored
+    EXPECT_NE(output.find("threads 1:"), std::string::npos);
+    EXPECT_NE(output.find("threads 2:"), std::string::npos);
+    EXPECT_NE(output.find("speedup"), std::string::npos);
+    EXPECT_EQ(g_pool.GetThreads(), 1);
+}
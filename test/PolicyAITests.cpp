@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+
+#include "_testutils.h"
+#include "../src/BMC_PolicyAI.h"
+#include <cstdio>
+#include <gtest/gtest.h>
+
+
+TEST(PolicyAITests, TakesTheLargestCapture){
+    // Given the default weights
+    BMC_PolicyAI policy;
+
+    // When it can power attack either a 20 or a 4
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:20", "20:5 4:3");
+    BMC_Move move;
+    policy.GetAttackAction(context.Game(), move);
+
+    // Then it takes the 20
+    EXPECT_EQ(move.m_action, BME_ACTION_ATTACK);
+    EXPECT_EQ(context.Game()->GetPlayer(1)->GetDie(move.m_target)->GetSidesMax(), 20);
+}
+
+TEST(PolicyAITests, LoadsWeights){
+    // Given weights that avoid captures
+    std::string file = ::testing::TempDir() + "bmai_policy_test.txt";
+    FILE *fp = fopen(file.c_str(), "w");
+    fprintf(fp, "bmai_policy 1\n");
+    for (INT a=0; a<BME_ATTACK_MAX; a++)
+        fprintf(fp, "-10 0 0 0\n");
+    fclose(fp);
+    BMC_PolicyAI policy;
+    ASSERT_TRUE(policy.Load(file.c_str()));
+
+    // When it can power attack either a 20 or a 4
+    TEST_Util test;
+    auto context = test.ParseFightContext("20:20", "20:5 4:3");
+    BMC_Move move;
+    policy.GetAttackAction(context.Game(), move);
+
+    // Then it takes the 4
+    EXPECT_FLOAT_EQ(policy.GetWeight(BME_ATTACK_POWER, BMC_PolicyAI::FEATURE_CAPTURE), -10);
+    EXPECT_EQ(context.Game()->GetPlayer(1)->GetDie(move.m_target)->GetSidesMax(), 4);
+
+    std::remove(file.c_str());
+}
+
+TEST(PolicyAITests, CountsTwinRerollsAsQAIDoes){
+    // Given a twin attacker showing 2
+    TEST_Util test;
+    auto context = test.ParseFightContext("(4,4):2", "10:2");
+    auto attacks = context.ValidAttacks();
+    ASSERT_FALSE(attacks.empty());
+    ASSERT_EQ(attacks[0].m_action, BME_ACTION_ATTACK);
+
+    // When scoring its attack
+    float features[BMC_PolicyAI::FEATURE_MAX];
+    BMC_PolicyAI::GetFeatures(context.Game(), attacks[0], features);
+
+    // Then the reroll gain is (max + 1)/2 - value, the same as QAI
+    EXPECT_FLOAT_EQ(features[BMC_PolicyAI::FEATURE_REROLL], 2.5f);
+}
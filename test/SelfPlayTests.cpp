@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+
+#include "_testutils.h"
+#include "../src/BMC_BMAI3.h"
+#include "../src/BMC_QAI.h"
+#include "../src/BMC_SelfPlay.h"
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+
+
+TEST(SelfPlayTests, WritesEveryDecision){
+    // Given a short matchup
+    std::string file = ::testing::TempDir() + "bmai_selfplay_test.bin";
+    TEST_Util test;
+    auto context = test.ParsePhaseContext("preround", "4 6 X", "6 8");
+    BMC_QAI qai;
+    BMC_BMAI3 ai(&qai);
+    ai.SetMaxPly(1);
+    ai.SetMaxSims(10);
+
+    // When playing two games
+    BMC_SelfPlay selfplay;
+    INT records = selfplay.Run(context.Game(), &ai, 2, file.c_str());
+    ASSERT_GT(records, 0);
+
+    // Then the file holds the header and every record, with legal move counts and results filled in
+    FILE *fp = fopen(file.c_str(), "rb");
+    ASSERT_TRUE(fp != NULL);
+    BMC_SelfPlay::Header header;
+    ASSERT_EQ(fread(&header, sizeof(header), 1, fp), 1u);
+    EXPECT_EQ(std::memcmp(header.magic, "BMSP", 4), 0);
+    EXPECT_EQ(header.record_size, sizeof(BMC_SelfPlay::Record));
+
+    BMC_SelfPlay::Record record;
+    INT read = 0, swings = 0;
+    while (fread(&record, sizeof(record), 1, fp)==1)
+    {
+        read++;
+        EXPECT_LT(record.game, 2u);
+        EXPECT_GE(record.moves, 1);
+        EXPECT_LT(record.round_result, BME_WLT_MAX);
+        if (record.move.action==BME_ACTION_SET_SWING_AND_OPTION)
+            swings += record.player==0 && record.move.swing_value[BME_SWING_X]>=4;
+    }
+    fclose(fp);
+    EXPECT_EQ(read, records);
+    EXPECT_GT(swings, 0);
+
+    std::remove(file.c_str());
+}
@@ -26,7 +26,7 @@ BMC_Die *FindDieByOriginalIndex(BMC_Player *player, int original_index) {
 TEST(SkillTests, NoSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("9:8","7:6");
 	});
@@ -116,7 +116,7 @@ TEST(SkillTests, StealthMultiDieSkillAttack) {
 TEST(SkillTests, MaximumSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("M9:8","M7:6");
 	});
@@ -130,11 +130,12 @@ TEST(SkillTests, MaximumSkill) {
 	// test other behavior
     // Arrange: Given a 6 sided Maximum die
     BMC_Die die = TEST_Util::createTestDie(6, BME_PROPERTY_MAXIMUM);
+    BMC_RNG rng;
 
     for (int i = 0; i < 10; ++i) {
         // Act: When the die is rolled 10 times
         die.SetState(BME_STATE_NOTSET);
-        die.Roll();
+        die.Roll(rng);
 
         // Assert: Then it always has the max value
         EXPECT_EQ(die.GetValueTotal(), 6);
@@ -143,6 +144,7 @@ TEST(SkillTests, MaximumSkill) {
 
 TEST(SkillTests, RollRequiresNotSetState) {
     BMC_Die die = TEST_Util::createTestDie(6, BME_PROPERTY_VALID);
+    BMC_RNG rng;
 
     // This invariant is enforced only in debug builds, where assert() is active.
 #ifdef NDEBUG
@@ -150,7 +152,7 @@ TEST(SkillTests, RollRequiresNotSetState) {
 #else
     EXPECT_DEATH(
         {
-            die.Roll();
+            die.Roll(rng);
         },
         "");
 #endif
@@ -181,7 +183,7 @@ TEST(SkillTests, KonstantRetainsValueWhenTripped) {
 	));
 
 	// Fix the RNG seed so a broken reroll path cannot randomly land back on 7 and mask the bug.
-	g_rng.SRand(1);
+	context.Game()->GetRNG().SRand(1);
 
 	bool extra_turn = false;
 	context.Game()->SimulateAttack(valid_attacks.front(), extra_turn);
@@ -203,7 +205,7 @@ TEST(SkillTests, KonstantRetainsValueWhenChanceRerolls) {
 	ASSERT_NE(chance_it, valid_chance.end());
 
 	// Fix the RNG seed so a broken reroll path cannot randomly land back on 7 and mask the bug.
-	g_rng.SRand(1);
+	context.Game()->GetRNG().SRand(1);
 
 	context.Game()->ApplyUseChance(*chance_it);
 
@@ -227,7 +229,7 @@ TEST(SkillTests, KonstantAttackerRetainsValueAfterSkillAttack) {
 	int original_index = konstant_die->GetOriginalIndex();
 	ASSERT_EQ(konstant_die->GetValueTotal(), 13);
 
-	g_rng.SRand(1);
+	context.Game()->GetRNG().SRand(1);
 
 	bool extra_turn = false;
 	context.Game()->SimulateAttack(valid_attacks.front(), extra_turn);
@@ -255,7 +257,7 @@ TEST(SkillTests, KonstantWarriorRetainsValueWhenUsedInSkillAttack) {
 	ASSERT_EQ(warrior_die->GetValueTotal(), 17);
 	ASSERT_TRUE(warrior_die->HasProperty(BME_PROPERTY_WARRIOR));
 
-	g_rng.SRand(1);
+	context.Game()->GetRNG().SRand(1);
 
 	bool extra_turn = false;
 	context.Game()->SimulateAttack(valid_attacks.front(), extra_turn);
@@ -271,7 +273,7 @@ TEST(SkillTests, KonstantWarriorRetainsValueWhenUsedInSkillAttack) {
 TEST(SkillTests, InsultSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("I9:8","I7:6");
 	});
@@ -294,7 +296,7 @@ TEST(SkillTests, InsultSkill) {
 TEST(SkillTests, NullSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("n9:8","n7:6");
 	});
@@ -314,7 +316,7 @@ TEST(SkillTests, NullSkill) {
 TEST(SkillTests, ValueSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("v9:8","v7:6");
 	});
@@ -333,7 +335,7 @@ TEST(SkillTests, ValueSkill) {
 TEST(SkillTests, NullValueSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("nv9:8","nv7:6");
 	});
@@ -375,7 +377,7 @@ TEST(SkillTests, SpeedSkill) {
 TEST(SkillTests, MorphingSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("m9:8","m7:6");
 	});
@@ -402,7 +404,7 @@ TEST(SkillTests, MorphingSkill) {
 TEST(SkillTests, MorphingTwinSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("m(5,5):8","m7:6");
 	});
@@ -467,7 +469,7 @@ TEST(SkillTests, MorphingSpeedSkill) {
 TEST(SkillTests, PoisonSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("p9:8","p7:6");
 	});
@@ -486,7 +488,7 @@ TEST(SkillTests, PoisonSkill) {
 TEST(SkillTests, PoisonValueSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("pv9:8","pv7:6");
 	});
@@ -505,7 +507,7 @@ TEST(SkillTests, PoisonValueSkill) {
 TEST(SkillTests, PoisonNullSkill) {
 	TEST_Util test;
 
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("pn9:8","pn7:6");
 	});
@@ -528,7 +530,7 @@ TEST(SkillTests, StealthTrip) {
 	EXPECT_FALSE(dice.CanDoAttack(BME_ATTACK_POWER));
 
 	TEST_Util test;
-	BMC_Move _move;
+	TEST_Move _move;
 	EXPECT_NO_THROW({
 		_move = test.ParseFightGetAttack("dt10:8","20:9");
 	});
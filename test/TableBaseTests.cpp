@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright © 2026 Denis Papp <denis@accessdenied.net>
+// SPDX-FileComment: https://github.com/pappde/bmai
+
+#include "_testutils.h"
+#include "../src/BMC_Endgame.h"
+#include "../src/BMC_TableBase.h"
+#include <cstdio>
+#include <gtest/gtest.h>
+
+
+TEST(TableBaseTests, MatchesEndgameSolver){
+    // Given a tablebase of 2, 4 and 6 sided dice
+    std::string file = ::testing::TempDir() + "bmai_tablebase_test.bin";
+    BMC_TableBase tablebase;
+    ASSERT_TRUE(tablebase.Generate({ 2, 4, 6 }, file.c_str()));
+    ASSERT_TRUE(tablebase.Load(file.c_str()));
+    BMC_Endgame endgame;
+    endgame.SetMaxDice(4);
+
+    const char *fights[][2] = {
+        { "6:3 4:2", "6:5 2:1" },
+        { "4:4", "6:2 6:6" },
+        { "2:1 6:6", "4:3" },
+        { "2:2 4:1", "6:4 6:3" },
+    };
+    for (auto &fight : fights)
+    {
+        TEST_Util test;
+        auto context = test.ParseFightContext(fight[0], fight[1]);
+
+        // When probing a fight the endgame solver can also solve
+        float value, solved;
+        BMC_Move move;
+        ASSERT_TRUE(tablebase.Probe(context.Game(), value));
+        ASSERT_TRUE(endgame.Solve(context.Game(), move, solved));
+
+        // Then both have the same exact value
+        EXPECT_NEAR(value, solved, 0.001f) << fight[0] << " vs " << fight[1];
+    }
+
+    // and dice that are not in the table are not found
+    TEST_Util test;
+    auto context = test.ParseFightContext("8:3 4:2", "6:5");
+    float value;
+    EXPECT_FALSE(tablebase.Probe(context.Game(), value));
+
+    tablebase.Unload();
+    std::remove(file.c_str());
+}
+
+TEST(TableBaseTests, SeparatesTies){
+    // Given a tablebase of 2, 4 and 6 sided dice
+    std::string file = ::testing::TempDir() + "bmai_tablebase_tie_test.bin";
+    BMC_TableBase tablebase;
+    ASSERT_TRUE(tablebase.Generate({ 2, 4, 6 }, file.c_str()));
+    ASSERT_TRUE(tablebase.Load(file.c_str()));
+
+    // When probing a fight where the capture is always captured back for an even score
+    TEST_Util test;
+    auto context = test.ParseFightContext("2:1", "2:1 4:3");
+    float win, tie, value;
+    ASSERT_TRUE(tablebase.Probe(context.Game(), win, tie));
+    ASSERT_TRUE(tablebase.Probe(context.Game(), value));
+
+    // Then it is a certain tie, not a half chance of winning
+    EXPECT_NEAR(win, 0, 0.001f);
+    EXPECT_NEAR(tie, 1, 0.001f);
+    EXPECT_NEAR(value, win + tie / 2, 0.001f);
+
+    tablebase.Unload();
+    std::remove(file.c_str());
+}
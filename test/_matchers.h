@@ -22,6 +22,15 @@ inline std::string str(const std::vector<int>& vec) {
 	return oss.str();
 }
 
+// moves do not hold the game they are for, so tests keep it with the move to look up the dice
+struct TEST_Move : public BMC_Move
+{
+	TEST_Move() {}
+	TEST_Move(const BMC_Move &_move, BMC_Game *_game) : BMC_Move(_move), m_game(_game) {}
+
+	BMC_Game *m_game = nullptr;
+};
+
 class ActionMatcher
 {
 public:
@@ -29,7 +38,7 @@ public:
 
 	ActionMatcher(BME_ACTION action) : action_(action) {}
 
-	bool MatchAndExplain(const BMC_Move& _move,
+	bool MatchAndExplain(const TEST_Move& _move,
 		::testing::MatchResultListener* listener) const
 	{
 		*listener << "move.action==" << c_action_name[_move.m_action];
@@ -57,7 +66,7 @@ public:
 	AttackMatcher(BME_ATTACK_TYPE type, const std::string& name, std::vector<int> atk_idxs, std::vector<int> tgt_idxs)
 		: type_(type), name_(name), atk_idxs_(atk_idxs), tgt_idxs_(tgt_idxs) {}
 
-	bool MatchAndExplain(const BMC_Move& _move,
+	bool MatchAndExplain(const TEST_Move& _move,
 						 ::testing::MatchResultListener* listener) const
 	{
 
@@ -114,25 +123,25 @@ private:
 	std::vector<int> tgt_idxs_;
 };
 
-inline ::testing::Matcher<const BMC_Move&> IsAttack(BME_ATTACK_TYPE type, const std::string& name, std::initializer_list<int> atk_idx, std::initializer_list<int> tgt_idx)
+inline ::testing::Matcher<const TEST_Move&> IsAttack(BME_ATTACK_TYPE type, const std::string& name, std::initializer_list<int> atk_idx, std::initializer_list<int> tgt_idx)
 {
 	return AttackMatcher(type, name, atk_idx, tgt_idx);
 }
 
-inline ::testing::Matcher<const BMC_Move&> IsAttack(BME_ATTACK_TYPE type, const std::string& name, int atk_idx, int tgt_idx)
+inline ::testing::Matcher<const TEST_Move&> IsAttack(BME_ATTACK_TYPE type, const std::string& name, int atk_idx, int tgt_idx)
 {
 	return IsAttack(type, name, {atk_idx}, {tgt_idx});
 }
-inline ::testing::Matcher<const BMC_Move&> IsAttack(BME_ATTACK_TYPE type, const std::string& name, int atk_idx, std::initializer_list<int> tgt_idx)
+inline ::testing::Matcher<const TEST_Move&> IsAttack(BME_ATTACK_TYPE type, const std::string& name, int atk_idx, std::initializer_list<int> tgt_idx)
 {
 	return IsAttack(type, name, {atk_idx}, tgt_idx);
 }
-inline ::testing::Matcher<const BMC_Move&> IsAttack(BME_ATTACK_TYPE type, const std::string& name, std::initializer_list<int> atk_idx, int tgt_idx)
+inline ::testing::Matcher<const TEST_Move&> IsAttack(BME_ATTACK_TYPE type, const std::string& name, std::initializer_list<int> atk_idx, int tgt_idx)
 {
 	return IsAttack(type, name, atk_idx, {tgt_idx});
 }
 
-inline ::testing::Matcher<const BMC_Move&> IsAction(BME_ACTION action)
+inline ::testing::Matcher<const TEST_Move&> IsAction(BME_ACTION action)
 {
 	return ActionMatcher(action);
 }
@@ -6,26 +6,50 @@
 
 #include <cstdarg>
 #include <cstdio>
+#include <filesystem>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 
+#include "../src/BMC_BMAI3.h"
 #include "../src/BMC_Die.h"
 #include "../src/BMC_Game.h"
 #include "../src/BMC_Parser.h"
+#include "../src/BMC_QAI.h"
+#include "./_matchers.h"
 
 
+// find a repo-relative file (e.g. "test/Value1_in.txt") from the current directory or any parent
+inline std::string resolvePath(const std::string &relPath)
+{
+    auto baseDir = std::filesystem::current_path();
+    while (baseDir.has_parent_path())
+    {
+        auto combinePath = baseDir / relPath;
+        if (exists(combinePath))
+        {
+            return combinePath.string();
+        }
+        if(baseDir==baseDir.parent_path()) {
+            break;
+        } else {
+            baseDir = baseDir.parent_path();
+        }
+
+    }
+    throw std::runtime_error("File not found!");
+}
+
 // until the objects are better suited for testing
 // it may be necessary to use a couple hacks to access members
 // http://www.gotw.ca/gotw/076.htm
 class TEST_DieData : public BMC_DieData
 {
 public:
-    void setProperties(U64 properties) { m_properties = properties; }
+    void setProperties(U64 properties) { SetProperties(properties); }
     void setSides(U8 sides) { m_sides[0] = sides; }
-    void setSwingType(U8 swing_type) { m_swing_type[0] = swing_type; }
-
-protected:
-    U8 m_swing_type[BMD_MAX_TWINS];
+    void setSwingType(U8 swing_type) { SetSwingType(0, (BME_SWING)swing_type); }
 };
 
 class TEST_Game : public BMC_Game
@@ -61,10 +85,10 @@ public:
 		}
 	}
 
-	BMC_Move last_attack;
+	TEST_Move last_attack;
 	void SendAttack(BMC_Move &_move) override
 	{
-		last_attack = _move;
+		last_attack = TEST_Move(_move, Game());
 		BMC_Parser::SendAttack(_move);
 	}
 
@@ -77,32 +101,32 @@ public:
 	{
 		std::unique_ptr<TEST_Parser> parser;
 		BMC_Game *game = nullptr;
-		BMC_Move chosen_move;
+		TEST_Move chosen_move;
 
 		BMC_Game* Game() const
 		{
 			return game;
 		}
 
-		std::vector<BMC_Move> ValidAttacks() const
+		std::vector<TEST_Move> ValidAttacks() const
 		{
 			BMC_MoveList movelist;
 			Game()->GenerateValidAttacks(movelist);
 
-			std::vector<BMC_Move> moves;
+			std::vector<TEST_Move> moves;
 			for (int i = 0; i < movelist.Size(); ++i)
-				moves.push_back(*movelist.Get(i));
+				moves.push_back(TEST_Move(*movelist.Get(i), Game()));
 			return moves;
 		}
 
-		std::vector<BMC_Move> ValidChance() const
+		std::vector<TEST_Move> ValidChance() const
 		{
 			BMC_MoveList movelist;
 			Game()->GenerateValidChance(movelist);
 
-			std::vector<BMC_Move> moves;
+			std::vector<TEST_Move> moves;
 			for (int i = 0; i < movelist.Size(); ++i)
-				moves.push_back(*movelist.Get(i));
+				moves.push_back(TEST_Move(*movelist.Get(i), Game()));
 			return moves;
 		}
 	};
@@ -110,7 +134,7 @@ public:
 
 	TEST_Parser parser;
 
-	BMC_Move ParseFightGetAttack(std::string d0, std::string d1)
+	TEST_Move ParseFightGetAttack(std::string d0, std::string d1)
 	{
 		auto dice0 = split(d0, ' ');
 		auto dice1 = split(d1, ' ');
@@ -160,6 +184,65 @@ public:
 		return ParsePhaseContext("chance", d0, d1);
 	}
 
+	// the moves and win estimates of two searches by SearchTwice()
+	struct SearchPair
+	{
+		BMC_Move move[2];
+		float probability[2];
+	};
+
+	// run the same seeded ply 2 BMAI3 search twice, from two copies of one fight.  _setup(ai, search) is called
+	// before search 0 and search 1, to change the settings of the second.
+	static SearchPair SearchTwice(std::function<void(BMC_BMAI3 &, INT)> _setup)
+	{
+		TEST_Util test;
+		auto context = test.ParseFightContext("8:8 7:7", "n20:15 v20:15 v20:8");
+		context.Game()->GetRNG().SRand(7);
+		BMC_QAI qai;
+		BMC_BMAI3 ai(&qai);
+		ai.SetMaxPly(2);
+
+		SearchPair result;
+		for (INT search=0; search<2; search++)
+		{
+			BMC_Game game(false);
+			game = *context.Game();
+			_setup(ai, search);
+			ai.GetAttackAction(&game, result.move[search]);
+			result.probability[search] = ai.GetLastProbabilityWin();
+		}
+		return result;
+	}
+
+	// compare every field of two attacks (or passes)
+	static ::testing::AssertionResult SameAttack(const BMC_Move &_a, const BMC_Move &_b)
+	{
+		if (_a.m_action != _b.m_action)
+			return ::testing::AssertionFailure() << "action " << c_action_name[_a.m_action] << " != " << c_action_name[_b.m_action];
+		if (_a.m_action != BME_ACTION_ATTACK)
+			return ::testing::AssertionSuccess();
+
+		if (_a.m_attack != _b.m_attack || _a.m_attacker != _b.m_attacker || _a.m_target != _b.m_target
+			|| _a.m_attacker_player != _b.m_attacker_player || _a.m_target_player != _b.m_target_player
+			|| _a.m_turbo_option != _b.m_turbo_option)
+			return ::testing::AssertionFailure() << c_attack_name[_a.m_attack] << " " << (int)_a.m_attacker << "->" << (int)_a.m_target
+				<< " != " << c_attack_name[_b.m_attack] << " " << (int)_b.m_attacker << "->" << (int)_b.m_target;
+
+		// the die bits are only written for the attack types that use them, otherwise they are leftover bytes
+		BME_ATTACK_TYPE type = c_attack_type[_a.m_attack];
+		BMC_BitArray<BMD_MAX_DICE> a_attackers = _a.m_attackers, b_attackers = _b.m_attackers;
+		BMC_BitArray<BMD_MAX_DICE> a_targets = _a.m_targets, b_targets = _b.m_targets;
+		for (INT d=0; d<BMD_MAX_DICE; d++)
+		{
+			if (type==BME_ATTACK_TYPE_N_1 && a_attackers.IsSet(d) != b_attackers.IsSet(d))
+				return ::testing::AssertionFailure() << "attackers differ at die " << d;
+			if (type==BME_ATTACK_TYPE_1_N && a_targets.IsSet(d) != b_targets.IsSet(d))
+				return ::testing::AssertionFailure() << "targets differ at die " << d;
+		}
+
+		return ::testing::AssertionSuccess();
+	}
+
 	static std::vector<std::string> split(std::string &str, char delimiter)
 	{
 		std::vector<std::string> result;
@@ -171,12 +254,12 @@ public:
 		return result;
 	}
 
-	static std::vector<BMC_Die*> extractAttackerDice(BMC_Move move)
+	static std::vector<BMC_Die*> extractAttackerDice(TEST_Move move)
 	{
 		return extractDice(move.m_game->GetPlayer(move.m_attacker_player));
 	}
 
-	static std::vector<BMC_Die*> extractTargetDice(BMC_Move move)
+	static std::vector<BMC_Die*> extractTargetDice(TEST_Move move)
 	{
 		return extractDice(move.m_game->GetPlayer(move.m_target_player));
 	}
@@ -205,9 +288,12 @@ public:
         die_data.setSwingType(swing_type);
 
         BMC_Die die;
+        BMC_RNG rng;
         die.SetDie(&die_data);
         die.SetState(BME_STATE_NOTSET);
-        die.Roll(); // populates Score and triggers a Recompute of Attacks and Vulns
+        if (swing_type != BME_SWING_NOT)
+            die.OnSwingSet(swing_type, sides); // SetDie() clears the sides of swing dice
+        die.Roll(rng); // populates Score and triggers a Recompute of Attacks and Vulns
         return die;
     }
 